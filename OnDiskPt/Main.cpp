@@ -24,7 +24,9 @@
 #include <vector>
 #include <iterator>
 #include <cassert>
-#include "../moses/src/InputFileStream.h"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+#include "../moses/src/ParallelTableLoader.h"
 #include "../moses/src/Util.h"
 #include "../moses/src/UserMessage.h"
 #include "../OnDiskPt/OnDiskWrapper.h"
@@ -38,13 +40,137 @@
 using namespace std;
 using namespace OnDiskPt;
 
+namespace
+{
+
+//! target phrase collection of one source phrase, parsed by a worker
+struct ParsedSource {
+  ParsedSource(const SourcePhrase &source)
+    :sourcePhrase(source)
+    ,targetPhraseColl(new TargetPhraseCollection())
+  {}
+  ~ParsedSource() {
+    delete targetPhraseColl;
+  }
+  SourcePhrase sourcePhrase;
+  vector<float> counts;
+  TargetPhraseCollection *targetPhraseColl;
+};
+
+/** rules of a chunk. Their words have ids of the chunk's own vocab, so that
+ * the ids of the table do not depend on the order the workers run in */
+struct ParsedChunk : public Moses::ParallelTableLoader::Chunk {
+  ~ParsedChunk() {
+    Moses::RemoveAllInColl(sources);
+  }
+  Vocab vocab;
+  vector<ParsedSource*> sources;
+};
+
+//! replace the chunk vocab ids of the words of phrase with ids of the table
+void MapVocabIds(Phrase &phrase, const vector<UINT64> &vocabIds)
+{
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    Word &word = phrase.GetWord(pos);
+    word.SetVocabId(0, vocabIds[word.GetVocabId(0)]);
+  }
+}
+
+/** workers parse chunks of rules and sort their collections. The parsed
+ * chunks are encoded and written in input order, which adds them to the trie */
+class RuleTableLoader : public Moses::ParallelTableLoader
+{
+public:
+  RuleTableLoader(size_t numThreads, OnDiskWrapper &onDiskWrapper, int numScores, size_t tableLimit)
+    :Moses::ParallelTableLoader(numThreads)
+    ,m_onDiskWrapper(onDiskWrapper)
+    ,m_numScores(numScores)
+    ,m_tableLimit(tableLimit)
+  {}
+
+protected:
+  Chunk *Parse(const vector<string> &lines, size_t /* firstLine */) {
+    ParsedChunk *parsed = new ParsedChunk;
+    ParsedSource *source = NULL;
+
+    for (size_t ind = 0; ind < lines.size(); ++ind) {
+      if (lines[ind].empty())
+        continue;
+      std::vector<float> misc(1);
+      SourcePhrase sourcePhrase;
+      TargetPhrase *targetPhrase = new TargetPhrase(m_numScores);
+      Tokenize(sourcePhrase, *targetPhrase, lines[ind], parsed->vocab, m_numScores, misc);
+      assert(misc.size() == m_onDiskWrapper.GetNumCounts());
+
+      if (source == NULL || !(sourcePhrase == source->sourcePhrase)) {
+        Finish(source, *parsed);
+        source = new ParsedSource(sourcePhrase);
+      }
+      // the counts of the last rule are kept, as when building in one thread
+      source->counts = misc;
+      source->targetPhraseColl->AddTargetPhrase(targetPhrase);
+    }
+    Finish(source, *parsed);
+    return parsed;
+  }
+
+  //! write the collections of a chunk and add their source phrases to the trie
+  void Merge(Chunk *chunk) {
+    ParsedChunk &parsed = *static_cast<ParsedChunk*>(chunk);
+
+    // words new to the table get their ids in the order they first appear in
+    // the input, so the table is the same whatever the number of threads
+    vector<string> words;
+    parsed.vocab.GetWords(words);
+    vector<UINT64> vocabIds(words.size());
+    for (size_t ind = 1; ind < words.size(); ++ind) {
+      vocabIds[ind] = m_onDiskWrapper.GetVocab().AddVocabId(words[ind]);
+    }
+
+    PhraseNode &rootNode = m_onDiskWrapper.GetRootSourceNode();
+    for (size_t ind = 0; ind < parsed.sources.size(); ++ind) {
+      ParsedSource &source = *parsed.sources[ind];
+      MapVocabIds(source.sourcePhrase, vocabIds);
+      TargetPhraseCollection &targetPhraseColl = *source.targetPhraseColl;
+      for (size_t phraseInd = 0; phraseInd < targetPhraseColl.GetSize(); ++phraseInd) {
+        MapVocabIds(targetPhraseColl.GetTargetPhrase(phraseInd), vocabIds);
+      }
+
+      string targetInd, targetColl;
+      vector<size_t> filePosOffsets;
+      targetPhraseColl.Encode(m_onDiskWrapper, targetInd, targetColl, filePosOffsets);
+      UINT64 collFilePos = TargetPhraseCollection::SaveEncoded(m_onDiskWrapper, targetInd
+                           , targetColl, filePosOffsets);
+      rootNode.AddTargetPhraseColl(source.sourcePhrase, collFilePos, m_onDiskWrapper, m_tableLimit, source.counts);
+    }
+    delete chunk;
+  }
+
+private:
+  void Finish(ParsedSource *source, ParsedChunk &parsed) const {
+    if (source == NULL)
+      return;
+    source->targetPhraseColl->Sort(m_tableLimit);
+    parsed.sources.push_back(source);
+  }
+
+  OnDiskWrapper &m_onDiskWrapper;
+  int m_numScores;
+  size_t m_tableLimit;
+};
+
+}
+
 int main (int argc, char * const argv[])
 {
   // insert code here...
   Moses::ResetUserTime();
   Moses::PrintUserTime("Starting");
 
-  assert(argc == 8);
+  if (argc != 8 && argc != 9) {
+    cerr << "Usage: " << argv[0] << " numSourceFactors numTargetFactors numScores tableLimit sortScoreIndex inputPath outputPath [threads]" << endl;
+    return 1;
+  }
 
   int numSourceFactors		= Moses::Scan<int>(argv[1])
                             , numTargetFactors	= Moses::Scan<int>(argv[2])
@@ -56,32 +182,29 @@ int main (int argc, char * const argv[])
   const string filePath = argv[6]
                           ,destPath = argv[7];
 
-
-  Moses::InputFileStream inStream(filePath);
+  size_t numThreads = (argc == 9) ? Moses::Scan<size_t>(argv[8]) : 1;
+  assert(numThreads > 0);
+#ifndef WITH_THREADS
+  if (numThreads > 1) {
+    cerr << "Compiled without threads, using one" << endl;
+    numThreads = 1;
+  }
+#endif
 
   OnDiskWrapper onDiskWrapper;
   bool retDb = onDiskWrapper.BeginSave(destPath, numSourceFactors, numTargetFactors, numScores);
   assert(retDb);
 
   PhraseNode &rootNode = onDiskWrapper.GetRootSourceNode();
-  size_t lineNum = 0;
-  char line[100000];
-
-  //while(getline(inStream, line))
-  while(inStream.getline(line, 100000)) {
-    lineNum++;
-    if (lineNum%1000 == 0) cerr << "." << flush;
-    if (lineNum%10000 == 0) cerr << ":" << flush;
-    if (lineNum%100000 == 0) cerr << lineNum << flush;
-    //cerr << lineNum << " " << line << endl;
-
-    std::vector<float> misc(1);
-    SourcePhrase sourcePhrase;
-    TargetPhrase *targetPhrase = new TargetPhrase(numScores);
-    Tokenize(sourcePhrase, *targetPhrase, line, onDiskWrapper, numScores, misc);
-    assert(misc.size() == onDiskWrapper.GetNumCounts());
-
-    rootNode.AddTargetPhrase(sourcePhrase, targetPhrase, onDiskWrapper, tableLimit, misc);
+
+  try {
+    // gzipped or not
+    util::FilePiece inStream(filePath.c_str(), &std::cerr);
+    RuleTableLoader loader(numThreads, onDiskWrapper, numScores, tableLimit);
+    loader.Load(inStream);
+  } catch (const util::Exception &e) {
+    cerr << e.what() << endl;
+    return 1;
   }
 
   rootNode.Save(onDiskWrapper, 0, tableLimit);
@@ -106,7 +229,7 @@ bool Flush(const OnDiskPt::SourcePhrase *prevSourcePhrase, const OnDiskPt::Sourc
   return ret;
 }
 
-void Tokenize(SourcePhrase &sourcePhrase, TargetPhrase &targetPhrase, char *line, OnDiskWrapper &onDiskWrapper, int numScores, vector<float> &misc)
+void Tokenize(SourcePhrase &sourcePhrase, TargetPhrase &targetPhrase, const StringPiece &line, Vocab &vocab, int numScores, vector<float> &misc)
 {
   size_t scoreInd = 0;
 
@@ -118,28 +241,27 @@ void Tokenize(SourcePhrase &sourcePhrase, TargetPhrase &targetPhrase, char *line
    3 = align
    4 = count
    */
-  char *tok = strtok (line," ");
-  while (tok != NULL) {
-    if (0 == strcmp(tok, "|||")) {
+  for (util::TokenIter<util::SingleCharacter, true> tok(line, ' '); tok; ++tok) {
+    if (*tok == "|||") {
       ++stage;
     } else {
       switch (stage) {
       case 0: {
-        Tokenize(sourcePhrase, tok, true, true, onDiskWrapper);
+        Tokenize(sourcePhrase, tok->as_string(), true, true, vocab);
         break;
       }
       case 1: {
-        Tokenize(targetPhrase, tok, false, true, onDiskWrapper);
+        Tokenize(targetPhrase, tok->as_string(), false, true, vocab);
         break;
       }
       case 2: {
-        float score = Moses::Scan<float>(tok);
+        float score = Moses::Scan<float>(tok->as_string());
         targetPhrase.SetScore(score, scoreInd);
         ++scoreInd;
         break;
       }
       case 3: {
-        targetPhrase.Create1AlignFromString(tok);
+        targetPhrase.Create1AlignFromString(tok->as_string());
         break;
       }
       case 4:
@@ -147,7 +269,7 @@ void Tokenize(SourcePhrase &sourcePhrase, TargetPhrase &targetPhrase, char *line
         break;
       case 5: {
         // count info. Only store the 2nd one
-        float val = Moses::Scan<float>(tok);
+        float val = Moses::Scan<float>(tok->as_string());
         misc[0] = val;
         ++stage;
         break;
@@ -157,9 +279,7 @@ void Tokenize(SourcePhrase &sourcePhrase, TargetPhrase &targetPhrase, char *line
         break;
       }
     }
-
-    tok = strtok (NULL, " ");
-  } // while (tok != NULL)
+  } // for (tok
 
   assert(scoreInd == numScores);
   targetPhrase.SortAlign();
@@ -168,7 +288,7 @@ void Tokenize(SourcePhrase &sourcePhrase, TargetPhrase &targetPhrase, char *line
 
 void Tokenize(OnDiskPt::Phrase &phrase
               , const std::string &token, bool addSourceNonTerm, bool addTargetNonTerm
-              , OnDiskPt::OnDiskWrapper &onDiskWrapper)
+              , OnDiskPt::Vocab &vocab)
 {
 
   bool nonTerm = false;
@@ -188,20 +308,20 @@ void Tokenize(OnDiskPt::Phrase &phrase
     if (splitPos == string::npos) {
       // lhs - only 1 word
       Word *word = new Word();
-      word->CreateFromString(wordStr, onDiskWrapper.GetVocab());
+      word->CreateFromString(wordStr, vocab);
       phrase.AddWord(word);
     } else {
       // source & target non-terms
       if (addSourceNonTerm) {
         Word *word = new Word();
-        word->CreateFromString(wordStr, onDiskWrapper.GetVocab());
+        word->CreateFromString(wordStr, vocab);
         phrase.AddWord(word);
       }
 
       wordStr = token.substr(splitPos, tokSize - splitPos);
       if (addTargetNonTerm) {
         Word *word = new Word();
-        word->CreateFromString(wordStr, onDiskWrapper.GetVocab());
+        word->CreateFromString(wordStr, vocab);
         phrase.AddWord(word);
       }
 
@@ -209,7 +329,7 @@ void Tokenize(OnDiskPt::Phrase &phrase
   } else {
     // term
     Word *word = new Word();
-    word->CreateFromString(token, onDiskWrapper.GetVocab());
+    word->CreateFromString(token, vocab);
     phrase.AddWord(word);
   }
 }
@@ -19,6 +19,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
 #include <string>
+#include "util/string_piece.hh"
 #include "../OnDiskPt/SourcePhrase.h"
 #include "../OnDiskPt/TargetPhrase.h"
 
@@ -27,9 +28,9 @@ typedef std::vector<AlignPair> AlignType;
 
 void Tokenize(OnDiskPt::Phrase &phrase
               , const std::string &token, bool addSourceNonTerm, bool addTargetNonTerm
-              , OnDiskPt::OnDiskWrapper &onDiskWrapper);
+              , OnDiskPt::Vocab &vocab);
 void Tokenize(OnDiskPt::SourcePhrase &sourcePhrase, OnDiskPt::TargetPhrase &targetPhrase
-              , char *line, OnDiskPt::OnDiskWrapper &onDiskWrapper
+              , const StringPiece &line, OnDiskPt::Vocab &vocab
               , int numScores
               , std::vector<float> &misc);
 
@@ -24,6 +24,8 @@
 #include "util/check.hh"
 #include <string>
 #include "OnDiskWrapper.h"
+#include "util/exception.hh"
+#include "util/file.hh"
 
 using namespace std;
 
@@ -31,6 +33,8 @@ namespace OnDiskPt
 {
 
 OnDiskWrapper::OnDiskWrapper()
+  :m_useMMap(false)
+  ,m_rootSourceNode(NULL)
 {
 }
 
@@ -39,8 +43,9 @@ OnDiskWrapper::~OnDiskWrapper()
   delete m_rootSourceNode;
 }
 
-bool OnDiskWrapper::BeginLoad(const std::string &filePath)
+bool OnDiskWrapper::BeginLoad(const std::string &filePath, bool useMMap)
 {
+  m_useMMap = useMMap;
   if (!OpenForLoad(filePath))
     return false;
 
@@ -55,14 +60,19 @@ bool OnDiskWrapper::BeginLoad(const std::string &filePath)
 
 bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
 {
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
-  CHECK(m_fileSource.is_open());
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
-  CHECK(m_fileTargetInd.is_open());
-
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
-  CHECK(m_fileTargetColl.is_open());
+  if (m_useMMap) {
+    if (!MapForLoad(filePath))
+      return false;
+  } else {
+    m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
+    CHECK(m_fileSource.is_open());
+
+    m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
+    CHECK(m_fileTargetInd.is_open());
+
+    m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
+    CHECK(m_fileTargetColl.is_open());
+  }
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   CHECK(m_fileVocab.is_open());
@@ -79,6 +89,24 @@ bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
   return true;
 }
 
+bool OnDiskWrapper::MapForLoad(const std::string &filePath)
+{
+  const char *names[] = { "/Source.dat", "/TargetInd.dat", "/TargetColl.dat" };
+  util::scoped_memory *mems[] = { &m_memSource, &m_memTargetInd, &m_memTargetColl };
+
+  for (size_t i = 0; i < 3; ++i) {
+    const std::string fileName = filePath + names[i];
+    try {
+      util::scoped_fd fd(util::OpenReadOrThrow(fileName.c_str()));
+      util::MapRead(util::LAZY, fd.get(), 0, util::SizeFile(fd.get()), *mems[i]);
+    } catch (const util::Exception &e) {
+      std::cerr << "Cannot map " << fileName << ": " << e.what() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
 bool OnDiskWrapper::LoadMisc()
 {
   char line[100000];
@@ -189,6 +217,22 @@ UINT64 OnDiskWrapper::GetMisc(const std::string &key) const
   return iter->second;
 }
 
+void OnDiskWrapper::SetNodeCacheSize(size_t maxSize)
+{
+  // a mapped node is used in place, so decoding it costs less than the lock
+  m_nodeCache.SetMaxSize(m_useMMap ? 0 : maxSize);
+}
+
+PhraseNode *OnDiskWrapper::LoadNode(UINT64 filePos)
+{
+  PhraseNode *node = m_nodeCache.Find(filePos);
+  if (node == NULL) {
+    node = new PhraseNode(filePos, *this);
+    m_nodeCache.Add(*node);
+  }
+  return node;
+}
+
 PhraseNode &OnDiskWrapper::GetRootSourceNode()
 {
   return *m_rootSourceNode;
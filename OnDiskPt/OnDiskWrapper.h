@@ -22,7 +22,9 @@
 #include <fstream>
 #include "Vocab.h"
 #include "PhraseNode.h"
+#include "PhraseNodeCache.h"
 #include "../moses/src/Word.h"
+#include "util/mmap.hh"
 
 namespace OnDiskPt
 {
@@ -36,6 +38,14 @@ protected:
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
   std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
 
+  // mmap mode. Source.dat, TargetInd.dat and TargetColl.dat are mapped
+  // instead of opened, and read without any state, so the wrapper can be
+  // shared by threads
+  bool m_useMMap;
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
+
+  PhraseNodeCache m_nodeCache;
+
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
 
@@ -43,13 +53,14 @@ protected:
 
   void SaveMisc();
   bool OpenForLoad(const std::string &filePath);
+  bool MapForLoad(const std::string &filePath);
   bool LoadMisc();
 
 public:
   OnDiskWrapper();
   ~OnDiskWrapper();
 
-  bool BeginLoad(const std::string &filePath);
+  bool BeginLoad(const std::string &filePath, bool useMMap = false);
 
   bool BeginSave(const std::string &filePath
                  , int numSourceFactors, int	numTargetFactors, int numScores);
@@ -75,6 +86,36 @@ public:
     return m_fileVocab;
   }
 
+  bool IsMMap() const {
+    return m_useMMap;
+  }
+  const char *GetMemSource() const {
+    return m_memSource.begin();
+  }
+  size_t GetMemSourceSize() const {
+    return m_memSource.size();
+  }
+  const char *GetMemTargetInd() const {
+    return m_memTargetInd.begin();
+  }
+  size_t GetMemTargetIndSize() const {
+    return m_memTargetInd.size();
+  }
+  const char *GetMemTargetColl() const {
+    return m_memTargetColl.begin();
+  }
+  size_t GetMemTargetCollSize() const {
+    return m_memTargetColl.size();
+  }
+
+  //! maximum number of nodes kept decoded across sentences. Not used in mmap mode
+  void SetNodeCacheSize(size_t maxSize);
+  const PhraseNodeCache &GetNodeCache() const {
+    return m_nodeCache;
+  }
+  //! new node read from Source.dat at filePos, or a copy of the cached one
+  PhraseNode *LoadNode(UINT64 filePos);
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
@@ -44,6 +44,9 @@ public:
   const Word &GetWord(size_t pos) const {
     return *m_words[pos];
   }
+  Word &GetWord(size_t pos) {
+    return *m_words[pos];
+  }
   size_t GetSize() const {
     return m_words.size();
   }
@@ -46,35 +46,51 @@ PhraseNode::PhraseNode()
 }
 
 PhraseNode::PhraseNode(UINT64 filePos, OnDiskWrapper &onDiskWrapper)
-  :m_counts(onDiskWrapper.GetNumCounts())
+  :m_currChild(NULL)
+  ,m_saved(true)
+  ,m_pos(0)
+  ,m_counts(onDiskWrapper.GetNumCounts())
 {
   // load saved node
   m_filePos = filePos;
 
   size_t countSize = onDiskWrapper.GetNumCounts();
+  size_t memAlloc;
 
-  std::fstream &file = onDiskWrapper.GetFileSource();
-  file.seekg(filePos);
-  CHECK(filePos == file.tellg());
+  if (onDiskWrapper.IsMMap()) {
+    // use the node in place
+    CHECK(filePos + sizeof(UINT64) <= onDiskWrapper.GetMemSourceSize());
+    m_memLoad = onDiskWrapper.GetMemSource() + filePos;
+    m_numChildrenLoad = ((const UINT64*)m_memLoad)[0];
 
-  file.read((char*) &m_numChildrenLoad, sizeof(UINT64));
+    memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
+    CHECK(filePos + memAlloc <= onDiskWrapper.GetMemSourceSize());
+  } else {
+    std::fstream &file = onDiskWrapper.GetFileSource();
+    file.seekg(filePos);
+    CHECK(filePos == file.tellg());
 
-  size_t memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
-  m_memLoad = (char*) malloc(memAlloc);
+    file.read((char*) &m_numChildrenLoad, sizeof(UINT64));
 
-  // go to start of node again
-  file.seekg(filePos);
-  CHECK(filePos == file.tellg());
+    memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
+    char *mem = (char*) malloc(memAlloc);
+    m_memOwner.reset(mem, free);
+    m_memLoad = mem;
 
-  // read everything into memory
-  file.read(m_memLoad, memAlloc);
-  CHECK(filePos + memAlloc == file.tellg());
+    // go to start of node again
+    file.seekg(filePos);
+    CHECK(filePos == file.tellg());
+
+    // read everything into memory
+    file.read(mem, memAlloc);
+    CHECK(filePos + memAlloc == file.tellg());
+  }
 
   // get value
-  m_value = ((UINT64*)m_memLoad)[1];
+  m_value = ((const UINT64*)m_memLoad)[1];
 
   // get counts
-  float *memFloat = (float*) (m_memLoad + sizeof(UINT64) * 2);
+  const float *memFloat = (const float*) (m_memLoad + sizeof(UINT64) * 2);
 
   CHECK(countSize == 1);
   m_counts[0] = memFloat[0];
@@ -84,7 +100,6 @@ PhraseNode::PhraseNode(UINT64 filePos, OnDiskWrapper &onDiskWrapper)
 
 PhraseNode::~PhraseNode()
 {
-  free(m_memLoad);
   //CHECK(m_saved);
 }
 
@@ -97,10 +112,12 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
 {
   CHECK(!m_saved);
 
-  // save this node
-  m_targetPhraseColl.Sort(tableLimit);
-  m_targetPhraseColl.Save(onDiskWrapper);
-  m_value = m_targetPhraseColl.GetFilePos();
+  // save this node, unless its target phrases were written already
+  if (m_value == 0) {
+    m_targetPhraseColl.Sort(tableLimit);
+    m_targetPhraseColl.Save(onDiskWrapper);
+    m_value = m_targetPhraseColl.GetFilePos();
+  }
 
   size_t numCounts = onDiskWrapper.GetNumCounts();
 
@@ -162,12 +179,24 @@ void PhraseNode::AddTargetPhrase(const SourcePhrase &sourcePhrase, TargetPhrase
                                  , OnDiskWrapper &onDiskWrapper, size_t tableLimit
                                  , const std::vector<float> &counts)
 {
-  AddTargetPhrase(0, sourcePhrase, targetPhrase, onDiskWrapper, tableLimit, counts);
+  // drill down to the right node
+  PhraseNode &node = GetLeaf(0, sourcePhrase, onDiskWrapper, tableLimit);
+  node.m_counts = counts;
+  node.m_targetPhraseColl.AddTargetPhrase(targetPhrase);
 }
 
-void PhraseNode::AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
-                                 , TargetPhrase *targetPhrase, OnDiskWrapper &onDiskWrapper
-                                 , size_t tableLimit, const std::vector<float> &counts)
+void PhraseNode::AddTargetPhraseColl(const SourcePhrase &sourcePhrase, UINT64 collFilePos
+                                     , OnDiskWrapper &onDiskWrapper, size_t tableLimit
+                                     , const std::vector<float> &counts)
+{
+  PhraseNode &node = GetLeaf(0, sourcePhrase, onDiskWrapper, tableLimit);
+  CHECK(node.m_value == 0 && node.m_targetPhraseColl.GetSize() == 0);
+  node.m_counts = counts;
+  node.m_value = collFilePos;
+}
+
+PhraseNode &PhraseNode::GetLeaf(size_t pos, const SourcePhrase &sourcePhrase
+                                , OnDiskWrapper &onDiskWrapper, size_t tableLimit)
 {
   size_t phraseSize = sourcePhrase.GetSize();
   if (pos < phraseSize) {
@@ -185,75 +214,51 @@ void PhraseNode::AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
       m_currChild = &node;
     }
 
-    node.AddTargetPhrase(pos + 1, sourcePhrase, targetPhrase, onDiskWrapper, tableLimit, counts);
+    return node.GetLeaf(pos + 1, sourcePhrase, onDiskWrapper, tableLimit);
   } else {
-    // drilled down to the right node
-    m_counts = counts;
-    m_targetPhraseColl.AddTargetPhrase(targetPhrase);
+    return *this;
   }
 }
 
 const PhraseNode *PhraseNode::GetChild(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const
 {
-  const PhraseNode *ret = NULL;
+  size_t wordSize = onDiskWrapper.GetSourceWordSize();
+  size_t childSize = wordSize + sizeof(UINT64);
+  size_t numFactors = onDiskWrapper.GetNumSourceFactors();
 
-  int l = 0;
-  int r = m_numChildrenLoad - 1;
-  int x;
+  const char *childMem = m_memLoad
+                         + sizeof(UINT64) * 2 // size & file pos of target phrase coll
+                         + sizeof(float) * onDiskWrapper.GetNumCounts(); // count info
 
-  while (r >= l) {
-    x = (l + r) / 2;
+  // binary search of the children in place, without decoding their words
+  size_t l = 0;
+  size_t r = m_numChildrenLoad;
 
-    Word wordFound;
-    UINT64 childFilePos;
-    GetChild(wordFound, childFilePos, x, onDiskWrapper);
+  while (l < r) {
+    size_t x = l + (r - l) / 2;
+    const char *currMem = childMem + childSize * x;
 
-    if (wordSought == wordFound) {
-      ret = new PhraseNode(childFilePos, onDiskWrapper);
-      break;
+    int comp = wordSought.Compare(currMem, numFactors);
+    if (comp == 0) {
+      UINT64 childFilePos = *(const UINT64*) (currMem + wordSize);
+      return onDiskWrapper.LoadNode(childFilePos);
     }
-    if (wordSought < wordFound)
-      r = x - 1;
+    if (comp < 0)
+      r = x;
     else
       l = x + 1;
   }
 
-  return ret;
-}
-
-void PhraseNode::GetChild(Word &wordFound, UINT64 &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const
-{
-
-  size_t wordSize = onDiskWrapper.GetSourceWordSize();
-  size_t childSize = wordSize + sizeof(UINT64);
-  size_t numFactors = onDiskWrapper.GetNumSourceFactors();
-
-  char *currMem = m_memLoad
-                  + sizeof(UINT64) * 2 // size & file pos of target phrase coll
-                  + sizeof(float) * onDiskWrapper.GetNumCounts() // count info
-                  + childSize * ind;
-
-  size_t memRead = ReadChild(wordFound, childFilePos, currMem, numFactors);
-  CHECK(memRead == childSize);
-}
-
-size_t PhraseNode::ReadChild(Word &wordFound, UINT64 &childFilePos, const char *mem, size_t numFactors) const
-{
-  size_t memRead = wordFound.ReadFromMemory(mem, numFactors);
-
-  const char *currMem = mem + memRead;
-  UINT64 *memArray = (UINT64*) (currMem);
-  childFilePos = memArray[0];
-
-  memRead += sizeof(UINT64);
-  return memRead;
+  return NULL;
 }
 
 const TargetPhraseCollection *PhraseNode::GetTargetPhraseCollection(size_t tableLimit, OnDiskWrapper &onDiskWrapper) const
 {
   TargetPhraseCollection *ret = new TargetPhraseCollection();
 
-  if (m_value > 0)
+  if (m_value > 0 && onDiskWrapper.IsMMap())
+    ret->ReadFromMemory(tableLimit, m_value, onDiskWrapper);
+  else if (m_value > 0)
     ret->ReadFromFile(tableLimit, m_value, onDiskWrapper);
   else {
 
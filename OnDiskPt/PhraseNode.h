@@ -21,6 +21,7 @@
 #include <fstream>
 #include <vector>
 #include <map>
+#include <boost/shared_ptr.hpp>
 #include "Word.h"
 #include "TargetPhraseCollection.h"
 
@@ -45,14 +46,15 @@ protected:
 
   TargetPhraseCollection m_targetPhraseColl;
 
-  char *m_memLoad, *m_memLoadLast;
+  // loaded node. points into the mapped Source.dat in mmap mode, otherwise
+  // to a copy read from the file, which is shared with copies of this node
+  const char *m_memLoad, *m_memLoadLast;
+  boost::shared_ptr<char> m_memOwner;
   UINT64 m_numChildrenLoad;
 
-  void AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
-                       , TargetPhrase *targetPhrase, OnDiskWrapper &onDiskWrapper
-                       , size_t tableLimit, const std::vector<float> &counts);
-  size_t ReadChild(Word &wordFound, UINT64 &childFilePos, const char *mem, size_t numFactors) const;
-  void GetChild(Word &wordFound, UINT64 &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const;
+  //! node of sourcePhrase from pos on, saving the children that are done with
+  PhraseNode &GetLeaf(size_t pos, const SourcePhrase &sourcePhrase
+                      , OnDiskWrapper &onDiskWrapper, size_t tableLimit);
 
 public:
   static size_t GetNodeSize(size_t numChildren, size_t wordSize, size_t countSize);
@@ -67,6 +69,10 @@ public:
   void AddTargetPhrase(const SourcePhrase &sourcePhrase, TargetPhrase *targetPhrase
                        , OnDiskWrapper &onDiskWrapper, size_t tableLimit
                        , const std::vector<float> &counts);
+  //! same as AddTargetPhrase, for a collection already written at collFilePos
+  void AddTargetPhraseColl(const SourcePhrase &sourcePhrase, UINT64 collFilePos
+                           , OnDiskWrapper &onDiskWrapper, size_t tableLimit
+                           , const std::vector<float> &counts);
 
   UINT64 GetFilePos() const {
     return m_filePos;
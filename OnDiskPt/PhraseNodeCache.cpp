@@ -0,0 +1,97 @@
+/***********************************************************************
+ Moses - factored phrase-based, hierarchical and syntactic language decoder
+ Copyright (C) 2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+#include "PhraseNodeCache.h"
+#include "../moses/src/Util.h"
+
+namespace OnDiskPt
+{
+
+PhraseNodeCache::PhraseNodeCache()
+  :m_maxSize(0)
+  ,m_hand(0)
+  ,m_hits(0)
+  ,m_misses(0)
+{
+}
+
+PhraseNodeCache::~PhraseNodeCache()
+{
+  Moses::RemoveAllInColl(m_entries);
+}
+
+void PhraseNodeCache::SetMaxSize(size_t maxSize)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Moses::RemoveAllInColl(m_entries);
+  m_index.clear();
+  m_hand = 0;
+  m_maxSize = maxSize;
+}
+
+PhraseNode *PhraseNodeCache::Find(UINT64 filePos)
+{
+  if (m_maxSize == 0)
+    return NULL;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  IndexType::const_iterator iter = m_index.find(filePos);
+  if (iter == m_index.end()) {
+    ++m_misses;
+    return NULL;
+  }
+  ++m_hits;
+  Entry &entry = *m_entries[iter->second];
+  entry.m_referenced = true;
+  return new PhraseNode(entry.m_node);
+}
+
+void PhraseNodeCache::Add(const PhraseNode &node)
+{
+  if (m_maxSize == 0)
+    return;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  if (m_index.find(node.GetFilePos()) != m_index.end())
+    return; // added by another thread meanwhile
+
+  if (m_entries.size() < m_maxSize) {
+    m_index[node.GetFilePos()] = m_entries.size();
+    m_entries.push_back(new Entry(node));
+    return;
+  }
+
+  // full. evict the first node that was not used since the hand last passed
+  while (m_entries[m_hand]->m_referenced) {
+    m_entries[m_hand]->m_referenced = false;
+    m_hand = (m_hand + 1) % m_entries.size();
+  }
+  m_index.erase(m_entries[m_hand]->m_node.GetFilePos());
+  delete m_entries[m_hand];
+  m_entries[m_hand] = new Entry(node);
+  m_index[node.GetFilePos()] = m_hand;
+  m_hand = (m_hand + 1) % m_entries.size();
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+/***********************************************************************
+ Moses - factored phrase-based, hierarchical and syntactic language decoder
+ Copyright (C) 2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "PhraseNode.h"
+
+namespace OnDiskPt
+{
+
+/** Bounded cache of nodes read from Source.dat, keyed by file position.
+ * Lookups of the same source words start from the root for every sentence,
+ * so the nodes near the root are read again and again. Cached nodes share
+ * their memory with the copies handed out, so a hit costs no file access,
+ * and an evicted node stays valid for as long as a copy of it is alive.
+ * Eviction uses CLOCK: a hit sets a reference bit and the hand gives
+ * referenced nodes a second chance. Thread safe.
+ */
+class PhraseNodeCache
+{
+  struct Entry {
+    Entry(const PhraseNode &node)
+      :m_node(node)
+      ,m_referenced(false)
+    {}
+    PhraseNode m_node;
+    bool m_referenced;
+  };
+
+  typedef boost::unordered_map<UINT64, size_t> IndexType;
+
+  std::vector<Entry*> m_entries;
+  IndexType m_index; // file pos -> entry
+  size_t m_maxSize, m_hand;
+  size_t m_hits, m_misses;
+
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+
+public:
+  PhraseNodeCache();
+  ~PhraseNodeCache();
+
+  //! maximum number of nodes, 0 to disable the cache
+  void SetMaxSize(size_t maxSize);
+  size_t GetMaxSize() const {
+    return m_maxSize;
+  }
+
+  //! new copy of the node at filePos, or NULL if it is not cached
+  PhraseNode *Find(UINT64 filePos);
+  void Add(const PhraseNode &node);
+
+  size_t GetHits() const {
+    return m_hits;
+  }
+  size_t GetMisses() const {
+    return m_misses;
+  }
+};
+
+}
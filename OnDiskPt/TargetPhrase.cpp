@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "../moses/src/Util.h"
 #include "../moses/src/TargetPhrase.h"
@@ -299,8 +300,59 @@ UINT64 TargetPhrase::ReadScoresFromFile(std::fstream &fileTPColl)
     bytesRead += sizeof(float);
   }
 
+  TransformScores();
+
+  return bytesRead;
+}
+
+void TargetPhrase::TransformScores()
+{
   std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::TransformScore);
   std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::FloorScore);
+}
+
+UINT64 TargetPhrase::ReadOtherInfoFromMemory(const char *mem)
+{
+  // same layout as WriteOtherInfoToMemory
+  UINT64 memUsed = 0;
+  memcpy(&m_filePos, mem, sizeof(UINT64));
+  memUsed += sizeof(UINT64);
+  CHECK(m_filePos != 0);
+
+  UINT64 numAlign;
+  memcpy(&numAlign, mem + memUsed, sizeof(UINT64));
+  memUsed += sizeof(UINT64);
+
+  m_align.resize(numAlign);
+  for (size_t ind = 0; ind < numAlign; ++ind) {
+    AlignPair &alignPair = m_align[ind];
+    memcpy(&alignPair.first, mem + memUsed, sizeof(UINT64));
+    memcpy(&alignPair.second, mem + memUsed + sizeof(UINT64), sizeof(UINT64));
+    memUsed += sizeof(UINT64) * 2;
+  }
+
+  CHECK(m_scores.size() > 0);
+  memcpy(&m_scores[0], mem + memUsed, sizeof(float) * m_scores.size());
+  memUsed += sizeof(float) * m_scores.size();
+
+  TransformScores();
+
+  return memUsed;
+}
+
+UINT64 TargetPhrase::ReadFromMemory(const char *mem, size_t numFactors)
+{
+  UINT64 bytesRead = 0;
+
+  UINT64 numWords;
+  memcpy(&numWords, mem, sizeof(UINT64));
+  bytesRead += sizeof(UINT64);
+
+  for (size_t ind = 0; ind < numWords; ++ind) {
+    Word *word = new Word();
+    bytesRead += word->ReadFromMemory(mem + bytesRead, numFactors);
+    AddWord(word);
+  }
 
   return bytesRead;
 }
@@ -54,6 +54,7 @@ protected:
 
   UINT64 ReadAlignFromFile(std::fstream &fileTPColl);
   UINT64 ReadScoresFromFile(std::fstream &fileTPColl);
+  void TransformScores();
 
 public:
   TargetPhrase(size_t numScores);
@@ -77,6 +78,9 @@ public:
   UINT64 GetFilePos() const {
     return m_filePos;
   }
+  void SetFilePos(UINT64 filePos) {
+    m_filePos = filePos;
+  }
   float GetScore(size_t ind) const {
     return m_scores[ind];
   }
@@ -90,6 +94,8 @@ public:
                                       , const Moses::LMList &lmList) const;
   UINT64 ReadOtherInfoFromFile(UINT64 filePos, std::fstream &fileTPColl);
   UINT64 ReadFromFile(std::fstream &fileTP, size_t numFactors);
+  UINT64 ReadOtherInfoFromMemory(const char *mem);
+  UINT64 ReadFromMemory(const char *mem, size_t numFactors);
 
 };
 
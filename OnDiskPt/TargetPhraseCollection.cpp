@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "../moses/src/Util.h"
 #include "../moses/src/TargetPhraseCollection.h"
@@ -69,48 +70,65 @@ void TargetPhraseCollection::Sort(size_t tableLimit)
 
 void TargetPhraseCollection::Save(OnDiskWrapper &onDiskWrapper)
 {
-  std::fstream &file = onDiskWrapper.GetFileTargetColl();
-
-  size_t memUsed = sizeof(UINT64);
-  char *mem = (char*) malloc(memUsed);
+  std::string targetInd, targetColl;
+  std::vector<size_t> filePosOffsets;
+  Encode(onDiskWrapper, targetInd, targetColl, filePosOffsets);
+  m_filePos = SaveEncoded(onDiskWrapper, targetInd, targetColl, filePosOffsets);
+}
 
+void TargetPhraseCollection::Encode(OnDiskWrapper &onDiskWrapper, std::string &targetInd, std::string &targetColl
+                                    , std::vector<size_t> &filePosOffsets)
+{
   // size of coll
   UINT64 numPhrases = GetSize();
-  ((UINT64*)mem)[0] = numPhrases;
+  targetColl.append((const char*) &numPhrases, sizeof(UINT64));
 
   // MAIN LOOP
   CollType::iterator iter;
   for (iter = m_coll.begin(); iter != m_coll.end(); ++iter) {
-    // save phrase
     TargetPhrase &targetPhrase = **iter;
-    targetPhrase.Save(onDiskWrapper);
 
-    // save coll
+    // phrase, in target ind
+    size_t memUsed;
+    char *mem = targetPhrase.WriteToMemory(onDiskWrapper, memUsed);
+    targetPhrase.SetFilePos(targetInd.size());
+    targetInd.append(mem, memUsed);
+    free(mem);
+
+    // coll. starts with the phrase id
+    filePosOffsets.push_back(targetColl.size());
     size_t memUsedTPOtherInfo;
     char *memTPOtherInfo = targetPhrase.WriteOtherInfoToMemory(onDiskWrapper, memUsedTPOtherInfo);
-
-    // expand existing mem
-    mem = (char*) realloc(mem, memUsed + memUsedTPOtherInfo);
-    memcpy(mem + memUsed, memTPOtherInfo, memUsedTPOtherInfo);
-    memUsed += memUsedTPOtherInfo;
-
+    targetColl.append(memTPOtherInfo, memUsedTPOtherInfo);
     free(memTPOtherInfo);
   }
+}
 
-  // total number of bytes
-  //((UINT64*)mem)[0] = (UINT64) memUsed;
-
-  UINT64 startPos = file.tellp();
-  file.seekp(0, ios::end);
-  file.write((char*) mem, memUsed);
-
-  free(mem);
-
-  UINT64 endPos = file.tellp();
-  CHECK(startPos + memUsed == endPos);
+UINT64 TargetPhraseCollection::SaveEncoded(OnDiskWrapper &onDiskWrapper, const std::string &targetInd
+    , std::string &targetColl, const std::vector<size_t> &filePosOffsets)
+{
+  std::fstream &fileTP = onDiskWrapper.GetFileTargetInd();
+  std::fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
+
+  fileTP.seekp(0, ios::end);
+  UINT64 targetIndPos = fileTP.tellp();
+  fileTP.write(targetInd.data(), targetInd.size());
+  CHECK(targetIndPos + targetInd.size() == (UINT64) fileTP.tellp());
+
+  // phrase ids are file positions in target ind
+  for (size_t ind = 0; ind < filePosOffsets.size(); ++ind) {
+    UINT64 phraseId;
+    memcpy(&phraseId, &targetColl[filePosOffsets[ind]], sizeof(UINT64));
+    phraseId += targetIndPos;
+    memcpy(&targetColl[filePosOffsets[ind]], &phraseId, sizeof(UINT64));
+  }
 
-  m_filePos = startPos;
+  fileTPColl.seekp(0, ios::end);
+  UINT64 startPos = fileTPColl.tellp();
+  fileTPColl.write(targetColl.data(), targetColl.size());
+  CHECK(startPos + targetColl.size() == (UINT64) fileTPColl.tellp());
 
+  return startPos;
 }
 
 Moses::TargetPhraseCollection *TargetPhraseCollection::ConvertToMoses(const std::vector<Moses::FactorType> &inputFactors
@@ -181,6 +199,36 @@ void TargetPhraseCollection::ReadFromFile(size_t tableLimit, UINT64 filePos, OnD
   }
 }
 
+void TargetPhraseCollection::ReadFromMemory(size_t tableLimit, UINT64 filePos, OnDiskWrapper &onDiskWrapper)
+{
+  const char *memTPColl = onDiskWrapper.GetMemTargetColl();
+  const char *memTP = onDiskWrapper.GetMemTargetInd();
+
+  size_t numScores = onDiskWrapper.GetNumScores();
+  size_t numTargetFactors = onDiskWrapper.GetNumTargetFactors();
+
+  CHECK(filePos + sizeof(UINT64) <= onDiskWrapper.GetMemTargetCollSize());
+  UINT64 numPhrases;
+  memcpy(&numPhrases, memTPColl + filePos, sizeof(UINT64));
+
+  // table limit
+  numPhrases = std::min(numPhrases, (UINT64) tableLimit);
+
+  UINT64 currFilePos = filePos + sizeof(UINT64);
+  m_coll.reserve(numPhrases);
+
+  for (size_t ind = 0; ind < numPhrases; ++ind) {
+    TargetPhrase *tp = new TargetPhrase(numScores);
+
+    currFilePos += tp->ReadOtherInfoFromMemory(memTPColl + currFilePos);
+    CHECK(currFilePos <= onDiskWrapper.GetMemTargetCollSize());
+    CHECK(tp->GetFilePos() < onDiskWrapper.GetMemTargetIndSize());
+    tp->ReadFromMemory(memTP + tp->GetFilePos(), numTargetFactors);
+
+    m_coll.push_back(tp);
+  }
+}
+
 UINT64 TargetPhraseCollection::GetFilePos() const
 {
   return m_filePos;
@@ -61,9 +61,21 @@ public:
 
   void Save(OnDiskWrapper &onDiskWrapper);
 
+  /** write the records of Save to memory, for the parallel builder.
+   * Phrase ids are relative to the start of targetInd, and their positions in
+   * targetColl are added to filePosOffsets so SaveEncoded can fix them up. */
+  void Encode(OnDiskWrapper &onDiskWrapper, std::string &targetInd, std::string &targetColl
+              , std::vector<size_t> &filePosOffsets);
+  //! append an encoded collection to the files. Returns its file pos
+  static UINT64 SaveEncoded(OnDiskWrapper &onDiskWrapper, const std::string &targetInd
+                            , std::string &targetColl, const std::vector<size_t> &filePosOffsets);
+
   size_t GetSize() const {
     return m_coll.size();
   }
+  TargetPhrase &GetTargetPhrase(size_t ind) {
+    return *m_coll[ind];
+  }
   UINT64 GetFilePos() const;
 
   Moses::TargetPhraseCollection *ConvertToMoses(const std::vector<Moses::FactorType> &inputFactors
@@ -75,6 +87,8 @@ public:
       , const std::string &filePath
       , Vocab &vocab) const;
   void ReadFromFile(size_t tableLimit, UINT64 filePos, OnDiskWrapper &onDiskWrapper);
+  //! same as ReadFromFile, decoding from the mapped files
+  void ReadFromMemory(size_t tableLimit, UINT64 filePos, OnDiskWrapper &onDiskWrapper);
 
   const std::string GetDebugStr() const;
   void SetDebugStr(const std::string &str);
@@ -96,6 +96,15 @@ UINT64 Vocab::GetVocabId(const std::string &factorString, bool &found) const
   }
 }
 
+void Vocab::GetWords(std::vector<std::string> &words) const
+{
+  words.resize(m_nextId);
+  CollType::const_iterator iter;
+  for (iter = m_vocabColl.begin(); iter != m_vocabColl.end(); ++iter) {
+    words[iter->second] = iter->first;
+  }
+}
+
 const Moses::Factor *Vocab::GetFactor(UINT32 vocabId, Moses::FactorType factorType, Moses::FactorDirection direction, bool isNonTerminal) const
 {
   string str = GetString(vocabId);
@@ -51,6 +51,8 @@ public:
   {}
   UINT64 AddVocabId(const std::string &factorString);
   UINT64 GetVocabId(const std::string &factorString, bool &found) const;
+  //! words added so far, indexed by vocab id. Id 0 is not used
+  void GetWords(std::vector<std::string> &words) const;
   const Moses::Factor *GetFactor(UINT32 vocabId, Moses::FactorType factorType, Moses::FactorDirection direction, bool isNonTerminal) const;
 
   bool Load(OnDiskWrapper &onDiskWrapper);
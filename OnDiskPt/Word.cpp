@@ -18,6 +18,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
 
+#include <algorithm>
 #include "../moses/src/Util.h"
 #include "../moses/src/Word.h"
 #include "Word.h"
@@ -133,6 +134,22 @@ int Word::Compare(const Word &compare) const
   return ret;
 }
 
+int Word::Compare(const char *mem, size_t numFactors) const
+{
+  const UINT64 *vocabMem = (const UINT64*) mem;
+  bool isNonTerminal = (bool) mem[sizeof(UINT64) * numFactors];
+
+  if (m_isNonTerminal != isNonTerminal)
+    return m_isNonTerminal ?-1 : 1;
+
+  // same order as comparing the factor vectors
+  if (std::lexicographical_compare(m_factors.begin(), m_factors.end(), vocabMem, vocabMem + numFactors))
+    return -1;
+  if (std::lexicographical_compare(vocabMem, vocabMem + numFactors, m_factors.begin(), m_factors.end()))
+    return 1;
+  return 0;
+}
+
 bool Word::operator<(const Word &compare) const
 {
   int ret = Compare(compare);
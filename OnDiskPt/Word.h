@@ -65,12 +65,17 @@ public:
   void SetVocabId(size_t ind, UINT32 vocabId) {
     m_factors[ind] = vocabId;
   }
+  UINT64 GetVocabId(size_t ind) const {
+    return m_factors[ind];
+  }
 
   Moses::Word *ConvertToMoses(Moses::FactorDirection direction
                               , const std::vector<Moses::FactorType> &outputFactorsVec
                               , const Vocab &vocab) const;
 
   int Compare(const Word &compare) const;
+  //! compare with a word as written by WriteToMemory, without decoding it
+  int Compare(const char *mem, size_t numFactors) const;
   bool operator<(const Word &compare) const;
   bool operator==(const Word &compare) const;
 
@@ -905,6 +905,56 @@ static inline void process_srilm_command(conn *c, token_t *tokens, size_t ntoken
     c->write_and_go = conn_read;
 }
 
+#define MPROB_MAX_WORDS 16
+
+/*
+ * mprob <word> <context>... | <word> <context>... | ...
+ * scores several n-grams at once, the reply is one float per n-gram
+ * followed by "\r\n".
+ */
+static void process_srilm_multi_command(conn *c, char *ngrams) {
+    int context[MPROB_MAX_WORDS + 1];
+    size_t count = 1;
+    size_t n;
+    char *s, *buf;
+    float *p;
+
+    for (s = ngrams; *s; ++s) {
+        if (*s == '|')
+            ++count;
+    }
+    buf = malloc(count * sizeof(float) + 2);
+    if (buf == NULL) {
+        out_string(c, "SERVER_ERROR out of memory");
+        return;
+    }
+    p = (float *)buf;
+
+    s = ngrams;
+    for (n = 0; n < count; ++n) {
+        char *end = strchr(s, '|');
+        char *word, *save;
+        int i = 0;
+
+        if (end != NULL)
+            *end = '\0';
+        for (word = strtok_r(s, " ", &save); word != NULL && i < MPROB_MAX_WORDS;
+             word = strtok_r(NULL, " ", &save)) {
+            context[i++] = srilm_getvoc(word);
+        }
+        p[n] = -999.0f;
+        if (i > 0 && context[0] != -1) {
+            context[i] = -1;
+            p[n] = srilm_wordprob(context[0], &context[1]);
+        }
+        if (end != NULL)
+            s = end + 1;
+    }
+    memcpy(buf + count * sizeof(float), "\r\n", 2);
+
+    write_and_free(c, buf, count * sizeof(float) + 2);
+}
+
 static void process_command(conn *c, char *command) {
 
     token_t tokens[MAX_TOKENS];
@@ -929,6 +979,11 @@ static void process_command(conn *c, char *command) {
         return;
     }
 
+    if (strncmp(command, "mprob ", 6) == 0) {
+        process_srilm_multi_command(c, command + 6);
+        return;
+    }
+
     ntokens = tokenize_command(command, tokens, MAX_TOKENS);
     if (ntokens >1 &&
       strcmp(tokens[COMMAND_TOKEN].value, "prob") == 0) {
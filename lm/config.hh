@@ -56,6 +56,12 @@ struct Config {
   // models.
   std::size_t building_memory;
 
+  // Number of threads to parse, sort, and merge with while building.  Output
+  // is the same for any number.  Only applies to trie models and requires
+  // compiling with WITH_THREADS, otherwise one thread is used.  With more
+  // than one thread, half of building_memory holds ARPA lines read ahead.
+  std::size_t building_threads;
+
   // Template for temporary directory appropriate for passing to mkdtemp.  
   // The characters XXXXXX are appended before passing to mkdtemp.  Only
   // applies to trie.  If NULL, defaults to write_mmap.  If that's NULL,
@@ -102,6 +102,25 @@ template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search,
   return ret;
 }
 
+namespace {
+// Queries prefetched ahead of the one being scored by FullScoreBatch.  
+const std::size_t kBatchLookahead = 4;
+} // namespace
+
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::FullScoreBatch(const State *const *in_state, const WordIndex *new_word, State *out_state, FullScoreReturn *ret, std::size_t count) const {
+  std::size_t prefetched = std::min(count, kBatchLookahead);
+  for (std::size_t i = 0; i < prefetched; ++i) {
+    Prefetch(*in_state[i], new_word[i]);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    if (prefetched < count) {
+      Prefetch(*in_state[prefetched], new_word[prefetched]);
+      ++prefetched;
+    }
+    ret[i] = FullScore(*in_state[i], new_word[i], out_state[i]);
+  }
+}
+
 template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search, VocabularyT>::FullScoreForgotState(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word, State &out_state) const {
   context_rend = std::min(context_rend, context_rbegin + P::Order() - 1);
   FullScoreReturn ret = ScoreExceptBackoff(context_rbegin, context_rend, new_word, out_state);
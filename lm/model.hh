@@ -98,6 +98,26 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     FullScoreReturn FullScore(const State &in_state, const WordIndex new_word, State &out_state) const;
 
+    /* Score a batch of independent queries: out_state[i] and ret[i] are set
+     * as by FullScore(*in_state[i], new_word[i], out_state[i]).  Lookups of
+     * later queries are prefetched while earlier ones are scored, so their
+     * cache misses overlap instead of being waited for one at a time.  
+     */
+    void FullScoreBatch(const State *const *in_state, const WordIndex *new_word, State *out_state, FullScoreReturn *ret, std::size_t count) const;
+
+    /* Start loading the memory that scoring new_word after in_state will
+     * read, without waiting for it.  Call this for queries a little ahead of
+     * scoring them.  The trie can only prefetch the unigram.  
+     */
+    void Prefetch(const State &in_state, const WordIndex new_word) const {
+      search_.Prefetch(new_word, in_state.words, in_state.words + in_state.length);
+    }
+
+    // Same with the context in reverse order, as for FullScoreForgotState.  
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word) const {
+      search_.Prefetch(new_word, context_rbegin, std::min(context_rend, context_rbegin + P::Order() - 1));
+    }
+
     /* Slower call without in_state.  Try to remember state, but sometimes it
      * would cost too much memory or your decoder isn't setup properly.  
      * To use this function, make an array of WordIndex containing the context
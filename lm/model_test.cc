@@ -278,6 +278,34 @@ template <class M> void NoUnkCheck(const M &model) {
   BOOST_CHECK_CLOSE(-100.0, ret.prob, 0.001);
 }
 
+template <class M> void Batch(const M &model) {
+  const char *words[] = {"<s>", "looking", "on", "a", "little", "the", "biarritz", "not_found", "more", ".", "</s>"};
+  const size_t num_words = sizeof(words) / sizeof(const char*);
+  // Each query continues the previous state, but the batch is independent.  
+  State states[num_words];
+  const State *in_states[num_words - 1];
+  WordIndex indices[num_words - 1];
+  states[0] = model.BeginSentenceState();
+  for (size_t i = 1; i < num_words; ++i) {
+    indices[i - 1] = model.GetVocabulary().Index(words[i]);
+    in_states[i - 1] = &states[i - 1];
+    model.FullScore(states[i - 1], indices[i - 1], states[i]);
+  }
+
+  State out[num_words - 1];
+  FullScoreReturn ret[num_words - 1];
+  model.FullScoreBatch(in_states, indices, out, ret, num_words - 1);
+  for (size_t i = 0; i < num_words - 1; ++i) {
+    State expect_state;
+    FullScoreReturn expect = model.FullScore(*in_states[i], indices[i], expect_state);
+    BOOST_CHECK_EQUAL(expect.prob, ret[i].prob);
+    BOOST_CHECK_EQUAL(expect.ngram_length, ret[i].ngram_length);
+    BOOST_CHECK_EQUAL(expect.independent_left, ret[i].independent_left);
+    BOOST_CHECK_EQUAL(expect_state, out[i]);
+    BOOST_CHECK_EQUAL(states[i + 1], out[i]);
+  }
+}
+
 template <class M> void Everything(const M &m) {
   Starters(m);
   Continuation(m);
@@ -286,6 +314,7 @@ template <class M> void Everything(const M &m) {
   MinimalState(m);
   ExtendLeftTest(m);
   Stateless(m);
+  Batch(m);
 }
 
 class ExpectEnumerateVocab : public EnumerateVocab {
@@ -352,6 +381,27 @@ BOOST_AUTO_TEST_CASE(quant_bhiksha_trie) {
   LoadingTest<QuantArrayTrieModel>();
 }
 
+BOOST_AUTO_TEST_CASE(trie_threads) {
+  Config config;
+  config.arpa_complain = Config::NONE;
+  config.messages = NULL;
+  config.building_threads = 3;
+  {
+    ExpectEnumerateVocab enumerate;
+    config.enumerate_vocab = &enumerate;
+    TrieModel m(TestLocation(), config);
+    enumerate.Check(m.GetVocabulary());
+    Everything(m);
+  }
+  {
+    ExpectEnumerateVocab enumerate;
+    config.enumerate_vocab = &enumerate;
+    TrieModel m(TestNoUnkLocation(), config);
+    enumerate.Check(m.GetVocabulary());
+    NoUnkCheck(m);
+  }
+}
+
 template <class ModelT> void BinaryTest() {
   Config config;
   config.write_mmap = "test.binary";
@@ -103,6 +103,67 @@ void ReadBackoff(util::FilePiece &in, ProbBackoff &weights) {
   }
 }
 
+float ParseFloat(const char *&line) {
+  while (*line != '\n' && util::kSpaces[static_cast<unsigned char>(*line)]) ++line;
+  // strtof would skip over the newline into the next line.
+  char *end = const_cast<char*>(line);
+  float ret = 0.0;
+  if (*line != '\n') {
+#if defined(sun) || defined(WIN32)
+    ret = static_cast<float>(strtod(line, &end));
+#else
+    ret = strtof(line, &end);
+#endif
+  }
+  if (end == line) {
+    const char *token_end = line;
+    while (!kARPASpaces[static_cast<unsigned char>(*token_end)]) ++token_end;
+    throw util::ParseNumberException(StringPiece(line, token_end - line));
+  }
+  line = end;
+  return ret;
+}
+
+StringPiece ParseDelimited(const char *&line) {
+  while (*line != '\n' && kARPASpaces[static_cast<unsigned char>(*line)]) ++line;
+  if (*line == '\n') UTIL_THROW(FormatLoadException, "Too few words");
+  const char *begin = line;
+  while (!kARPASpaces[static_cast<unsigned char>(*line)]) ++line;
+  return StringPiece(begin, line - begin);
+}
+
+void ParseBackoff(const char *&line, Prob &/*weights*/) {
+  switch (*line++) {
+    case '\t':
+      {
+        float got = ParseFloat(line);
+        if (got != 0.0)
+          UTIL_THROW(FormatLoadException, "Non-zero backoff " << got << " provided for an n-gram that should have no backoff");
+      }
+      break;
+    case '\n':
+      break;
+    default:
+      UTIL_THROW(FormatLoadException, "Expected tab or newline for backoff");
+  }
+}
+
+void ParseBackoff(const char *&line, ProbBackoff &weights) {
+  // Same as ReadBackoff: zero backoff is made negative.
+  switch (*line++) {
+    case '\t':
+      weights.backoff = ParseFloat(line);
+      if (weights.backoff == ngram::kExtensionBackoff) weights.backoff = ngram::kNoExtensionBackoff;
+      if (*line++ != '\n') UTIL_THROW(FormatLoadException, "Expected newline after backoff");
+      break;
+    case '\n':
+      weights.backoff = ngram::kNoExtensionBackoff;
+      break;
+    default:
+      UTIL_THROW(FormatLoadException, "Expected tab or newline for backoff");
+  }
+}
+
 void ReadEnd(util::FilePiece &in) {
   StringPiece line;
   do {
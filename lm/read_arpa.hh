@@ -79,6 +79,23 @@ template <class Voc, class Weights> void ReadNGram(util::FilePiece &f, const uns
   }
 }
 
+// Parsing from a line already read into memory, for threads that parse
+// n-grams while the file is read elsewhere.  The line must end with '\n'.
+float ParseFloat(const char *&line);
+StringPiece ParseDelimited(const char *&line);
+void ParseBackoff(const char *&line, Prob &weights);
+void ParseBackoff(const char *&line, ProbBackoff &weights);
+
+// Same format as ReadNGram.  Positive log probabilities are left for the
+// caller to pass to PositiveProbWarn because lines may be parsed out of order.
+template <class Voc, class Weights> void ParseNGram(const char *line, const unsigned char n, const Voc &vocab, WordIndex *const reverse_indices, Weights &weights) {
+  weights.prob = ParseFloat(line);
+  for (WordIndex *vocab_out = reverse_indices + n - 1; vocab_out >= reverse_indices; --vocab_out) {
+    *vocab_out = vocab.Index(ParseDelimited(line));
+  }
+  ParseBackoff(line, weights);
+}
+
 } // namespace lm
 
 #endif // LM_READ_ARPA__
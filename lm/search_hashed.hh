@@ -8,6 +8,7 @@
 #include "lm/weights.hh"
 
 #include "util/bit_packing.hh"
+#include "util/prefetch.hh"
 #include "util/probing_hash_table.hh"
 
 #include <algorithm>
@@ -127,6 +128,23 @@ template <class MiddleT, class LongestT> class TemplateHashedSearch : public Has
 
     void LoadedBinary();
 
+    // Start loading what LookupUnigram, LookupMiddle, and LookupLongest read
+    // to score word after the context, which is in reverse order.  The keys
+    // only depend on the words, so all orders are prefetched at once.  
+    void Prefetch(WordIndex word, const WordIndex *context_rbegin, const WordIndex *context_rend) const {
+      util::PrefetchRead(&unigram.Lookup(word));
+      Node node = static_cast<Node>(word);
+      typename std::vector<Middle>::const_iterator mid_iter = middle_.begin();
+      for (const WordIndex *i = context_rbegin; i != context_rend; ++i, ++mid_iter) {
+        node = CombineWordHash(node, *i);
+        if (mid_iter == middle_.end()) {
+          longest.Prefetch(node);
+          return;
+        }
+        mid_iter->Prefetch(node);
+      }
+    }
+
     bool LookupMiddleNoProb(const Middle &middle, WordIndex word, float &backoff, Node &node) const {
       node = CombineWordHash(node, word);
       typename Middle::ConstIterator found;
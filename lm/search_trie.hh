@@ -9,6 +9,7 @@
 
 #include "util/file.hh"
 #include "util/file_piece.hh"
+#include "util/prefetch.hh"
 
 #include <vector>
 
@@ -73,6 +74,12 @@ template <class Quant, class Bhiksha> class TrieSearch {
       ret.extend_left = static_cast<uint64_t>(word);
     }
 
+    // Start loading the unigram entry of word.  Where the longer n-grams are
+    // depends on the result of each lookup, so they can't be prefetched.  
+    void Prefetch(WordIndex word, const WordIndex * /*context_rbegin*/, const WordIndex * /*context_rend*/) const {
+      util::PrefetchRead(&unigram.Lookup(word));
+    }
+
     bool LookupMiddle(const Middle &mid, WordIndex word, float &backoff, Node &node, FullScoreReturn &ret) const {
       if (!mid.Find(word, ret.prob, backoff, node, ret.extend_left)) return false;
       ret.independent_left = (node.begin == node.end);
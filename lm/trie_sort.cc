@@ -19,6 +19,11 @@
 #include <limits>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
 namespace lm {
 namespace ngram {
 namespace trie {
@@ -140,6 +145,274 @@ template <class Combine> FILE *MergeSortedFiles(FILE *first_file, FILE *second_f
   return out_file.release();
 }
 
+// Runs tasks on their own threads, or right away if there is only one thread.
+// A task that throws fails Join with a FormatLoadException or util::Exception
+// carrying the same message.
+class ThreadGroup {
+  public:
+    explicit ThreadGroup(std::size_t threads) : threads_(threads), failed_(false), format_failure_(false) {}
+
+    ~ThreadGroup() { Wait(); }
+
+    // task must stay alive until Wait or Join returns.
+    template <class Task> void Start(Task &task) {
+#ifdef WITH_THREADS
+      if (threads_ > 1) {
+        running_.push_back(new boost::thread(Runner<Task>(task, *this)));
+        return;
+      }
+#endif
+      task();
+    }
+
+    void Wait() {
+#ifdef WITH_THREADS
+      for (std::vector<boost::thread*>::iterator i = running_.begin(); i != running_.end(); ++i) {
+        (*i)->join();
+        delete *i;
+      }
+      running_.clear();
+#endif
+    }
+
+    void Join() {
+      Wait();
+      if (!failed_) return;
+      failed_ = false;
+      if (format_failure_) {
+        FormatLoadException e;
+        e << failure_;
+        throw e;
+      } else {
+        util::Exception e;
+        e << failure_;
+        throw e;
+      }
+    }
+
+  private:
+#ifdef WITH_THREADS
+    template <class Task> class Runner {
+      public:
+        Runner(Task &task, ThreadGroup &group) : task_(&task), group_(&group) {}
+
+        void operator()() {
+          try {
+            (*task_)();
+          } catch (const FormatLoadException &e) {
+            group_->Fail(e.what(), true);
+          } catch (const std::exception &e) {
+            group_->Fail(e.what(), false);
+          }
+        }
+
+      private:
+        Task *task_;
+        ThreadGroup *group_;
+    };
+
+    void Fail(const char *what, bool format) {
+      boost::mutex::scoped_lock lock(lock_);
+      if (failed_) return;
+      failed_ = true;
+      format_failure_ = format;
+      failure_ = what;
+    }
+
+    boost::mutex lock_;
+    std::vector<boost::thread*> running_;
+#endif
+
+    const std::size_t threads_;
+
+    bool failed_, format_failure_;
+    std::string failure_;
+};
+
+// Lines of n-grams read from the ARPA file ahead of parsing.  Each ends with '\n'.
+class LineBuffer {
+  public:
+    // Read up to max_lines n-grams, stopping early once max_bytes are held.
+    void Read(util::FilePiece &f, std::size_t max_lines, std::size_t max_bytes) {
+      text_.clear();
+      starts_.clear();
+      while (starts_.size() < max_lines && (starts_.empty() || text_.size() < max_bytes)) {
+        StringPiece line;
+        // ReadNGram skips blank lines while looking for the probability.
+        while (IsBlank(line = f.ReadLine())) {}
+        starts_.push_back(text_.size());
+        text_.append(line.data(), line.size());
+        text_.push_back('\n');
+      }
+    }
+
+    std::size_t Size() const { return starts_.size(); }
+
+    const char *Line(std::size_t index) const { return text_.data() + starts_[index]; }
+
+    // For messages: the line without its newline.
+    StringPiece Text(std::size_t index) const {
+      const char *line = Line(index);
+      return StringPiece(line, strchr(line, '\n') - line);
+    }
+
+  private:
+    static bool IsBlank(const StringPiece &line) {
+      for (const char *i = line.data(); i != line.data() + line.size(); ++i) {
+        if (!util::kSpaces[static_cast<unsigned char>(*i)]) return false;
+      }
+      return true;
+    }
+
+    std::string text_;
+    std::vector<std::size_t> starts_;
+};
+
+// One thread's share of a batch: parse its lines, sort them, and write a
+// sorted file of n-grams and one of their contexts.
+template <class Weights> class SortSlice {
+  public:
+    SortSlice() : positive_(false) {}
+
+    void Init(const LineBuffer &lines, std::size_t begin, std::size_t end, uint8_t *records, const SortedVocabulary &vocab, const util::TempMaker &maker, unsigned char order) {
+      lines_ = &lines;
+      begin_ = begin;
+      end_ = end;
+      records_ = records;
+      vocab_ = &vocab;
+      maker_ = &maker;
+      order_ = order;
+      positive_ = false;
+    }
+
+    void operator()() {
+      const std::size_t words_size = sizeof(WordIndex) * order_;
+      const std::size_t entry_size = words_size + sizeof(Weights);
+      uint8_t *out = records_;
+      for (std::size_t i = begin_; i != end_; ++i, out += entry_size) {
+        Weights &weights = *reinterpret_cast<Weights*>(out + words_size);
+        try {
+          ParseNGram(lines_->Line(i), order_, *vocab_, reinterpret_cast<WordIndex*>(out), weights);
+        } catch (util::Exception &e) {
+          e << " in the " << static_cast<unsigned int>(order_) << "-gram \"" << lines_->Text(i) << '"';
+          throw;
+        }
+        if (weights.prob > 0.0) {
+          if (!positive_) {
+            positive_ = true;
+            positive_line_ = i;
+            positive_prob_ = weights.prob;
+          }
+          weights.prob = 0.0;
+        }
+      }
+      util::SizedProxy proxy_begin(records_, entry_size), proxy_end(out, entry_size);
+      std::sort(NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order_)));
+      full_.reset(DiskFlush(records_, out, *maker_));
+      context_.reset(WriteContextFile(records_, out, *maker_, entry_size, order_));
+    }
+
+    // Warn about the first positive log probability, as reading in order would.
+    void Warn(PositiveProbWarn &warn) const {
+      if (!positive_) return;
+      try {
+        warn.Warn(positive_prob_);
+      } catch (util::Exception &e) {
+        e << " in the " << static_cast<unsigned int>(order_) << "-gram \"" << lines_->Text(positive_line_) << '"';
+        throw;
+      }
+    }
+
+    void Release(std::deque<FILE*> &files, std::deque<FILE*> &contexts) {
+      if (full_.get()) files.push_back(full_.release());
+      if (context_.get()) contexts.push_back(context_.release());
+    }
+
+  private:
+    const LineBuffer *lines_;
+    std::size_t begin_, end_;
+    uint8_t *records_;
+    const SortedVocabulary *vocab_;
+    const util::TempMaker *maker_;
+    unsigned char order_;
+
+    bool positive_;
+    std::size_t positive_line_;
+    float positive_prob_;
+
+    util::scoped_FILE full_, context_;
+};
+
+/* Parse and sort n-grams with several threads while the next batch of lines
+ * is read, leaving sorted files to be merged.  Batches are bounded by mem_size
+ * for records and read_ahead for lines.
+ */
+template <class Weights> void SortThreaded(util::FilePiece &f, const SortedVocabulary &vocab, std::size_t count, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size, std::size_t read_ahead, std::size_t threads, std::deque<FILE*> &files, std::deque<FILE*> &contexts) {
+  const std::size_t entry_size = sizeof(WordIndex) * order + sizeof(Weights);
+  const std::size_t batch_size = std::min(count, mem_size / entry_size);
+  uint8_t *const begin = reinterpret_cast<uint8_t*>(mem);
+
+  LineBuffer buffers[2];
+  LineBuffer *current = &buffers[0], *next = &buffers[1];
+  if (count) current->Read(f, batch_size, read_ahead);
+  // Declared before the group so that threads are joined before these go away.
+  util::scoped_array<SortSlice<Weights> > slices(new SortSlice<Weights>[threads]);
+
+  for (std::size_t done = 0; done < count; ) {
+    const std::size_t size = current->Size();
+    ThreadGroup group(threads);
+    for (std::size_t t = 0, slice_begin = 0; t < threads; ++t) {
+      std::size_t slice_end = size * (t + 1) / threads;
+      SortSlice<Weights> &slice = slices.get()[t];
+      slice.Init(*current, slice_begin, slice_end, begin + slice_begin * entry_size, vocab, maker, order);
+      if (slice_begin != slice_end) group.Start(slice);
+      slice_begin = slice_end;
+    }
+    done += size;
+    if (done < count) next->Read(f, std::min(count - done, batch_size), read_ahead);
+    group.Wait();
+    for (std::size_t t = 0; t < threads; ++t) {
+      slices.get()[t].Release(files, contexts);
+    }
+    group.Join();
+    for (std::size_t t = 0; t < threads; ++t) {
+      slices.get()[t].Warn(warn);
+    }
+    std::swap(current, next);
+  }
+}
+
+template <class Combine> class MergeTask {
+  public:
+    MergeTask() : out_(NULL) {}
+
+    void Init(FILE *first, FILE *second, const util::TempMaker &maker, std::size_t weights_size, unsigned char order) {
+      first_ = first;
+      second_ = second;
+      maker_ = &maker;
+      weights_size_ = weights_size;
+      order_ = order;
+      out_ = NULL;
+    }
+
+    void operator()() {
+      out_ = MergeSortedFiles(first_, second_, *maker_, weights_size_, order_, Combine());
+    }
+
+    FILE *Release() {
+      FILE *ret = out_;
+      out_ = NULL;
+      return ret;
+    }
+
+  private:
+    FILE *first_, *second_;
+    const util::TempMaker *maker_;
+    std::size_t weights_size_;
+    unsigned char order_;
+    FILE *out_;
+};
+
 } // namespace
 
 void RecordReader::Init(FILE *file, std::size_t entry_size) {
@@ -179,6 +452,14 @@ SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<u
     if (!vocab.SawUnk()) ++counts[0];
   }
 
+  std::size_t threads = 1;
+#ifdef WITH_THREADS
+  threads = std::max<std::size_t>(1, config.building_threads);
+#endif
+  // With threads, half the buffer holds the two batches of lines read ahead.
+  const std::size_t read_ahead = (threads > 1) ? buffer / 4 : 0;
+  if (threads > 1) buffer -= 2 * read_ahead;
+
   // Only use as much buffer as we need.  
   size_t buffer_use = 0;
   for (unsigned int order = 2; order < counts.size(); ++order) {
@@ -192,7 +473,7 @@ SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<u
   if (!mem.get()) UTIL_THROW(util::ErrnoException, "malloc failed for sort buffer size " << buffer);
 
   for (unsigned char order = 2; order <= counts.size(); ++order) {
-    ConvertToSorted(f, vocab, counts, maker, order, warn, mem.get(), buffer);
+    ConvertToSorted(f, vocab, counts, maker, order, warn, mem.get(), buffer, read_ahead, threads);
   }
   ReadEnd(f);
 }
@@ -217,7 +498,7 @@ class Closer {
 };
 } // namespace
 
-void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size) {
+void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size, std::size_t read_ahead, std::size_t threads) {
   ReadNGramHeader(f, order);
   const size_t count = counts[order - 1];
   // Size of weights.  Does it include backoff?  
@@ -230,37 +511,61 @@ void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vo
   std::deque<FILE*> files, contexts;
   Closer files_closer(files), contexts_closer(contexts);
 
-  for (std::size_t batch = 0, done = 0; done < count; ++batch) {
-    uint8_t *out = begin;
-    uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
+  if (threads > 1) {
     if (order == counts.size()) {
-      for (; out != out_end; out += entry_size) {
-        ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size), warn);
-      }
+      SortThreaded<Prob>(f, vocab, count, maker, order, warn, mem, mem_size, read_ahead, threads, files, contexts);
     } else {
-      for (; out != out_end; out += entry_size) {
-        ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
+      SortThreaded<ProbBackoff>(f, vocab, count, maker, order, warn, mem, mem_size, read_ahead, threads, files, contexts);
+    }
+  } else {
+    for (std::size_t batch = 0, done = 0; done < count; ++batch) {
+      uint8_t *out = begin;
+      uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
+      if (order == counts.size()) {
+        for (; out != out_end; out += entry_size) {
+          ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size), warn);
+        }
+      } else {
+        for (; out != out_end; out += entry_size) {
+          ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
+        }
       }
+      // Sort full records by full n-gram.  
+      util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
+      // parallel_sort uses too much RAM
+      std::sort(NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
+      files.push_back(DiskFlush(begin, out_end, maker));
+      contexts.push_back(WriteContextFile(begin, out_end, maker, entry_size, order));
+
+      done += (out_end - begin) / entry_size;
     }
-    // Sort full records by full n-gram.  
-    util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
-    // parallel_sort uses too much RAM
-    std::sort(NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
-    files.push_back(DiskFlush(begin, out_end, maker));
-    contexts.push_back(WriteContextFile(begin, out_end, maker, entry_size, order));
-
-    done += (out_end - begin) / entry_size;
   }
 
-  // All individual files created.  Merge them.  
+  // All individual files created.  Merge them, a pair of files and a pair of
+  // contexts per two threads at a time.  
 
+  const std::size_t round_pairs = std::max<std::size_t>(1, threads / 2);
+  util::scoped_array<MergeTask<ThrowCombine> > file_merges(new MergeTask<ThrowCombine>[round_pairs]);
+  util::scoped_array<MergeTask<FirstCombine> > context_merges(new MergeTask<FirstCombine>[round_pairs]);
   while (files.size() > 1) {
-    files.push_back(MergeSortedFiles(files[0], files[1], maker, weights_size, order, ThrowCombine()));
-    files_closer.PopFront();
-    files_closer.PopFront();
-    contexts.push_back(MergeSortedFiles(contexts[0], contexts[1], maker, 0, order - 1, FirstCombine()));
-    contexts_closer.PopFront();
-    contexts_closer.PopFront();
+    const std::size_t pairs = std::min(files.size() / 2, round_pairs);
+    ThreadGroup group(threads);
+    for (std::size_t i = 0; i < pairs; ++i) {
+      file_merges.get()[i].Init(files[2 * i], files[2 * i + 1], maker, weights_size, order);
+      context_merges.get()[i].Init(contexts[2 * i], contexts[2 * i + 1], maker, 0, order - 1);
+      group.Start(file_merges.get()[i]);
+      group.Start(context_merges.get()[i]);
+    }
+    group.Wait();
+    for (std::size_t i = 0; i < 2 * pairs; ++i) {
+      files_closer.PopFront();
+      contexts_closer.PopFront();
+    }
+    for (std::size_t i = 0; i < pairs; ++i) {
+      if (FILE *merged = file_merges.get()[i].Release()) files.push_back(merged);
+      if (FILE *merged = context_merges.get()[i].Release()) contexts.push_back(merged);
+    }
+    group.Join();
   }
 
   if (!files.empty()) {
@@ -8,6 +8,8 @@
 #include <sys/stat.h>
 #include "TypeDef.h"
 #include "PhraseDictionaryTree.h"
+#include "PhraseTableMMap.h"
+#include "PhraseTableCompact.h"
 #include "ConfusionNet.h"
 #include "FactorCollection.h"
 #include "Phrase.h"
@@ -45,6 +47,9 @@ int main(int argc,char **argv)
   size_t noScoreComponent=5;
   int cn=0;
   bool aligninfo=false;
+  bool mmap=false;
+  int compactBits=0;
+  std::vector<float> sortWeights;
   std::vector<std::pair<std::string,std::pair<char*,char*> > > ftts;
   int verb=0;
   for(int i=1; i<argc; ++i) {
@@ -59,6 +64,9 @@ int main(int argc,char **argv)
     else if(s=="-cn") cn=1;
     else if(s=="-irst") cn=2;
     else if(s=="-alignment-info") aligninfo=true;
+    else if(s=="-mmap") mmap=true;
+    else if(s=="-compact") compactBits=atoi(argv[++i]);
+    else if(s=="-weights") sortWeights=Tokenize<float>(argv[++i]);
     else if(s=="-v") verb=atoi(argv[++i]);
     else if(s=="-h") {
       std::cerr<<"usage "<<argv[0]<<" :\n\n"
@@ -67,6 +75,15 @@ int main(int argc,char **argv)
                "\t-out string      -- output file name prefix for binary ttable\n"
                "\t-nscores int     -- number of scores in ttable\n"
                "\t-alignment-info  -- include alignment info in the binary ttable (suffix \".wa\")\n"
+               "\t-mmap            -- create the memory mapped format instead (suffix \".binphr.mmap\"),\n"
+               "\t                    used with phrase table type 11\n"
+               "\t-compact int     -- create the compact format instead (suffix \".binphr.compact\"),\n"
+               "\t                    with scores quantized to the given number of bits (8 is a\n"
+               "\t                    good choice), used with phrase table type 12. Not from stdin\n"
+               "\t-weights string  -- translation model weights, e.g. \"0.2 0.2 0.2 0.2 0.2\":\n"
+               "\t                    store the candidates of each source phrase sorted by\n"
+               "\t                    weighted score, so the decoder reads only the first\n"
+               "\t                    ttable-limit of them when decoding with these weights\n"
                "\nfunctions:\n"
                "\t - convert ascii ttable in binary format\n"
                "\t - if ttable is not read from stdin:\n"
@@ -82,11 +99,46 @@ int main(int argc,char **argv)
 
   if(ftts.size()) {
 
-    if(ftts.size()==1) {
+    if(ftts.size()==1 && compactBits) {
+      if(sortWeights.size() && sortWeights.size()!=noScoreComponent) {
+        std::cerr<<"ERROR: "<<sortWeights.size()<<" weights given for "<<noScoreComponent<<" scores\n";
+        return 1;
+      }
+      if (ftts[0].first=="-") {
+        std::cerr<<"ERROR: the compact table is built in two passes and cannot be read from stdin\n";
+        return 1;
+      }
+      std::cerr<<"processing compact table for "<< ftts[0].first << "\n";
+      if(!PhraseTableCompact::Create(ftts[0].first,fto+PhraseTableCompact::FileSuffix(),noScoreComponent,aligninfo,sortWeights,compactBits))
+        return 1;
+    } else if(ftts.size()==1 && mmap) {
+      if(sortWeights.size() && sortWeights.size()!=noScoreComponent) {
+        std::cerr<<"ERROR: "<<sortWeights.size()<<" weights given for "<<noScoreComponent<<" scores\n";
+        return 1;
+      }
+      std::cerr<<"processing memory mapped table for ";
+      bool ok;
+      if (ftts[0].first=="-") {
+        std::cerr<< "stdin\n";
+        ok=PhraseTableMMap::Create(std::cin,fto+PhraseTableMMap::FileSuffix(),noScoreComponent,aligninfo,sortWeights);
+      } else {
+        std::cerr<< ftts[0].first << "\n";
+        InputFileStream in(ftts[0].first);
+        ok=PhraseTableMMap::Create(in,fto+PhraseTableMMap::FileSuffix(),noScoreComponent,aligninfo,sortWeights);
+      }
+      if(!ok) return 1;
+    } else if(ftts.size()==1) {
       std::cerr<<"processing ptree for ";
       PhraseDictionaryTree pdt(noScoreComponent);
 
       pdt.PrintWordAlignment(aligninfo);
+      if(sortWeights.size()) {
+        if(sortWeights.size()!=noScoreComponent) {
+          std::cerr<<"ERROR: "<<sortWeights.size()<<" weights given for "<<noScoreComponent<<" scores\n";
+          return 1;
+        }
+        pdt.SetSortWeights(sortWeights);
+      }
 
       if (ftts[0].first=="-") {
         std::cerr<< "stdin\n";
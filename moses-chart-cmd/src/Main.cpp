@@ -247,7 +247,7 @@ int main(int argc, char* argv[])
       return EXIT_FAILURE;
   
 #ifdef WITH_THREADS
-    ThreadPool pool(staticData.ThreadCount());
+    ThreadPool pool(staticData.ThreadCount(), staticData.ThreadQueueSize(), staticData.PinThreads());
 #endif
   
     // read each sentence & decode
@@ -267,6 +267,8 @@ int main(int argc, char* argv[])
   
 #ifdef WITH_THREADS
     pool.Stop(true);  // flush remaining jobs
+    IFVERBOSE(1)
+    TRACE_ERR("Thread pool: " << pool.GetStatistics() << endl);
 #endif
   
     delete ioWrapper;
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  * Moses main, for single-threaded and multi-threaded.
  **/
 
+#include <algorithm>
 #include <exception>
 #include <fstream>
 #include <sstream>
@@ -463,40 +464,64 @@ int main(int argc, char** argv)
     }
   
 #ifdef WITH_THREADS
-    ThreadPool pool(staticData.ThreadCount());
+    ThreadPool pool(staticData.ThreadCount(), staticData.ThreadQueueSize(), staticData.PinThreads());
 #endif
   
     // main loop over set of input sentences
+    // with prefetching, the sentences are read in batches and the phrases of
+    // each batch are looked up before its sentences are translated
+    const size_t batchSize = max(staticData.GetPrefetchBatchSize(), (size_t) 1);
+    const TranslationSystem& system = staticData.GetTranslationSystem(TranslationSystem::DEFAULT);
     InputType* source = NULL;
+    vector<InputType*> batch;
     size_t lineCount = 0;
-    while(ReadInput(*ioWrapper,staticData.GetInputType(),source)) {
-      IFVERBOSE(1) {
-        ResetUserTime();
+    while(true) {
+      batch.clear();
+      while(batch.size() < batchSize && ReadInput(*ioWrapper,staticData.GetInputType(),source)) {
+        batch.push_back(source);
+        source = NULL; //make sure it doesn't get deleted
+      }
+      if (batch.empty()) break;
+      if (staticData.GetPrefetchBatchSize() > 0) {
+        const vector<PhraseDictionaryFeature*>& pds = system.GetPhraseDictionaries();
+        for (size_t i = 0; i < pds.size(); ++i)
+          pds[i]->Prefetch(&system, batch);
       }
-      // set up task of translating one sentence
-      TranslationTask* task =
-        new TranslationTask(lineCount,source, outputCollector.get(),
-                            nbestCollector.get(),
-                            latticeSamplesCollector.get(),
-                            wordGraphCollector.get(),
-                            searchGraphCollector.get(),
-                            detailedTranslationCollector.get(),
-                            alignmentInfoCollector.get() );
-      // execute task
+
+      for (size_t i = 0; i < batch.size(); ++i) {
+        IFVERBOSE(1) {
+          ResetUserTime();
+        }
+        // set up task of translating one sentence
+        TranslationTask* task =
+          new TranslationTask(lineCount,batch[i], outputCollector.get(),
+                              nbestCollector.get(),
+                              latticeSamplesCollector.get(),
+                              wordGraphCollector.get(),
+                              searchGraphCollector.get(),
+                              detailedTranslationCollector.get(),
+                              alignmentInfoCollector.get() );
+        // execute task
 #ifdef WITH_THREADS
-    pool.Submit(task);
+        pool.Submit(task);
 #else
-      task->Run();
+        task->Run();
 #endif
-  
-      source = NULL; //make sure it doesn't get deleted
-      ++lineCount;
+        ++lineCount;
+      }
     }
   
   // we are done, finishing up
 #ifdef WITH_THREADS
     pool.Stop(true); //flush remaining jobs
+    IFVERBOSE(1) {
+      TRACE_ERR("Thread pool: " << pool.GetStatistics() << endl);
+    }
 #endif
+    IFVERBOSE(1) {
+      if (staticData.GetUseTransOptCache())
+        TRACE_ERR("Translation option cache: " << staticData.GetTransOptCacheStatistics() << endl);
+    }
 
   } catch (const std::exception &e) {
     std::cerr << "Exception: " << e.what() << std::endl;
@@ -38,8 +38,17 @@ const AlignmentInfo &AlignmentInfoCollection::GetEmptyAlignmentInfo() const
 const AlignmentInfo *AlignmentInfoCollection::Add(
     const std::set<std::pair<size_t,size_t> > &pairs)
 {
+  AlignmentInfo alignmentInfo(pairs);
+#ifdef WITH_THREADS
+  {
+    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+    AlignmentInfoSet::const_iterator i = m_collection.find(alignmentInfo);
+    if (i != m_collection.end()) return &(*i);
+  }
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
   std::pair<AlignmentInfoSet::iterator, bool> ret =
-    m_collection.insert(AlignmentInfo(pairs));
+    m_collection.insert(alignmentInfo);
   return &(*ret.first);
 }
 
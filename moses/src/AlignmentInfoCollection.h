@@ -23,6 +23,11 @@
 
 #include <set>
 
+#ifdef WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -50,6 +55,11 @@ class AlignmentInfoCollection
   static AlignmentInfoCollection s_instance;
   AlignmentInfoSet m_collection;
   const AlignmentInfo *m_emptyAlignmentInfo;
+
+#ifdef WITH_THREADS
+  //reader-writer lock, target phrases are created on several threads
+  mutable boost::shared_mutex m_accessLock;
+#endif
 };
 
 }
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <vector>
+#include <boost/functional/hash.hpp>
 #include "ChartHypothesis.h"
 #include "RuleCubeItem.h"
 #include "ChartCell.h"
@@ -46,6 +47,7 @@ ChartHypothesis::ChartHypothesis(const ChartTranslationOption &transOpt,
   :m_targetPhrase(*(item.GetTranslationDimension().GetTargetPhrase()))
   ,m_currSourceWordsRange(transOpt.GetSourceWordsRange())
   ,m_ffStates(manager.GetTranslationSystem()->GetStatefulFeatureFunctions().size())
+  ,m_recombinationHash(0)
   ,m_arcList(NULL)
   ,m_winningHypo(NULL)
   ,m_manager(manager)
@@ -137,6 +139,21 @@ int ChartHypothesis::RecombineCompare(const ChartHypothesis &compare) const
   return 0;
 }
 
+bool ChartHypothesis::RecombineEqual(const ChartHypothesis &compare) const
+{
+  if (m_recombinationHash != compare.m_recombinationHash)
+    return false;
+
+  for (size_t i = 0; i < m_ffStates.size(); ++i) {
+    if (m_ffStates[i] == NULL || compare.m_ffStates[i] == NULL) {
+      if (m_ffStates[i] != compare.m_ffStates[i]) return false;
+    } else if (!m_ffStates[i]->Equal(*compare.m_ffStates[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void ChartHypothesis::CalcScore()
 {
   // total scores from prev hypos
@@ -168,6 +185,12 @@ void ChartHypothesis::CalcScore()
 		m_ffStates[i] = ffs[i]->EvaluateChart(*this,i,&m_scoreBreakdown);
   }
 
+  size_t seed = 0;
+  for (size_t i = 0; i < m_ffStates.size(); ++i) {
+    boost::hash_combine(seed, m_ffStates[i] ? m_ffStates[i]->Hash() : 0);
+  }
+  m_recombinationHash = seed;
+
   m_totalScore	= m_scoreBreakdown.GetWeightedScore();
 }
 
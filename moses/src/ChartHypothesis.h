@@ -50,6 +50,7 @@ protected:
 
   WordsRange					m_currSourceWordsRange;
 	std::vector<const FFState*> m_ffStates; /*! stateful feature function states */
+  size_t m_recombinationHash; /*! hash of the feature states, set by CalcScore() */
   ScoreComponentCollection m_scoreBreakdown /*! detailed score break-down by components (for instance language model, word penalty, etc) */
   ,m_lmNGram
   ,m_lmPrefix;
@@ -109,6 +110,15 @@ public:
 
 	int RecombineCompare(const ChartHypothesis &compare) const;
 
+  //! same as RecombineCompare(compare) == 0, checking the cached hashes first
+  bool RecombineEqual(const ChartHypothesis &compare) const;
+
+  /** hash over what RecombineCompare() looks at: hypotheses that would be
+   * recombined have the same hash */
+  size_t GetRecombinationHash() const {
+    return m_recombinationHash;
+  }
+
   void CalcScore();
 
   void AddArc(ChartHypothesis *loserHypo);
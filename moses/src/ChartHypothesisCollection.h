@@ -22,6 +22,7 @@
 
 #include <set>
 #include "ChartHypothesis.h"
+#include "RecombinationTable.h"
 #include "RuleCube.h"
 
 
@@ -57,13 +58,29 @@ public:
   }
 };
 
+/** equality counterpart of ChartHypothesisRecombinationOrderer, for hash
+ * tables keyed on ChartHypothesis::GetRecombinationHash() */
+class ChartHypothesisRecombinationEqual
+{
+public:
+  bool operator()(const ChartHypothesis* hypoA, const ChartHypothesis* hypoB) const {
+    // assert in same cell
+    CHECK(hypoA->GetCurrSourceRange() == hypoB->GetCurrSourceRange());
+
+    // shouldn't be mixing hypos with different lhs
+    CHECK(hypoA->GetTargetLHS() == hypoB->GetTargetLHS());
+
+    return hypoA->RecombineEqual(*hypoB);
+  }
+};
+
 // 1 of these for each target LHS in each cell
 class ChartHypothesisCollection
 {
   friend std::ostream& operator<<(std::ostream&, const ChartHypothesisCollection&);
 
 protected:
-  typedef std::set<ChartHypothesis*, ChartHypothesisRecombinationOrderer> HCType;
+  typedef RecombinationTable<ChartHypothesis, ChartHypothesisRecombinationEqual> HCType;
   HCType m_hypos;
   HypoList m_hyposOrdered;
 
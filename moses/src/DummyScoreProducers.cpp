@@ -4,6 +4,7 @@
 #include "FFState.h"
 #include "StaticData.h"
 #include "DummyScoreProducers.h"
+#include "Manager.h"
 #include "WordsRange.h"
 #include "TranslationOption.h"
 
@@ -21,6 +22,12 @@ struct DistortionState_traditional : public FFState {
     if (range.GetEndPos() > o.range.GetEndPos()) return 1;
     return 0;
   }
+  size_t Hash() const {
+    return range.GetEndPos();
+  }
+  bool Equal(const FFState& other) const {
+    return range.GetEndPos() == static_cast<const DistortionState_traditional&>(other).range.GetEndPos();
+  }
 };
 
 const FFState* DistortionScoreProducer::EmptyHypothesisState(const InputType &input) const
@@ -102,7 +109,7 @@ FFState* DistortionScoreProducer::Evaluate(
                                   hypo.GetCurrSourceWordsRange(),
                                   prev->first_gap);
   out->PlusEquals(this, distortionScore);
-  DistortionState_traditional* res = new DistortionState_traditional(
+  DistortionState_traditional* res = new (hypo.GetArena()) DistortionState_traditional(
     hypo.GetCurrSourceWordsRange(),
     hypo.GetPrevHypo()->GetWordsBitmap().GetFirstGapPos());
   return res;
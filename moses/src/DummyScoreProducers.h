@@ -25,6 +25,10 @@ public:
   std::string GetScoreProducerWeightShortName(unsigned) const;
   size_t GetNumInputScores() const;
 
+  virtual bool IsSearchThreadSafe() const {
+    return true;
+  }
+
   virtual const FFState* EmptyHypothesisState(const InputType &input) const;
 
   virtual FFState* Evaluate(
@@ -54,6 +58,10 @@ public:
   std::string GetScoreProducerWeightShortName(unsigned) const;
   size_t GetNumInputScores() const;
 
+  virtual bool IsSearchThreadSafe() const {
+    return true;
+  }
+
   virtual void Evaluate(
     const TargetPhrase& phrase,
     ScoreComponentCollection* out) const;
@@ -1,9 +1,28 @@
 #include "FFState.h"
+#include "MemoryArena.h"
 
 namespace Moses
 {
 
 FFState::~FFState() {}
 
+void *FFState::operator new(size_t size, MemoryArena &arena)
+{
+  return arena.Allocate(size);
+}
+
+void FFState::operator delete(void *, MemoryArena &)
+{
+  // arena memory is reclaimed with the arena
 }
 
+void FFState::Destroy(const FFState *state, const MemoryArena &arena)
+{
+  if (state == NULL) return;
+  if (arena.Contains(state))
+    state->~FFState();
+  else
+    delete state;
+}
+
+}
@@ -2,17 +2,45 @@
 #define moses_FFState_h
 
 #include "util/check.hh"
+#include <cstddef>
 #include <vector>
 
 
 namespace Moses
 {
 
+class MemoryArena;
+
 class FFState
 {
 public:
   virtual ~FFState();
   virtual int Compare(const FFState& other) const = 0;
+
+  /** hash consistent with Compare(): states comparing equal must hash
+   * equally. Used to find recombinable hypotheses in hash tables.
+   */
+  virtual size_t Hash() const = 0;
+
+  //! same as Compare(other) == 0, without having to establish an order
+  virtual bool Equal(const FFState& other) const = 0;
+
+  /** The phrase-based search lets features create states in the arena of
+   * the hypothesis, with new (hypo.GetArena()) State(...). Those must be
+   * released with Destroy(), which only runs their destructor. Plain new
+   * and delete are unchanged.
+   */
+  static void *operator new(size_t size) {
+    return ::operator new(size);
+  }
+  static void operator delete(void *ptr) {
+    ::operator delete(ptr);
+  }
+  static void *operator new(size_t size, MemoryArena &arena);
+  static void operator delete(void *ptr, MemoryArena &arena);
+
+  //! release state, created either with plain new or in arena
+  static void Destroy(const FFState *state, const MemoryArena &arena);
 };
 
 }
@@ -20,10 +20,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <boost/version.hpp>
+#include <algorithm>
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
 #include "Util.h"
+#include "util/check.hh"
 
 using namespace std;
 
@@ -31,7 +33,67 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
+namespace
+{
+//! hash of a string that was computed before
+struct KnownHash {
+  explicit KnownHash(std::size_t hash) : m_hash(hash) {}
+  std::size_t operator()(const StringPiece &) const {
+    return m_hash;
+  }
+  std::size_t m_hash;
+};
+}
+
+#ifdef WITH_THREADS
+FactorCollection::HitCache::HitCache()
+{
+  const Entry empty = { 0, NULL };
+  for (size_t set = 0; set < Sets; ++set) {
+    std::fill(entries[set], entries[set] + Ways, empty);
+  }
+}
+#endif
+
+FactorCollection::FactorCollection()
+  :m_indexMemory(util::MapAnonymous(MaxFactors * sizeof(const Factor*)), MaxFactors * sizeof(const Factor*))
+  ,m_index(static_cast<const Factor**>(m_indexMemory.get()))
+  ,m_factorId(0)
+{
+}
+
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString)
+{
+  const std::size_t hash = HashFactor()(factorString);
+#ifdef WITH_THREADS
+  HitCache *cache = m_hitCache.get();
+  if (cache == NULL) {
+    cache = new HitCache;
+    m_hitCache.reset(cache);
+  }
+  HitCache::Entry *set = cache->entries[hash & (HitCache::Sets - 1)];
+  for (size_t way = 0; way < HitCache::Ways; ++way) {
+    if (set[way].hash == hash && set[way].factor != NULL && set[way].factor->GetString() == factorString) {
+      const HitCache::Entry hit = set[way];
+      if (way > 0) {
+        set[way] = set[way - 1];
+        set[way - 1] = hit;
+      }
+      return hit.factor;
+    }
+  }
+  HitCache::Entry added = { hash, FindOrAdd(factorString, hash) };
+  for (size_t way = HitCache::Ways - 1; way > HitCache::Ways / 2; --way) {
+    set[way] = set[way - 1];
+  }
+  set[HitCache::Ways / 2] = added;
+  return added.factor;
+#else
+  return FindOrAdd(factorString, hash);
+#endif
+}
+
+const Factor *FactorCollection::FindOrAdd(const StringPiece &factorString, std::size_t hash)
 {
 // Sorry this is so complicated.  Can't we just require everybody to use Boost >= 1.42?  The issue is that I can't check BOOST_VERSION unless we have Boost.  
 #ifdef WITH_THREADS
@@ -43,7 +105,7 @@ const Factor *FactorCollection::AddFactor(const StringPiece &factorString)
     boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
 #if BOOST_VERSION >= 104200
     // If this line doesn't compile, upgrade your Boost.  
-    Set::const_iterator i = m_set.find(factorString, HashFactor(), EqualsFactor());
+    Set::const_iterator i = m_set.find(factorString, KnownHash(hash), EqualsFactor());
 #else // BOOST_VERSION
     Set::const_iterator i = m_set.find(to_ins);
 #endif // BOOST_VERSION
@@ -61,6 +123,9 @@ const Factor *FactorCollection::AddFactor(const StringPiece &factorString)
   to_ins.in.m_id = m_factorId;
   std::pair<Set::iterator, bool> ret(m_set.insert(to_ins));
   if (ret.second) {
+    // index the new factor by its id
+    CHECK(m_factorId < MaxFactors);
+    m_index[m_factorId] = &ret.first->in;
     m_factorId++;
   }
   return &ret.first->in;
@@ -24,8 +24,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/tss.hpp>
 #endif
 
+#include "util/mmap.hh"
 #include "util/murmur_hash.hh"
 #include <boost/unordered_set.hpp>
 
@@ -87,14 +89,39 @@ class FactorCollection
 #ifdef WITH_THREADS
   //reader-writer lock
   mutable boost::shared_mutex m_accessLock;
+
+  /** factors this thread added before, in a 4-way set associative table
+   * indexed by the hash of their string (1 MiB per thread). Factors are never
+   * removed or changed, so a factor found here is returned without taking the
+   * lock. A hit moves up one way and a miss enters half way down the set,
+   * so that frequent words are not evicted by words seen once */
+  struct HitCache {
+    enum { Ways = 4, Sets = 1 << 14 };
+    struct Entry {
+      std::size_t hash;
+      const Factor *factor;
+    };
+    HitCache();
+    Entry entries[Sets][Ways];
+  };
+  boost::thread_specific_ptr<HitCache> m_hitCache;
 #endif
 
+  /** factors by id. The whole index is mapped by the constructor, before
+   * any other thread can run, and only touched pages take memory. A slot is
+   * written under the lock before its id is returned, so readers need no
+   * lock and no block pointer is ever published to them */
+  enum { MaxFactors = sizeof(void*) >= 8 ? (1 << 27) : (1 << 24) };
+  util::scoped_mmap m_indexMemory;
+  const Factor **m_index;
+
   size_t m_factorId; /**< unique, contiguous ids, starting from 0, for each factor */
 
   //! constructor. only the 1 static variable can be created
-  FactorCollection()
-    :m_factorId(0)
-  {}
+  FactorCollection();
+
+  //! look up the factor in the set, adding it if it's not there
+  const Factor *FindOrAdd(const StringPiece &factorString, std::size_t hash);
 
 public:
   static FactorCollection& Instance() {
@@ -108,6 +135,12 @@ public:
   */
   const Factor *AddFactor(const StringPiece &factorString);
 
+  /** the factor with this id. The id has to be of a factor returned by
+   * AddFactor(), which makes it safe to call without a lock */
+  const Factor *GetFactor(size_t id) const {
+    return m_index[id];
+  }
+
   // TODO: remove calls to this function, replacing them with the simpler AddFactor(factorString)
   const Factor *AddFactor(FactorDirection /*direction*/, FactorType /*factorType*/, const StringPiece &factorString) {
     return AddFactor(factorString);
@@ -7,6 +7,11 @@ namespace Moses
 
 FeatureFunction::~FeatureFunction() {}
 
+bool FeatureFunction::IsSearchThreadSafe() const
+{
+  return false;
+}
+
 bool StatelessFeatureFunction::IsStateless() const
 {
   return true;
@@ -8,6 +8,7 @@
 namespace Moses
 {
 
+class Phrase;
 class TargetPhrase;
 class Hypothesis;
 class ChartHypothesis;
@@ -22,6 +23,12 @@ public:
   virtual bool IsStateless() const = 0;
   virtual ~FeatureFunction();
 
+  /** whether the search may evaluate this feature on several threads at
+   * once (see -search-threads). State a feature keeps per thread must be set
+   * up by TranslationSystem::InitializeSearchThread().
+   * Default: false */
+  virtual bool IsSearchThreadSafe() const;
+
 };
 
 class StatelessFeatureFunction: public FeatureFunction
@@ -67,6 +74,14 @@ public:
   //! return the state associated with the empty hypothesis for a given sentence
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
+  /**
+   * Hint that a hypothesis with state prev_state will soon be extended by
+   * targetPhrase.  Features whose Evaluate() reads a large table can start
+   * loading what it will need, so the search can overlap those cache misses
+   * with other work.  Must not change any result.
+   */
+  virtual void Prefetch(const FFState* /* prev_state */, const Phrase& /* targetPhrase */) const {}
+
   bool IsStateless() const;
 };
 
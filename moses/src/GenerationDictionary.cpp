@@ -21,11 +21,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <fstream>
 #include <string>
+#include "util/check.hh"
 #include "GenerationDictionary.h"
 #include "FactorCollection.h"
 #include "Word.h"
 #include "Util.h"
 #include "InputFileStream.h"
+#include "ModelSnapshot.h"
 #include "StaticData.h"
 #include "UserMessage.h"
 
@@ -47,6 +49,17 @@ bool GenerationDictionary::Load(const std::string &filePath, FactorDirection dir
 
   const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
 
+  m_filePath = filePath;
+
+  // restore the table from its image if there is one for these settings
+  ModelSnapshot *snapshot = StaticData::Instance().GetModelSnapshot();
+  if (snapshot) {
+    SnapshotReader reader;
+    if (snapshot->Open(reader, "generation-table", filePath, GetSnapshotSettings())) {
+      Restore(reader);
+      return true;
+    }
+  }
 
   // data from file
   InputFileStream inFile(filePath);
@@ -55,7 +68,6 @@ bool GenerationDictionary::Load(const std::string &filePath, FactorDirection dir
     return false;
   }
 
-  m_filePath = filePath;
   string line;
   size_t lineNum = 0;
   while(getline(inFile, line)) {
@@ -107,9 +119,61 @@ bool GenerationDictionary::Load(const std::string &filePath, FactorDirection dir
   }
 
   inFile.Close();
+
+  if (snapshot) {
+    SnapshotWriter writer;
+    if (snapshot->Create(writer, "generation-table", filePath, GetSnapshotSettings())) {
+      Snapshot(writer);
+      snapshot->Commit(writer);
+    }
+  }
   return true;
 }
 
+std::string GenerationDictionary::GetSnapshotSettings() const
+{
+  std::ostringstream settings;
+  settings << "factors=";
+  ModelSnapshot::AddFactors(settings, GetInput());
+  settings << "/";
+  ModelSnapshot::AddFactors(settings, GetOutput());
+  settings << " scores=" << GetNumScoreComponents();
+  return settings.str();
+}
+
+void GenerationDictionary::Snapshot(SnapshotWriter &writer) const
+{
+  writer.WriteSize(m_collection.size());
+  for (Collection::const_iterator iter = m_collection.begin(); iter != m_collection.end(); ++iter) {
+    writer.WriteWord(*iter->first);
+    const OutputWordCollection &outputWords = iter->second;
+    writer.WriteSize(outputWords.size());
+    for (OutputWordCollection::const_iterator iterOutput = outputWords.begin(); iterOutput != outputWords.end(); ++iterOutput) {
+      writer.WriteWord(iterOutput->first);
+      writer.WriteScores(iterOutput->second.GetScoresForProducer(this));
+    }
+  }
+}
+
+void GenerationDictionary::Restore(SnapshotReader &reader)
+{
+  std::vector<float> scores;
+  const size_t size = reader.ReadSize();
+  for (size_t i = 0; i < size; ++i) {
+    Word *inputWord = new Word();  // deleted in destructor
+    reader.ReadWord(*inputWord);
+    OutputWordCollection &outputWords = m_collection[inputWord];
+    const size_t numOutputWords = reader.ReadSize();
+    for (size_t j = 0; j < numOutputWords; ++j) {
+      Word outputWord;
+      reader.ReadWord(outputWord);
+      reader.ReadScores(scores);
+      outputWords[outputWord].Assign(this, scores);
+    }
+  }
+  CHECK(reader.AtEnd());
+}
+
 GenerationDictionary::~GenerationDictionary()
 {
   Collection::const_iterator iter;
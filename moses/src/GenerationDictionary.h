@@ -35,6 +35,8 @@ namespace Moses
 {
 
 class FactorCollection;
+class SnapshotReader;
+class SnapshotWriter;
 
 typedef std::map < Word , ScoreComponentCollection > OutputWordCollection;
 // 1st = output phrase
@@ -51,6 +53,11 @@ protected:
   // 2nd = target
   std::string						m_filePath;
 
+  //! settings the table depends on, for its model image
+  std::string GetSnapshotSettings() const;
+  void Snapshot(SnapshotWriter &writer) const;
+  void Restore(SnapshotReader &reader);
+
 public:
   /** constructor.
   * \param numFeatures number of score components, as specified in ini file
@@ -3,6 +3,8 @@
 #include "StaticData.h"
 #include "InputFileStream.h"
 #include "UserMessage.h"
+#include "ModelSnapshot.h"
+#include "util/check.hh"
 
 using namespace std;
 
@@ -56,6 +58,35 @@ void GlobalLexicalModel::LoadData(const string &filePath,
 
   m_inputFactors = FactorMask(inFactors);
   m_outputFactors = FactorMask(outFactors);
+
+  // restore the model from its image if there is one for these settings
+  ModelSnapshot *snapshot = StaticData::Instance().GetModelSnapshot();
+  std::ostringstream settings;
+  if (snapshot) {
+    settings << "factors=";
+    ModelSnapshot::AddFactors(settings, inFactors);
+    settings << "/";
+    ModelSnapshot::AddFactors(settings, outFactors);
+
+    SnapshotReader reader;
+    if (snapshot->Open(reader, "global-lexical-model", filePath, settings.str())) {
+      const size_t numOutWords = reader.ReadSize();
+      for (size_t i = 0; i < numOutWords; ++i) {
+        Word *outWord = new Word();
+        reader.ReadWord(*outWord);
+        SingleHash &inWords = m_hash[outWord];
+        const size_t numInWords = reader.ReadSize();
+        for (size_t j = 0; j < numInWords; ++j) {
+          Word *inWord = new Word();
+          reader.ReadWord(*inWord);
+          inWords[inWord] = reader.ReadFloat();
+        }
+      }
+      CHECK(reader.AtEnd());
+      return;
+    }
+  }
+
   InputFileStream inFile(filePath);
 
   // reading in data one line at a time
@@ -106,6 +137,22 @@ void GlobalLexicalModel::LoadData(const string &filePath,
       delete outWord;
     }
   }
+
+  if (snapshot) {
+    SnapshotWriter writer;
+    if (snapshot->Create(writer, "global-lexical-model", filePath, settings.str())) {
+      writer.WriteSize(m_hash.size());
+      for (DoubleHash::const_iterator iter = m_hash.begin(); iter != m_hash.end(); ++iter) {
+        writer.WriteWord(*iter->first);
+        writer.WriteSize(iter->second.size());
+        for (SingleHash::const_iterator iter2 = iter->second.begin(); iter2 != iter->second.end(); ++iter2) {
+          writer.WriteWord(*iter2->first);
+          writer.WriteFloat(iter2->second);
+        }
+      }
+      snapshot->Commit(writer);
+    }
+  }
 }
 
 void GlobalLexicalModel::InitializeForInput( Sentence const& in )
@@ -85,6 +85,11 @@ public:
 
   void InitializeForInput( Sentence const& in );
 
+  //! the input and the cache are per thread, see TranslationSystem::InitializeSearchThread()
+  virtual bool IsSearchThreadSafe() const {
+    return true;
+  }
+
   void Evaluate(const TargetPhrase&, ScoreComponentCollection* ) const;
 };
 
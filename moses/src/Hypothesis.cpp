@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <vector>
 #include <algorithm>
+#include <boost/functional/hash.hpp>
 
 #include "FFState.h"
 #include "TranslationOption.h"
@@ -44,9 +45,34 @@ using namespace std;
 namespace Moses
 {
 
-#ifdef USE_HYPO_POOL
-ObjectPool<Hypothesis> Hypothesis::s_objectPool("Hypothesis", 300000);
-#endif
+void *Hypothesis::operator new(size_t size, Manager &manager)
+{
+  CHECK(size == sizeof(Hypothesis));
+  return manager.AllocateHypothesis();
+}
+
+void Hypothesis::operator delete(void *ptr, Manager &manager)
+{
+  manager.FreeHypothesis(ptr);
+}
+
+void *Hypothesis::operator new(size_t size, MemoryArena &workerArena)
+{
+  CHECK(size == sizeof(Hypothesis));
+  return workerArena.Allocate(sizeof(Hypothesis));
+}
+
+void Hypothesis::operator delete(void *, MemoryArena &)
+{
+  // arena memory is released with the arena
+}
+
+void Hypothesis::Destroy(Hypothesis *hypo)
+{
+  Manager &manager = hypo->m_manager;
+  hypo->~Hypothesis();
+  manager.FreeHypothesis(hypo);
+}
 
 Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget)
   : m_prevHypo(NULL)
@@ -60,11 +86,12 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
   , m_currTargetWordsRange(0, emptyTarget.GetSize()-1)
   , m_wordDeleted(false)
   , m_ffStates(manager.GetTranslationSystem()->GetStatefulFeatureFunctions().size())
+  , m_recombinationHash(0)
   , m_arcList(NULL)
   , m_transOpt(NULL)
   , m_manager(manager)
-
-  , m_id(m_manager.GetNextHypoId())
+  , m_arena(manager.GetArena())
+  , m_id(-1)
 {
   // used for initial seeding of trans process
   // initialize scores
@@ -74,13 +101,14 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
   const vector<const StatefulFeatureFunction*>& ffs = m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i)
     m_ffStates[i] = ffs[i]->EmptyHypothesisState(source);
-  m_manager.GetSentenceStats().AddCreated();
+  ComputeRecombinationHash();
+  Register();
 }
 
 /***
  * continue prevHypo by appending the phrases in transOpt
  */
-Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt)
+Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, MemoryArena *workerArena)
   : m_prevHypo(&prevHypo)
   , m_targetPhrase(transOpt.GetTargetPhrase())
   , m_sourcePhrase(transOpt.GetSourcePhrase())
@@ -94,10 +122,12 @@ Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &tran
   ,	m_futureScore(0.0f)
   , m_scoreBreakdown				(prevHypo.m_scoreBreakdown)
   , m_ffStates(prevHypo.m_ffStates.size())
+  , m_recombinationHash(0)
   , m_arcList(NULL)
   , m_transOpt(&transOpt)
   , m_manager(prevHypo.GetManager())
-  , m_id(m_manager.GetNextHypoId())
+  , m_arena(workerArena ? *workerArena : prevHypo.GetManager().GetArena())
+  , m_id(-1)
 {
   // assert that we are not extending our hypothesis by retranslating something
   // that this hypothesis has already translated!
@@ -106,26 +136,31 @@ Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &tran
   //_hash_computed = false;
   m_sourceCompleted.SetValue(m_currSourceWordsRange.GetStartPos(), m_currSourceWordsRange.GetEndPos(), true);
   m_wordDeleted = transOpt.IsDeletionOption();
-  m_manager.GetSentenceStats().AddCreated();
+  if (workerArena == NULL)
+    Register();
 }
 
 Hypothesis::~Hypothesis()
 {
   for (unsigned i = 0; i < m_ffStates.size(); ++i)
-    delete m_ffStates[i];
+    FFState::Destroy(m_ffStates[i], m_arena);
 
   if (m_arcList) {
     ArcList::iterator iter;
     for (iter = m_arcList->begin() ; iter != m_arcList->end() ; ++iter) {
       FREEHYPO(*iter);
     }
-    m_arcList->clear();
-
-    delete m_arcList;
+    m_arcList->~ArcList();
     m_arcList = NULL;
   }
 }
 
+void Hypothesis::Register()
+{
+  m_id = m_manager.GetNextHypoId();
+  m_manager.GetSentenceStats().AddCreated();
+}
+
 void Hypothesis::AddArc(Hypothesis *loserHypo)
 {
   if (!m_arcList) {
@@ -133,7 +168,8 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
       this->m_arcList = loserHypo->m_arcList;  // take ownership, we'll delete
       loserHypo->m_arcList = 0;                // prevent a double deletion
     } else {
-      this->m_arcList = new ArcList();
+      MemoryArena &arena = m_manager.GetArena();
+      this->m_arcList = new (arena.Allocate(sizeof(ArcList))) ArcList(ArenaAllocator<Hypothesis*>(arena));
     }
   } else {
     if (loserHypo->m_arcList) {  // both have an arc list: merge. delete loser
@@ -141,7 +177,7 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
       size_t add_size = loserHypo->m_arcList->size();
       this->m_arcList->resize(my_size + add_size, 0);
       std::memcpy(&(*m_arcList)[0] + my_size, &(*loserHypo->m_arcList)[0], add_size * sizeof(Hypothesis *));
-      delete loserHypo->m_arcList;
+      loserHypo->m_arcList->~ArcList();
       loserHypo->m_arcList = 0;
     } else { // loserHypo doesn't have any arcs
       // DO NOTHING
@@ -153,15 +189,15 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
 /***
  * return the subclass of Hypothesis most appropriate to the given translation option
  */
-Hypothesis* Hypothesis::CreateNext(const TranslationOption &transOpt, const Phrase* constraint) const
+Hypothesis* Hypothesis::CreateNext(const TranslationOption &transOpt, const Phrase* constraint, MemoryArena *workerArena) const
 {
-  return Create(*this, transOpt, constraint);
+  return Create(*this, transOpt, constraint, workerArena);
 }
 
 /***
  * return the subclass of Hypothesis most appropriate to the given translation option
  */
-Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constrainingPhrase)
+Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constrainingPhrase, MemoryArena *workerArena)
 {
 
   // This method includes code for constraint decoding
@@ -197,12 +233,9 @@ Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOpti
 
   if (createHypothesis) {
 
-#ifdef USE_HYPO_POOL
-    Hypothesis *ptr = s_objectPool.getPtr();
-    return new(ptr) Hypothesis(prevHypo, transOpt);
-#else
-    return new Hypothesis(prevHypo, transOpt);
-#endif
+    if (workerArena)
+      return new (*workerArena) Hypothesis(prevHypo, transOpt, workerArena);
+    return new (prevHypo.GetManager()) Hypothesis(prevHypo, transOpt, NULL);
 
   } else {
     // If the previous hypothesis plus the proposed translation option
@@ -218,12 +251,7 @@ Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOpti
 
 Hypothesis* Hypothesis::Create(Manager& manager, InputType const& m_source, const TargetPhrase &emptyTarget)
 {
-#ifdef USE_HYPO_POOL
-  Hypothesis *ptr = s_objectPool.getPtr();
-  return new(ptr) Hypothesis(manager, m_source, emptyTarget);
-#else
-  return new Hypothesis(manager, m_source, emptyTarget);
-#endif
+  return new (manager) Hypothesis(manager, m_source, emptyTarget);
 }
 
 /** check, if two hypothesis can be recombined.
@@ -252,6 +280,32 @@ int Hypothesis::RecombineCompare(const Hypothesis &compare) const
   return 0;
 }
 
+bool Hypothesis::RecombineEqual(const Hypothesis &compare) const
+{
+  if (m_recombinationHash != compare.m_recombinationHash)
+    return false;
+  if (!(m_sourceCompleted == compare.m_sourceCompleted))
+    return false;
+
+  for (size_t i = 0; i < m_ffStates.size(); ++i) {
+    if (m_ffStates[i] == NULL || compare.m_ffStates[i] == NULL) {
+      if (m_ffStates[i] != compare.m_ffStates[i]) return false;
+    } else if (!m_ffStates[i]->Equal(*compare.m_ffStates[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Hypothesis::ComputeRecombinationHash()
+{
+  size_t seed = m_sourceCompleted.GetHash();
+  for (size_t i = 0; i < m_ffStates.size(); ++i) {
+    boost::hash_combine(seed, m_ffStates[i] ? m_ffStates[i]->Hash() : 0);
+  }
+  m_recombinationHash = seed;
+}
+
 void Hypothesis::ResetScore()
 {
   m_scoreBreakdown.ZeroAll();
@@ -288,6 +342,7 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
                       m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL,
                       &m_scoreBreakdown);
   }
+  ComputeRecombinationHash();
 
   IFVERBOSE(2) {
     t = clock();  // track time excluding LM
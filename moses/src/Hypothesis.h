@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "GenerationDictionary.h"
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
-#include "ObjectPool.h"
+#include "MemoryArena.h"
 
 namespace Moses
 {
@@ -48,7 +48,8 @@ class FFState;
 class Manager;
 class LexicalReordering;
 
-typedef std::vector<Hypothesis*> ArcList;
+//! arcs live in the arena of the Manager that created the hypotheses
+typedef std::vector<Hypothesis*, ArenaAllocator<Hypothesis*> > ArcList;
 
 /** Used to store a state in the beam search
     for the best translation. With its link back to the previous hypothesis
@@ -63,8 +64,6 @@ class Hypothesis
   friend std::ostream& operator<<(std::ostream&, const Hypothesis&);
 
 protected:
-  static ObjectPool<Hypothesis> s_objectPool;
-
   const Hypothesis* m_prevHypo; /*! backpointer to previous hypothesis (from which this one was created) */
 //	const Phrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
   const TargetPhrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
@@ -80,27 +79,37 @@ protected:
   float							m_futureScore; /*! estimated future cost to translate rest of sentence */
   ScoreComponentCollection m_scoreBreakdown; /*! detailed score break-down by components (for instance language model, word penalty, etc) */
   std::vector<const FFState*> m_ffStates;
+  size_t m_recombinationHash; /*! hash of coverage and feature states, set once the states are known */
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
   const TranslationOption *m_transOpt;
   Manager& m_manager;
+  MemoryArena& m_arena; /*! holds the feature states, and the hypothesis itself if a search worker built it */
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
 
   /*! used by initial seeding of the translation process */
   Hypothesis(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget);
   /*! used when creating a new hypothesis using a translation option (phrase translation) */
-  Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt);
+  Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, MemoryArena *workerArena);
 
-public:
-  static ObjectPool<Hypothesis> &GetObjectPool() {
-    return s_objectPool;
-  }
+  void *operator new(size_t size, Manager &manager);
+  void operator delete(void *ptr, Manager &manager);
+  void *operator new(size_t size, MemoryArena &workerArena);
+  void operator delete(void *ptr, MemoryArena &workerArena);
 
+  void ComputeRecombinationHash();
+
+public:
   ~Hypothesis();
 
-  /** return the subclass of Hypothesis most appropriate to the given translation option */
-  static Hypothesis* Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constraint);
+  /** destroy a hypothesis made by Create(). Its memory stays in the arena of
+   * its Manager and is reused for the next hypothesis */
+  static void Destroy(Hypothesis *hypo);
+
+  /** return the subclass of Hypothesis most appropriate to the given translation option.
+   * A search worker passes its arena, the hypothesis is then numbered when added to a stack */
+  static Hypothesis* Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constraint, MemoryArena *workerArena = NULL);
 
   static Hypothesis* Create(Manager& manager, const WordsBitmap &initialCoverage);
 
@@ -108,7 +117,7 @@ public:
   static Hypothesis* Create(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget);
 
   /** return the subclass of Hypothesis most appropriate to the given translation option */
-  Hypothesis* CreateNext(const TranslationOption &transOpt, const Phrase* constraint) const;
+  Hypothesis* CreateNext(const TranslationOption &transOpt, const Phrase* constraint, MemoryArena *workerArena = NULL) const;
 
   void PrintHypothesis() const;
 
@@ -137,6 +146,11 @@ public:
     return m_manager;
   }
 
+  //! where features allocate the states of this hypothesis
+  MemoryArena& GetArena() const {
+    return m_arena;
+  }
+
   /** output length of the translation option used to create this hypothesis */
   inline size_t GetCurrTargetLength() const {
     return m_currTargetWordsRange.GetNumWordsCovered();
@@ -153,6 +167,11 @@ public:
     return m_id;
   }
 
+  /** number this hypothesis and count it as created. Done on construction,
+   * except for hypotheses built by search worker threads, which are
+   * registered in a deterministic order when they are added to a stack */
+  void Register();
+
   const Hypothesis* GetPrevHypo() const;
 
   /** length of the partial translation (from the start of the sentence) */
@@ -190,6 +209,10 @@ public:
   inline const Factor* GetFactor(size_t pos, FactorType factorType) const {
     return GetWord(pos)[factorType];
   }
+  //! state of the stateful feature function featureID, may be NULL
+  inline const FFState* GetFFState(size_t featureID) const {
+    return m_ffStates[featureID];
+  }
 
   /***
    * \return The bitmap of source words we cover
@@ -204,6 +227,15 @@ public:
 
   int RecombineCompare(const Hypothesis &compare) const;
 
+  //! same as RecombineCompare(compare) == 0, checking the cached hashes first
+  bool RecombineEqual(const Hypothesis &compare) const;
+
+  /** hash over what RecombineCompare() looks at: hypotheses that would be
+   * recombined have the same hash */
+  size_t GetRecombinationHash() const {
+    return m_recombinationHash;
+  }
+
   void ToStream(std::ostream& out) const {
     if (m_prevHypo != NULL) {
       m_prevHypo->ToStream(out);
@@ -261,17 +293,7 @@ struct CompareHypothesisTotalScore {
   }
 };
 
-#ifdef USE_HYPO_POOL
-
-#define FREEHYPO(hypo) \
-{ \
-	ObjectPool<Hypothesis> &pool = Hypothesis::GetObjectPool(); \
-	pool.freeObject(hypo); \
-} \
- 
-#else
-#define FREEHYPO(hypo) delete hypo
-#endif
+#define FREEHYPO(hypo) Hypothesis::Destroy(hypo)
 
 /** defines less-than relation on hypotheses.
 * The particular order is not important for us, we need just to figure out
@@ -290,5 +312,15 @@ public:
   }
 };
 
+/** equality counterpart of HypothesisRecombinationOrderer, for hash tables
+ * keyed on Hypothesis::GetRecombinationHash() */
+class HypothesisRecombinationEqual
+{
+public:
+  bool operator()(const Hypothesis* hypoA, const Hypothesis* hypoB) const {
+    return hypoA->RecombineEqual(*hypoB);
+  }
+};
+
 }
 #endif
@@ -6,9 +6,10 @@ namespace Moses
 HypothesisStack::~HypothesisStack()
 {
   // delete all hypos
-  while (m_hypos.begin() != m_hypos.end()) {
-    Remove(m_hypos.begin());
+  for (iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    FREEHYPO(*iter);
   }
+  m_hypos.clear();
 }
 
 /** Remove hypothesis pointed to by iterator but don't delete the object. */
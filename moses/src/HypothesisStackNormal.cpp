@@ -20,8 +20,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <algorithm>
-#include <set>
-#include <queue>
 #include "HypothesisStackNormal.h"
 #include "TypeDef.h"
 #include "Util.h"
@@ -43,9 +41,10 @@ HypothesisStackNormal::HypothesisStackNormal(Manager& manager) :
 /** remove all hypotheses from the collection */
 void HypothesisStackNormal::RemoveAll()
 {
-  while (m_hypos.begin() != m_hypos.end()) {
-    Remove(m_hypos.begin());
+  for (iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    FREEHYPO(*iter);
   }
+  m_hypos.clear();
 }
 
 pair<HypothesisStackNormal::iterator, bool> HypothesisStackNormal::Add(Hypothesis *hypo)
@@ -149,59 +148,68 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
   if ( size() <= newSize ) return; // ok, if not over the limit
 
   // we need to store a temporary list of hypotheses
-  vector< Hypothesis* > hypos = GetSortedListNOTCONST();
-  bool* included = (bool*) malloc(sizeof(bool) * hypos.size());
-  for(size_t i=0; i<hypos.size(); i++) included[i] = false;
+  vector< Hypothesis* > hypos(m_hypos.begin(), m_hypos.end());
 
   // clear out original set
-  for( iterator iter = m_hypos.begin(); iter != m_hypos.end(); ) {
-    iterator removeHyp = iter++;
-    Detach(removeHyp);
-  }
+  m_hypos.clear();
+
+  if ( m_minHypoStackDiversity == 0 ) {
+    // move the best newSize hypotheses to the front, in no particular order
+    nth_element(hypos.begin(), hypos.begin() + (newSize - 1), hypos.end(), CompareHypothesisTotalScore());
+    const float threshold = m_bestScore + m_beamWidth;
+    if (hypos[newSize - 1]->GetTotalScore() > threshold)
+      m_worstScore = hypos[newSize - 1]->GetTotalScore();
+    for(size_t i=0; i<hypos.size(); i++) {
+      if (i < newSize && hypos[i]->GetTotalScore() > threshold) {
+        m_hypos.insert( hypos[i] );
+      } else {
+        FREEHYPO( hypos[i] );
+        m_manager.GetSentenceStats().AddPruning();
+      }
+    }
+  } else {
+    sort(hypos.begin(), hypos.end(), CompareHypothesisTotalScore());
+    vector< bool > included(hypos.size(), false);
 
-  // add best hyps for each coverage according to minStackDiversity
-  if ( m_minHypoStackDiversity > 0 ) {
-    map< WordsBitmapID, size_t > diversityCount;
+    // add best hyps for each coverage according to minStackDiversity
+    boost::unordered_map< WordsBitmapID, size_t > diversityCount;
     for(size_t i=0; i<hypos.size(); i++) {
       Hypothesis *hyp = hypos[i];
-      WordsBitmapID coverage = hyp->GetWordsBitmap().GetID();;
-      if (diversityCount.find( coverage ) == diversityCount.end())
-        diversityCount[ coverage ] = 0;
-
-      if (diversityCount[ coverage ] < m_minHypoStackDiversity) {
+      WordsBitmapID coverage = hyp->GetWordsBitmap().GetID();
+      size_t &count = diversityCount[ coverage ];
+      if (count < m_minHypoStackDiversity) {
         m_hypos.insert( hyp );
         included[i] = true;
-        diversityCount[ coverage ]++;
-        if (diversityCount[ coverage ] == m_minHypoStackDiversity)
+        count++;
+        if (count == m_minHypoStackDiversity)
           SetWorstScoreForBitmap( coverage, hyp->GetTotalScore());
       }
     }
-  }
 
-  // only add more if stack not full after satisfying minStackDiversity
-  if ( size() < newSize ) {
-
-    // add best remaining hypotheses
-    for(size_t i=0; i<hypos.size()
-        && size() < newSize
-        && hypos[i]->GetTotalScore() > m_bestScore+m_beamWidth; i++) {
-      if (! included[i]) {
-        m_hypos.insert( hypos[i] );
-        included[i] = true;
-        if (size() == newSize)
-          m_worstScore = hypos[i]->GetTotalScore();
+    // only add more if stack not full after satisfying minStackDiversity
+    if ( size() < newSize ) {
+
+      // add best remaining hypotheses
+      for(size_t i=0; i<hypos.size()
+          && size() < newSize
+          && hypos[i]->GetTotalScore() > m_bestScore+m_beamWidth; i++) {
+        if (! included[i]) {
+          m_hypos.insert( hypos[i] );
+          included[i] = true;
+          if (size() == newSize)
+            m_worstScore = hypos[i]->GetTotalScore();
+        }
       }
     }
-  }
 
-  // delete hypotheses that have not been included
-  for(size_t i=0; i<hypos.size(); i++) {
-    if (! included[i]) {
-      FREEHYPO( hypos[i] );
-      m_manager.GetSentenceStats().AddPruning();
+    // delete hypotheses that have not been included
+    for(size_t i=0; i<hypos.size(); i++) {
+      if (! included[i]) {
+        FREEHYPO( hypos[i] );
+        m_manager.GetSentenceStats().AddPruning();
+      }
     }
   }
-  free(included);
 
   // some reporting....
   VERBOSE(3,", pruned to size " << size() << endl);
@@ -0,0 +1,145 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+
+#include "util/tokenize_piece.hh"
+
+#include "InputFilter.h"
+#include "InputFileStream.h"
+#include "StaticData.h"
+#include "UserMessage.h"
+#include "Util.h"
+
+namespace Moses
+{
+
+namespace
+{
+// replace markup between the brackets by blanks, keeping the words it encloses
+void StripMarkup(std::string &line, const std::string &open, const std::string &close)
+{
+  size_t begin = line.find(open);
+  while (begin != std::string::npos) {
+    size_t end = line.find(close, begin + open.size());
+    if (end == std::string::npos) return;
+    line.replace(begin, end + close.size() - begin, " ");
+    begin = line.find(open, begin + 1);
+  }
+}
+}
+
+bool InputFilter::Load(const std::string &filePath)
+{
+  if (!FileExists(filePath)) {
+    UserMessage::Add("Input file to filter the models by does not exist: " + filePath);
+    return false;
+  }
+  m_filePath = filePath;
+
+  const StaticData &staticData = StaticData::Instance();
+  const std::string &factorDelimiter = staticData.GetFactorDelimiter();
+  const std::pair<std::string,std::string> brackets = staticData.GetXmlBrackets();
+
+  InputFileStream in(filePath);
+  std::string line;
+  while (getline(in, line)) {
+    line = Trim(line);
+    ProcessAndStripSGML(line);
+    if (staticData.GetXmlInputType() != XmlPassThrough)
+      StripMarkup(line, brackets.first, brackets.second);
+
+    m_sentences.push_back(std::vector<Word>());
+    std::vector<Word> &sentence = m_sentences.back();
+    for (util::TokenIter<util::AnyCharacter, true> token(line, util::AnyCharacter(" \t")); token; ++token) {
+      sentence.push_back(TokenizeMultiCharSeparator(token->as_string(), factorDelimiter));
+    }
+  }
+  return true;
+}
+
+InputFilter::~InputFilter()
+{
+  for (std::map<std::vector<FactorType>, const NgramSet*>::iterator iter = m_ngrams.begin(); iter != m_ngrams.end(); ++iter)
+    delete iter->second;
+}
+
+void InputFilter::Index(const std::vector<FactorType> &factors) const
+{
+  if (m_ngrams.find(factors) != m_ngrams.end())
+    return;
+  m_ngrams[factors] = NULL;
+
+  // position of each factor in the input words
+  std::vector<size_t> positions(factors.size());
+  for (size_t i = 0; i < factors.size(); ++i) {
+    std::vector<FactorType>::const_iterator pos = std::find(m_inputFactorOrder.begin(), m_inputFactorOrder.end(), factors[i]);
+    if (pos == m_inputFactorOrder.end())
+      return; // not in the input, so nothing can be filtered
+    positions[i] = pos - m_inputFactorOrder.begin();
+  }
+
+  const std::string &factorDelimiter = StaticData::Instance().GetFactorDelimiter();
+  NgramSet *ngrams = new NgramSet;
+  m_ngrams[factors] = ngrams;
+  for (size_t s = 0; s < m_sentences.size(); ++s) {
+    const std::vector<Word> &sentence = m_sentences[s];
+    for (size_t start = 0; start < sentence.size(); ++start) {
+      std::string ngram;
+      for (size_t end = start; end < sentence.size() && end - start < m_maxPhraseLength; ++end) {
+        if (end > start) ngram += ' ';
+        for (size_t i = 0; i < positions.size(); ++i) {
+          if (i > 0) ngram += factorDelimiter;
+          if (positions[i] < sentence[end].size()) ngram += sentence[end][positions[i]];
+        }
+        ngrams->insert(ngram);
+      }
+    }
+  }
+  VERBOSE(2, "Indexed " << ngrams->size() << " n-grams of the input for filtering" << std::endl);
+}
+
+bool InputFilter::IsInInput(const StringPiece &phrase, const std::vector<FactorType> &factors) const
+{
+  std::map<std::vector<FactorType>, const NgramSet*>::const_iterator iter = m_ngrams.find(factors);
+  CHECK(iter != m_ngrams.end());
+  const NgramSet *ngrams = iter->second;
+  if (ngrams == NULL) {
+    ++m_kept;
+    return true;
+  }
+
+  std::string key;
+  size_t length = 0;
+  for (util::TokenIter<util::AnyCharacter, true> token(phrase, util::AnyCharacter(" \t")); token; ++token) {
+    if (++length > m_maxPhraseLength) {
+      ++m_skipped;
+      return false;
+    }
+    if (length > 1) key += ' ';
+    key.append(token->data(), token->size());
+  }
+
+  // empty source phrases are for word deletion, and always kept
+  const bool found = (length == 0 || ngrams->find(key) != ngrams->end());
+  ++(found ? m_kept : m_skipped);
+  return found;
+}
+
+}
@@ -0,0 +1,93 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_InputFilter_h
+#define moses_InputFilter_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/unordered_set.hpp>
+#include <boost/detail/atomic_count.hpp>
+
+#include "util/string_piece.hh"
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+/** Source n-grams of the input file to be translated, read at start up with
+ * -filter-by-input. The text model loaders ask it whether the source side of
+ * an entry occurs in the input and skip the entry if not, which does the work
+ * of filter-model-given-input.pl while the models are read.
+ * The n-grams are indexed separately for each combination of input factors a
+ * model uses, by Index() on the thread that loads the model. IsInInput() only
+ * reads the index, so the loader may call it on several threads.
+ */
+class InputFilter
+{
+public:
+  InputFilter(const std::vector<FactorType> &inputFactorOrder, size_t maxPhraseLength)
+    : m_inputFactorOrder(inputFactorOrder), m_maxPhraseLength(maxPhraseLength), m_kept(0), m_skipped(0) {}
+
+  ~InputFilter();
+
+  //! read plain text sentences. Returns false on error
+  bool Load(const std::string &filePath);
+
+  /** index the input n-grams made of the given factors, unless done before.
+   * Not thread safe: call it before the factors are passed to IsInInput() */
+  void Index(const std::vector<FactorType> &factors) const;
+
+  /** whether the phrase, words separated by blanks and each word made of the
+   * given factors, occurs in the input. Phrases longer than the maximum
+   * phrase length never do. The factors have to be indexed. */
+  bool IsInInput(const StringPiece &phrase, const std::vector<FactorType> &factors) const;
+
+  const std::string &GetFilePath() const {
+    return m_filePath;
+  }
+  size_t GetNumSentences() const {
+    return m_sentences.size();
+  }
+  //! number of phrases asked for that were in and not in the input
+  size_t GetKept() const {
+    return m_kept;
+  }
+  size_t GetSkipped() const {
+    return m_skipped;
+  }
+
+private:
+  typedef boost::unordered_set<std::string> NgramSet;
+  //! a word is its factors, in input factor order
+  typedef std::vector<std::string> Word;
+
+  std::string m_filePath;
+  std::vector<FactorType> m_inputFactorOrder;
+  size_t m_maxPhraseLength;
+  std::vector<std::vector<Word> > m_sentences;
+  //! NULL for factors that are not all in the input, so cannot be filtered by
+  mutable std::map<std::vector<FactorType>, const NgramSet*> m_ngrams;
+  mutable boost::detail::atomic_count m_kept, m_skipped;
+};
+
+}
+
+#endif
@@ -68,6 +68,9 @@ public:
 
   virtual void CleanUpAfterSentenceProcessing() {}
 
+  //! drop state the calling search worker thread keeps for the sentence
+  virtual void CleanUpSearchThread() {}
+
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
   /* whether this LM can be used on a particular phrase.
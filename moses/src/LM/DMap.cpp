@@ -51,7 +51,7 @@ void LanguageModelDMapLM::CreateFactor(FactorCollection& factorCollection)
 }
 
 LMResult LanguageModelDMapLM::GetValueGivenState(
-    const std::vector<const Word*>& contextFactor,
+    const LMContext &contextFactor,
     FFState& state) const
 {
   DMapLMState& cast_state = static_cast<DMapLMState&>(state);
@@ -65,7 +65,7 @@ LMResult LanguageModelDMapLM::GetValueGivenState(
 }
 
 LMResult LanguageModelDMapLM::GetValueForgotState(
-    const std::vector<const Word*>& contextFactor,
+    const LMContext &contextFactor,
     FFState& outState) const
 {
   DMapLMState& cast_state = static_cast<DMapLMState&>(outState);
@@ -78,7 +78,7 @@ LMResult LanguageModelDMapLM::GetValueForgotState(
 }
 
 float LanguageModelDMapLM::GetValue(
-    const std::vector<const Word*>& contextFactor,
+    const LMContext &contextFactor,
     size_t target_order,
     size_t* succeeding_order) const
 {
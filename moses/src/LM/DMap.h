@@ -25,6 +25,12 @@ public:
         else
             return 0;
     }
+    size_t Hash() const {
+        return m_last_succeeding_order;
+    }
+    bool Equal(const FFState &o) const {
+        return m_last_succeeding_order == static_cast<const DMapLMState&>(o).m_last_succeeding_order;
+    }
     uint8_t m_last_succeeding_order;
 };
 
@@ -34,9 +40,9 @@ public:
   LanguageModelDMapLM();
   ~LanguageModelDMapLM();
   bool Load(const std::string&, FactorType, size_t);
-  LMResult GetValueGivenState(const std::vector<const Word*>&, FFState&) const;
-  LMResult GetValueForgotState(const std::vector<const Word*>&, FFState&) const;
-  float GetValue(const std::vector<const Word*>&, size_t, size_t*) const;
+  LMResult GetValueGivenState(const LMContext&, FFState&) const;
+  LMResult GetValueForgotState(const LMContext&, FFState&) const;
+  float GetValue(const LMContext&, size_t, size_t*) const;
   const FFState* GetNullContextState() const;
   FFState* GetNewSentenceState() const;
   const FFState* GetBeginSentenceState() const;
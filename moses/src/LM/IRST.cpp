@@ -204,7 +204,7 @@ int LanguageModelIRST::GetLmID( const Factor *factor ) const
   }
 }
 
-LMResult LanguageModelIRST::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+LMResult LanguageModelIRST::GetValue(const LMContext &contextFactor, State* finalState) const
 {
   FactorType factorType = GetFactorType();
 
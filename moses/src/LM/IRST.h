@@ -68,7 +68,7 @@ public:
             , FactorType factorType
             , size_t nGramOrder);
 
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = NULL) const;
+  virtual LMResult GetValue(const LMContext &contextFactor, State* finalState = NULL) const;
 
   void CleanUpAfterSentenceProcessing();
   void InitializeBeforeSentenceProcessing();
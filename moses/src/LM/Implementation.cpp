@@ -24,9 +24,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <boost/functional/hash.hpp>
 
 #include "FFState.h"
 #include "LM/Implementation.h"
+#include "LM/QueryCache.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "Manager.h"
@@ -41,6 +43,53 @@ using namespace std;
 namespace Moses
 {
 
+/** Query cache of one thread. The states of the hypotheses may be deleted
+ * before the end of the sentence, so the cache is keyed on copies.
+ */
+struct LanguageModelImplementation::QueryCache {
+  struct StateHash {
+    size_t operator()(const FFState *state) const {
+      return state->Hash();
+    }
+  };
+  struct StateEqual {
+    bool operator()(const FFState *a, const FFState *b) const {
+      return a->Equal(*b);
+    }
+  };
+  typedef LMQueryCache<const FFState*, StateHash, StateEqual> Map;
+
+  explicit QueryCache(size_t size) : map(size) {}
+  ~QueryCache() {
+    RemoveAllInColl(states);
+  }
+
+  void Clear() {
+    map.Clear();
+    RemoveAllInColl(states);
+  }
+
+  Map map;
+  std::vector<const FFState*> states; //! copies referenced by map
+};
+
+LanguageModelImplementation::LanguageModelImplementation() {}
+
+LanguageModelImplementation::~LanguageModelImplementation() {}
+
+LanguageModelImplementation::QueryCache *LanguageModelImplementation::GetQueryCache() const
+{
+  const size_t size = StaticData::Instance().GetLMQueryCacheSize();
+  if (!size) return NULL;
+  if (!m_queryCache.get()) m_queryCache.reset(new QueryCache(size));
+  return m_queryCache.get();
+}
+
+void LanguageModelImplementation::ClearQueryCache() const
+{
+  m_queryCache.reset();
+}
+
 void LanguageModelImplementation::ShiftOrPush(std::vector<const Word*> &contextFactor, const Word &word) const
 {
   if (contextFactor.size() < GetNGramOrder()) {
@@ -55,19 +104,26 @@ void LanguageModelImplementation::ShiftOrPush(std::vector<const Word*> &contextF
 }
 
 LMResult LanguageModelImplementation::GetValueGivenState(
-  const std::vector<const Word*> &contextFactor,
+  const LMContext &contextFactor,
   FFState &state) const
 {
   return GetValueForgotState(contextFactor, state);
 }
 
 void LanguageModelImplementation::GetState(
-  const std::vector<const Word*> &contextFactor,
+  const LMContext &contextFactor,
   FFState &state) const
 {
   GetValueForgotState(contextFactor, state);
 }
 
+void LanguageModelImplementation::GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const
+{
+  for (size_t pos = begin ; pos < end ; ++pos) {
+    *results++ = GetValueGivenState(GetNGram(words, pos), state);
+  }
+}
+
 // Calculate score of a phrase.  
 void LanguageModelImplementation::CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const {
   fullScore  = 0;
@@ -78,41 +134,53 @@ void LanguageModelImplementation::CalcScore(const Phrase &phrase, float &fullSco
   size_t phraseSize = phrase.GetSize();
   if (!phraseSize) return;
 
-  vector<const Word*> contextFactor;
-  contextFactor.reserve(GetNGramOrder());
+  // the n-grams are windows on the words of the phrase
+  vector<const Word*> words(phraseSize);
+  for (size_t pos = 0 ; pos < phraseSize ; ++pos) {
+    words[pos] = &phrase.GetWord(pos);
+  }
+  size_t contextStart = 0;
+
   std::auto_ptr<FFState> state(NewState((phrase.GetWord(0) == GetSentenceStartArray()) ?
                                GetBeginSentenceState() : GetNullContextState()));
   size_t currPos = 0;
+  std::vector<LMResult> results;
   while (currPos < phraseSize) {
-    const Word &word = phrase.GetWord(currPos);
-
-    if (word.IsNonTerminal()) {
+    if (words[currPos]->IsNonTerminal()) {
       // do nothing. reset ngram. needed to score target phrases during pt loading in chart decoding
-      if (!contextFactor.empty()) {
+      if (contextStart != currPos) {
         // TODO: state operator= ?
         state.reset(NewState(GetNullContextState()));
-        contextFactor.clear();
       }
-    } else {
-      ShiftOrPush(contextFactor, word);
-      CHECK(contextFactor.size() <= GetNGramOrder());
+      contextStart = ++currPos;
+      continue;
+    }
 
-      if (word == GetSentenceStartArray()) {
-        // do nothing, don't include prob for <s> unigram
-        if (currPos != 0) {
-          std::cerr << "Either your data contains <s> in a position other than the first word or your language model is missing <s>.  Did you build your ARPA using IRSTLM and forget to run add-start-end.sh?" << std::endl;
-          abort();
-        }
-      } else {
-        LMResult result = GetValueGivenState(contextFactor, *state);
+    // score the run of terminals up to the next non-terminal in one batch
+    size_t runEnd = currPos;
+    while (runEnd < phraseSize && !words[runEnd]->IsNonTerminal()) {
+      if (runEnd != 0 && *words[runEnd] == GetSentenceStartArray()) {
+        std::cerr << "Either your data contains <s> in a position other than the first word or your language model is missing <s>.  Did you build your ARPA using IRSTLM and forget to run add-start-end.sh?" << std::endl;
+        abort();
+      }
+      ++runEnd;
+    }
+    // don't include prob for <s> unigram
+    if (currPos == 0 && *words[0] == GetSentenceStartArray()) {
+      ++currPos;
+    }
+    if (currPos < runEnd) {
+      results.resize(runEnd - currPos);
+      GetValues(&words[contextStart], currPos - contextStart, runEnd - contextStart, *state, &results.front());
+      for (size_t pos = currPos; pos < runEnd; ++pos) {
+        const LMResult &result = results[pos - currPos];
         fullScore += result.score;
-        if (contextFactor.size() == GetNGramOrder())
+        if (pos + 1 - contextStart >= GetNGramOrder())
           ngramScore += result.score;
-        if (result.unknown) ++oovCount;  
+        if (result.unknown) ++oovCount;
       }
     }
-
-    currPos++;
+    currPos = runEnd;
   }
 }
 
@@ -135,76 +203,106 @@ FFState *LanguageModelImplementation::Evaluate(const Hypothesis &hypo, const FFS
   if (hypo.GetCurrTargetLength() == 0)
     return ps ? NewState(ps) : NULL;
 
+  FFState *res;
+  float lmScore;
+  QueryCache *cache = ps ? GetQueryCache() : NULL;
+  const QueryCache::Map::Result *cached = cache ?
+    cache->map.Find(ps, hypo.GetCurrTargetPhrase(), hypo.IsSourceCompleted(), hypo.GetManager().GetSentenceStats()) : NULL;
+  if (cached) {
+    res = NewState(cached->state);
+    lmScore = cached->score;
+  } else {
+    res = NewState(ps);
+    lmScore = ScorePhrase(hypo, ps, *res);
+    if (cache) {
+      if (cache->map.IsFull()) cache->Clear();
+      const FFState *key = NewState(ps);
+      QueryCache::Map::Result result;
+      result.state = NewState(res);
+      result.score = lmScore;
+      cache->states.push_back(key);
+      cache->states.push_back(result.state);
+      cache->map.Add(key, hypo.GetCurrTargetPhrase(), hypo.IsSourceCompleted(), result);
+    }
+  }
+
+  if (feature->OOVFeatureEnabled()) {
+    vector<float> scores(2);
+    scores[0] = lmScore;
+    scores[1] = 0;
+    out->PlusEquals(feature, scores);
+  } else {
+    out->PlusEquals(feature, lmScore);
+  }
+
+
+  IFVERBOSE(2) {
+    hypo.GetManager().GetSentenceStats().AddTimeCalcLM( clock()-t );
+  }
+  return res;
+}
+
+float LanguageModelImplementation::ScorePhrase(const Hypothesis &hypo, const FFState *ps, FFState &state) const
+{
+  const size_t order = GetNGramOrder();
   const size_t currEndPos = hypo.GetCurrTargetWordsRange().GetEndPos();
   const size_t startPos = hypo.GetCurrTargetWordsRange().GetStartPos();
 
-  // 1st n-gram
-  vector<const Word*> contextFactor(GetNGramOrder());
-  size_t index = 0;
-  for (int currPos = (int) startPos - (int) GetNGramOrder() + 1 ; currPos <= (int) startPos ; currPos++) {
+  // the n-grams overlapping the phrase boundary are windows on the
+  // order - 1 words before the phrase and its first order - 1 words
+  const Word *words[2 * MAX_NGRAM_SIZE];
+  size_t size = 0;
+  for (int currPos = (int) startPos - (int) order + 1 ; currPos < (int) startPos ; currPos++) {
     if (currPos >= 0)
-      contextFactor[index++] = &hypo.GetWord(currPos);
-    else {
-      contextFactor[index++] = &GetSentenceStartArray();
-    }
+      words[size++] = &hypo.GetWord(currPos);
+    else
+      words[size++] = &GetSentenceStartArray();
+  }
+  const size_t boundary = size;
+  const size_t endPos = std::min(startPos + order - 2
+                                 , currEndPos);
+  for (size_t currPos = startPos ; currPos <= endPos ; currPos++) {
+    words[size++] = &hypo.GetWord(currPos);
   }
-  FFState *res = NewState(ps);
-  float lmScore = ps ? GetValueGivenState(contextFactor, *res).score : GetValueForgotState(contextFactor, *res).score;
-
-  // main loop
-  size_t endPos = std::min(startPos + GetNGramOrder() - 2
-                           , currEndPos);
-  for (size_t currPos = startPos + 1 ; currPos <= endPos ; currPos++) {
-    // shift all args down 1 place
-    for (size_t i = 0 ; i < GetNGramOrder() - 1 ; i++)
-      contextFactor[i] = contextFactor[i + 1];
-
-    // add last factor
-    contextFactor.back() = &hypo.GetWord(currPos);
 
-    lmScore += GetValueGivenState(contextFactor, *res).score;
+  // 1st n-gram
+  float lmScore = 0;
+  size_t begin = boundary;
+  if (!ps) {
+    lmScore += GetValueForgotState(GetNGram(words, begin), state).score;
+    ++begin;
+  }
+  LMResult results[MAX_NGRAM_SIZE];
+  GetValues(words, begin, size, state, results);
+  for (size_t i = 0 ; i < size - begin ; ++i) {
+    lmScore += results[i].score;
   }
 
+  const Word *contextFactor[MAX_NGRAM_SIZE];
   // end of sentence
   if (hypo.IsSourceCompleted()) {
-    const size_t size = hypo.GetSize();
-    contextFactor.back() = &GetSentenceEndArray();
+    const size_t hypoSize = hypo.GetSize();
+    contextFactor[order - 1] = &GetSentenceEndArray();
 
-    for (size_t i = 0 ; i < GetNGramOrder() - 1 ; i ++) {
-      int currPos = (int)(size - GetNGramOrder() + i + 1);
+    for (size_t i = 0 ; i < order - 1 ; i ++) {
+      int currPos = (int)(hypoSize - order + i + 1);
       if (currPos < 0)
         contextFactor[i] = &GetSentenceStartArray();
       else
         contextFactor[i] = &hypo.GetWord((size_t)currPos);
     }
-    lmScore += GetValueForgotState(contextFactor, *res).score;
+    lmScore += GetValueForgotState(LMContext(contextFactor, order), state).score;
   }
   else
   {
     if (endPos < currEndPos) {
       //need to get the LM state (otherwise the last LM state is fine)
-      for (size_t currPos = endPos+1; currPos <= currEndPos; currPos++) {
-        for (size_t i = 0 ; i < GetNGramOrder() - 1 ; i++)
-          contextFactor[i] = contextFactor[i + 1];
-        contextFactor.back() = &hypo.GetWord(currPos);
-      }
-      GetState(contextFactor, *res);
+      for (size_t i = 0 ; i < order ; i++)
+        contextFactor[i] = &hypo.GetWord(currEndPos - order + 1 + i);
+      GetState(LMContext(contextFactor, order), state);
     }
   }
-  if (feature->OOVFeatureEnabled()) {
-    vector<float> scores(2);
-    scores[0] = lmScore;
-    scores[1] = 0;
-    out->PlusEquals(feature, scores);
-  } else {
-    out->PlusEquals(feature, lmScore);
-  }
-
-
-  IFVERBOSE(2) {
-    hypo.GetManager().GetSentenceStats().AddTimeCalcLM( clock()-t );
-  }
-  return res;
+  return lmScore;
 }
 
 namespace {
@@ -370,6 +468,30 @@ public:
     }
     return 0;
   }
+
+  // Hash() and Equal() look at the same parts of the state as Compare()
+  size_t Hash() const {
+    size_t seed = 0;
+    if (m_hypo.GetCurrSourceRange().GetStartPos() > 0)
+      boost::hash_combine(seed, GetPrefix());
+    size_t inputSize = m_hypo.GetManager().GetSource().GetSize();
+    if (m_hypo.GetCurrSourceRange().GetEndPos() < inputSize - 1)
+      boost::hash_combine(seed, m_lmRightContext->Hash());
+    return seed;
+  }
+
+  bool Equal(const FFState& o) const {
+    const LanguageModelChartState &other =
+      static_cast<const LanguageModelChartState &>( o );
+    if (m_hypo.GetCurrSourceRange().GetStartPos() > 0
+        && GetPrefix().Compare(other.GetPrefix()) != 0)
+      return false;
+    size_t inputSize = m_hypo.GetManager().GetSource().GetSize();
+    if (m_hypo.GetCurrSourceRange().GetEndPos() < inputSize - 1
+        && !m_lmRightContext->Equal(*other.GetRightContext()))
+      return false;
+    return true;
+  }
 };
 
 } // namespace
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_LanguageModelImplementation_h
 #define moses_LanguageModelImplementation_h
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "Factor.h"
@@ -33,6 +34,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <boost/shared_ptr.hpp>
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -49,13 +54,52 @@ struct LMResult {
   bool unknown;
 };
 
+/** The words of an n-gram to be scored, oldest first.  Only points into an
+ * array of word pointers, so that the n-grams of a phrase are windows on the
+ * same array instead of copies.  Has the parts of the vector interface the
+ * language models use, and converts from a vector.
+ */
+class LMContext
+{
+public:
+  LMContext(const Word *const *words, size_t size) : m_words(words), m_size(size) {}
+  LMContext(const std::vector<const Word*> &words)
+    : m_words(words.empty() ? NULL : &words.front()), m_size(words.size()) {}
+
+  size_t size() const {
+    return m_size;
+  }
+  bool empty() const {
+    return m_size == 0;
+  }
+  const Word *operator[](size_t pos) const {
+    return m_words[pos];
+  }
+
+private:
+  const Word *const *m_words;
+  size_t m_size;
+};
+
 //! Abstract base class which represent a language model on a contiguous phrase
 class LanguageModelImplementation
 {
-  // default constructor is ok
+  struct QueryCache;
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<QueryCache> m_queryCache;
+#else
+  mutable std::auto_ptr<QueryCache> m_queryCache;
+#endif
 
   void ShiftOrPush(std::vector<const Word*> &contextFactor, const Word &word) const;
 
+  //! query cache of this thread, or NULL if disabled
+  QueryCache *GetQueryCache() const;
+
+  //! LM score of the n-grams of hypo overlapping its phrase, state is set to the following state
+  float ScorePhrase(const Hypothesis &hypo, const FFState *ps, FFState &state) const;
+
 protected:
   std::string	m_filePath; //! for debugging purposes
   size_t			m_nGramOrder; //! max n-gram length contained in this LM
@@ -63,7 +107,8 @@ protected:
   //! Usually <s> and </s>
 
 public:
-  virtual ~LanguageModelImplementation() {}
+  LanguageModelImplementation();
+  virtual ~LanguageModelImplementation();
 
   //! Single or multi-factor
   virtual LMType GetLMType() const = 0;
@@ -78,15 +123,29 @@ public:
    * \param contextFactor n-gram to be scored
    * \param state LM state.  Input and output.  state must be initialized.  If state isn't initialized, you want GetValueWithoutState.
    */
-  virtual LMResult GetValueGivenState(const std::vector<const Word*> &contextFactor, FFState &state) const;
+  virtual LMResult GetValueGivenState(const LMContext &contextFactor, FFState &state) const;
 
   // Like GetValueGivenState but state may not be initialized (however it is non-NULL).
   // For example, state just came from NewState(NULL).
-  virtual LMResult GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const = 0;
+  virtual LMResult GetValueForgotState(const LMContext &contextFactor, FFState &outState) const = 0;
 
   //! get State for a particular n-gram.  We don't care what the score is.
   // This is here so models can implement a shortcut to GetValueAndState.
-  virtual void GetState(const std::vector<const Word*> &contextFactor, FFState &outState) const;
+  virtual void GetState(const LMContext &contextFactor, FFState &outState) const;
+
+  /* Score words[begin, end) in turn, each given the words before it (see
+   * GetNGram), writing results[0, end - begin).  state must be initialized and
+   * is updated like by GetValueGivenState.  The default calls that for each
+   * n-gram; models that can share work between the n-grams override it.
+   */
+  virtual void GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const;
+
+  //! the n-gram of words ending at pos, not reaching back before words[first]
+  LMContext GetNGram(const Word *const *words, size_t pos, size_t first = 0) const {
+    if (pos + 1 - first > m_nGramOrder)
+      first = pos + 1 - m_nGramOrder;
+    return LMContext(words + first, pos + 1 - first);
+  }
 
   virtual const FFState *GetNullContextState() const = 0;
   virtual const FFState *GetBeginSentenceState() const = 0;
@@ -124,6 +183,14 @@ public:
   //! overrideable funtions for IRST LM to cleanup. Maybe something to do with on demand/cache loading/unloading
   virtual void InitializeBeforeSentenceProcessing() {};
   virtual void CleanUpAfterSentenceProcessing() {};
+
+  //! whether GetValue() may be called by several search threads at once
+  virtual bool IsSearchThreadSafe() const {
+    return false;
+  }
+
+  //! drop the query cache of the calling thread, at the end of a sentence
+  void ClearQueryCache() const;
 };
 
 class LMRefCount : public LanguageModel {
@@ -142,6 +209,15 @@ class LMRefCount : public LanguageModel {
 
     void CleanUpAfterSentenceProcessing() {
       m_impl->CleanUpAfterSentenceProcessing();
+      m_impl->ClearQueryCache();
+    }
+
+    void CleanUpSearchThread() {
+      m_impl->ClearQueryCache();
+    }
+
+    bool IsSearchThreadSafe() const {
+      return m_impl->IsSearchThreadSafe();
     }
 
     const FFState* EmptyHypothesisState(const InputType &/*input*/) const {
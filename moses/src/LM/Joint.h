@@ -78,7 +78,7 @@ public:
     return m_lmImpl->Load(filePath, m_implFactor, nGramOrder);
   }
 
-  LMResult GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const {
+  LMResult GetValueForgotState(const LMContext &contextFactor, FFState &outState) const {
     if (contextFactor.size() == 0) {
       LMResult ret;
       ret.score = 0.0;
@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "LM/Ken.h"
 #include "LM/Base.h"
+#include "LM/QueryCache.h"
 #include "FFState.h"
 #include "TypeDef.h"
 #include "Util.h"
@@ -38,9 +39,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputFileStream.h"
 #include "StaticData.h"
 #include "ChartHypothesis.h"
+#include "Manager.h"
 
+#include <boost/functional/hash.hpp>
 #include <boost/shared_ptr.hpp>
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 using namespace std;
 
 namespace Moses {
@@ -54,6 +61,12 @@ struct KenLMState : public FFState {
     if (state.length > other.state.length) return 1;
     return std::memcmp(state.words, other.state.words, sizeof(lm::WordIndex) * state.length);
   }
+  size_t Hash() const {
+    return hash_value(state);
+  }
+  bool Equal(const FFState &o) const {
+    return state == static_cast<const KenLMState &>(o).state;
+  }
 };
 
 /*
@@ -81,15 +94,42 @@ template <class Model> class LanguageModelKen : public LanguageModel {
       return ret;
     }
 
+    void CleanUpAfterSentenceProcessing() {
+      m_queryCache.reset();
+    }
+
+    void CleanUpSearchThread() {
+      m_queryCache.reset();
+    }
+
+    bool IsSearchThreadSafe() const {
+      return true;
+    }
+
     void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
 
     FFState *Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
 
+    void Prefetch(const FFState *ps, const Phrase &targetPhrase) const;
+
     FFState *EvaluateChart(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
 
   private:
+    typedef LMQueryCache<lm::ngram::State> QueryCache;
+
     LanguageModelKen(ScoreIndexManager &manager, const LanguageModelKen<Model> &copy_from);
 
+    // Score the current phrase of hypo after in_state, without the transform.
+    float ScorePhrase(const Hypothesis &hypo, const lm::ngram::State &in_state, lm::ngram::State &out_state) const;
+
+    // The query cache of this thread, or NULL if disabled.
+    QueryCache *GetQueryCache() const {
+      const size_t size = StaticData::Instance().GetLMQueryCacheSize();
+      if (!size) return NULL;
+      if (!m_queryCache.get()) m_queryCache.reset(new QueryCache(size));
+      return m_queryCache.get();
+    }
+
     lm::WordIndex TranslateID(const Word &word) const {
       std::size_t factor = word.GetFactor(m_factorType)->GetId();
       return (factor >= m_lmIdLookup.size() ? 0 : m_lmIdLookup[factor]);
@@ -117,6 +157,12 @@ template <class Model> class LanguageModelKen : public LanguageModel {
     FactorType m_factorType;
 
     const Factor *m_beginSentenceFactor;
+
+#ifdef WITH_THREADS
+    mutable boost::thread_specific_ptr<QueryCache> m_queryCache;
+#else
+    mutable std::auto_ptr<QueryCache> m_queryCache;
+#endif
 };
 
 class MappingBuilder : public lm::EnumerateVocab {
@@ -213,13 +259,46 @@ template <class Model> void LanguageModelKen<Model>::CalcScore(const Phrase &phr
 template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const {
   const lm::ngram::State &in_state = static_cast<const KenLMState&>(*ps).state;
 
-  std::auto_ptr<KenLMState> ret(new KenLMState());
+  KenLMState *ret = new (hypo.GetArena()) KenLMState();
   
   if (!hypo.GetCurrTargetLength()) {
     ret->state = in_state;
-    return ret.release();
+    return ret;
+  }
+
+  float score;
+  QueryCache *cache = GetQueryCache();
+  const QueryCache::Result *cached = cache ?
+    cache->Find(in_state, hypo.GetCurrTargetPhrase(), hypo.IsSourceCompleted(), hypo.GetManager().GetSentenceStats()) : NULL;
+  if (cached) {
+    ret->state = cached->state;
+    score = cached->score;
+  } else {
+    score = ScorePhrase(hypo, in_state, ret->state);
+    if (cache) {
+      if (cache->IsFull()) cache->Clear();
+      QueryCache::Result result;
+      result.state = ret->state;
+      result.score = score;
+      cache->Add(in_state, hypo.GetCurrTargetPhrase(), hypo.IsSourceCompleted(), result);
+    }
+  }
+
+  score = TransformLMScore(score);
+
+  if (OOVFeatureEnabled()) {
+    std::vector<float> scores(2);
+    scores[0] = score;
+    scores[1] = 0.0;
+    out->PlusEquals(this, scores);
+  } else {
+    out->PlusEquals(this, score);
   }
 
+  return ret;
+}
+
+template <class Model> float LanguageModelKen<Model>::ScorePhrase(const Hypothesis &hypo, const lm::ngram::State &in_state, lm::ngram::State &out_state) const {
   const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
   //[begin, end) in STL-like fashion.
   const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
@@ -227,7 +306,7 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
 
   std::size_t position = begin;
   typename Model::State aux_state;
-  typename Model::State *state0 = &ret->state, *state1 = &aux_state;
+  typename Model::State *state0 = &out_state, *state1 = &aux_state;
 
   float score = m_ngram->Score(in_state, TranslateID(hypo.GetWord(position)), *state0);
   ++position;
@@ -240,29 +319,36 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
     // Score end of sentence.  
     std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
     const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    score += m_ngram->FullScoreForgotState(&indices.front(), last, m_ngram->GetVocabulary().EndSentence(), ret->state).prob;
+    score += m_ngram->FullScoreForgotState(&indices.front(), last, m_ngram->GetVocabulary().EndSentence(), out_state).prob;
   } else if (adjust_end < end) {
     // Get state after adding a long phrase.  
     std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
     const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    m_ngram->GetState(&indices.front(), last, ret->state);
-  } else if (state0 != &ret->state) {
+    m_ngram->GetState(&indices.front(), last, out_state);
+  } else if (state0 != &out_state) {
     // Short enough phrase that we can just reuse the state.  
-    ret->state = *state0;
+    out_state = *state0;
   }
 
-  score = TransformLMScore(score);
+  return score;
+}
 
-  if (OOVFeatureEnabled()) {
-    std::vector<float> scores(2);
-    scores[0] = score;
-    scores[1] = 0.0;
-    out->PlusEquals(this, scores);
-  } else {
-    out->PlusEquals(this, score);
-  }
+template <class Model> void LanguageModelKen<Model>::Prefetch(const FFState *ps, const Phrase &targetPhrase) const {
+  if (!ps) return;
+  const lm::ngram::State &in_state = static_cast<const KenLMState&>(*ps).state;
 
-  return ret.release();
+  // Evaluate() queries the first Order() - 1 words with the context growing
+  // leftwards from the incoming state, so build that context the same way.  
+  lm::WordIndex context[2 * lm::ngram::kMaxOrder];
+  lm::WordIndex *context_rbegin = context + lm::ngram::kMaxOrder;
+  const lm::WordIndex *context_rend = std::copy(in_state.words, in_state.words + in_state.length, context_rbegin);
+
+  const std::size_t size = std::min(targetPhrase.GetSize(), static_cast<std::size_t>(m_ngram->Order() - 1));
+  for (std::size_t position = 0; position < size; ++position) {
+    const lm::WordIndex index = TranslateID(targetPhrase.GetWord(position));
+    m_ngram->Prefetch(context_rbegin, context_rend, index);
+    *--context_rbegin = index;
+  }
 }
 
 class LanguageModelChartStateKenLM : public FFState {
@@ -279,6 +365,22 @@ class LanguageModelChartStateKenLM : public FFState {
       return ret;
     }
 
+    size_t Hash() const
+    {
+      // mirrors ChartState::Compare, which only looks at the last left pointer
+      size_t seed = m_state.left.length;
+      if (m_state.left.length)
+        boost::hash_combine(seed, m_state.left.pointers[m_state.left.length - 1]);
+      boost::hash_combine(seed, hash_value(m_state.right));
+      boost::hash_combine(seed, m_state.full);
+      return seed;
+    }
+
+    bool Equal(const FFState& o) const
+    {
+      return m_state.Compare(static_cast<const LanguageModelChartStateKenLM&>(o).m_state) == 0;
+    }
+
   private:
     lm::ngram::ChartState m_state;
 };
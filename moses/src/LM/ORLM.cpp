@@ -65,7 +65,7 @@ wordID_t LanguageModelORLM::GetLmID(const Factor* factor) const {
   size_t factorId = factor->GetId();
   return (factorId >= lm_ids_vec_.size()) ? m_oov_id : lm_ids_vec_[factorId];
 }
-LMResult LanguageModelORLM::GetValue(const std::vector<const Word*> &contextFactor, 
+LMResult LanguageModelORLM::GetValue(const LMContext &contextFactor, 
     State* finalState) const {
   FactorType factorType = GetFactorType();
   // set up context
@@ -88,6 +88,27 @@ LMResult LanguageModelORLM::GetValue(const std::vector<const Word*> &contextFact
   */
   return ret;
 }
+void LanguageModelORLM::GetValues(const Word *const *words, size_t begin, size_t end,
+    FFState &state, LMResult *results) const {
+  const size_t first = (begin + 1 > GetNGramOrder()) ? begin + 1 - GetNGramOrder() : 0;
+  if (end - first > 2 * MAX_NGRAM_SIZE) {
+    LanguageModelPointerState::GetValues(words, begin, end, state, results);
+    return;
+  }
+  // look up each word once rather than once for every n-gram it is in
+  FactorType factorType = GetFactorType();
+  wordID_t ids[2 * MAX_NGRAM_SIZE];
+  for (size_t pos = first; pos < end; ++pos)
+    ids[pos - first] = GetLmID((*words[pos])[factorType]);
+  State *finalState = &GetPointer(state);
+  for (size_t pos = begin; pos < end; ++pos) {
+    const int count = GetNGram(words, pos).size();
+    const wordID_t *ngram = ids + (pos + 1 - count - first);
+    LMResult &ret = *results++;
+    ret.score = FloorScore(TransformLMScore(m_lm->getProb(ngram, count, finalState)));
+    ret.unknown = (ngram[count - 1] == m_oov_id);
+  }
+}
 bool LanguageModelORLM::UpdateORLM(const std::vector<string>& ngram, const int value) {
   /*cerr << "Inserting into ORLM: \"";
   iterate(ngram, nit)
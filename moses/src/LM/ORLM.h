@@ -21,7 +21,8 @@ public:
   LanguageModelORLM()
     : m_lm(0) {}
   bool Load(const std::string &filePath, FactorType factorType, size_t nGramOrder);
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = NULL) const;
+  virtual LMResult GetValue(const LMContext &contextFactor, State* finalState = NULL) const;
+  virtual void GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const;
   ~LanguageModelORLM() {
     //save LM with markings
     Utils::rtrim(m_filePath, ".gz");
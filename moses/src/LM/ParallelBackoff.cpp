@@ -79,7 +79,7 @@ public:
 
   void CreateFactors();
 
-  LMResult GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const;
+  LMResult GetValueForgotState(const LMContext &contextFactor, FFState &outState) const;
   const FFState *GetNullContextState() const;
   const FFState *GetBeginSentenceState() const;
   FFState *NewState(const FFState *from) const;
@@ -268,7 +268,7 @@ void LanguageModelParallelBackoff::CreateFactors()
 
 }
 
-LMResult LanguageModelParallelBackoff::GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState & /*outState */) const
+LMResult LanguageModelParallelBackoff::GetValueForgotState(const LMContext &contextFactor, FFState & /*outState */) const
 {
 
   static WidMatrix widMatrix;
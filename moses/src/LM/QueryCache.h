@@ -0,0 +1,121 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_LMQueryCache_h
+#define moses_LMQueryCache_h
+
+#include <functional>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "SentenceStats.h"
+
+namespace Moses
+{
+
+class TargetPhrase;
+
+/** Memoizes the phrase-based evaluation of a language model within one
+ * sentence and decoding thread. Hypotheses with equal LM states that are
+ * extended by the same target phrase get the same score and state, so they
+ * are looked up on (state, target phrase, whether the end of sentence is
+ * scored too). Target phrases are identified by address, which is stable
+ * while the translation options of the sentence exist.
+ *
+ * The cache is bounded: the owner checks IsFull() and empties it. Hits and
+ * lookups are added to the SentenceStats passed to Find() when the cache is
+ * destroyed.
+ */
+template <class State, class StateHash = boost::hash<State>, class StateEqual = std::equal_to<State> >
+class LMQueryCache
+{
+public:
+  struct Result {
+    State state;
+    float score;
+  };
+
+  explicit LMQueryCache(size_t maxSize)
+    : m_maxSize(maxSize), m_stats(NULL), m_numHits(0), m_numLookups(0) {}
+
+  ~LMQueryCache() {
+    if (m_stats)
+      m_stats->AddLMCacheLookups(m_numHits, m_numLookups);
+  }
+
+  //! the result of extending state by phrase, or NULL if not cached
+  const Result *Find(const State &state, const TargetPhrase &phrase, bool sourceCompleted, SentenceStats &stats) {
+    m_stats = &stats;
+    ++m_numLookups;
+    typename Map::const_iterator iter = m_map.find(Key(state, phrase, sourceCompleted));
+    if (iter == m_map.end())
+      return NULL;
+    ++m_numHits;
+    return &iter->second;
+  }
+
+  void Add(const State &state, const TargetPhrase &phrase, bool sourceCompleted, const Result &result) {
+    m_map[Key(state, phrase, sourceCompleted)] = result;
+  }
+
+  bool IsFull() const {
+    return m_map.size() >= m_maxSize;
+  }
+
+  void Clear() {
+    m_map.clear();
+  }
+
+private:
+  struct Key {
+    Key(const State &state_, const TargetPhrase &phrase_, bool sourceCompleted_)
+      : state(state_), phrase(&phrase_), sourceCompleted(sourceCompleted_) {}
+    State state;
+    const TargetPhrase *phrase;
+    bool sourceCompleted;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      size_t seed = StateHash()(key.state);
+      boost::hash_combine(seed, key.phrase);
+      boost::hash_combine(seed, key.sourceCompleted);
+      return seed;
+    }
+  };
+
+  struct KeyEqual {
+    bool operator()(const Key &a, const Key &b) const {
+      return a.phrase == b.phrase && a.sourceCompleted == b.sourceCompleted && StateEqual()(a.state, b.state);
+    }
+  };
+
+  typedef boost::unordered_map<Key, Result, KeyHash, KeyEqual> Map;
+
+  Map m_map;
+  size_t m_maxSize;
+  SentenceStats *m_stats;
+  size_t m_numHits, m_numLookups;
+};
+
+}
+
+#endif
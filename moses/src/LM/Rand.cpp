@@ -48,7 +48,7 @@ public:
   LanguageModelRandLM()
     : m_lm(0) {}
   bool Load(const std::string &filePath, FactorType factorType, size_t nGramOrder);
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = NULL) const;
+  virtual LMResult GetValue(const LMContext &contextFactor, State* finalState = NULL) const;
   ~LanguageModelRandLM() {
     delete m_lm;
   }
@@ -132,7 +132,7 @@ randlm::WordID LanguageModelRandLM::GetLmID( const std::string &str ) const
   return m_lm->getWordID(str);
 }
 
-LMResult LanguageModelRandLM::GetValue(const vector<const Word*> &contextFactor,
+LMResult LanguageModelRandLM::GetValue(const LMContext &contextFactor,
                                     State* finalState) const
 {
   FactorType factorType = GetFactorType();
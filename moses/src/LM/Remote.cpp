@@ -1,13 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <cstring>
+#include <sstream>
+#include <vector>
 #include "LM/Remote.h"
 #include "Factor.h"
+#include "FactorCollection.h"
 
 namespace Moses
 {
@@ -15,6 +21,13 @@ namespace Moses
 const Factor* LanguageModelRemote::BOS = NULL;
 const Factor* LanguageModelRemote::EOS = (LanguageModelRemote::BOS + 1);
 
+LanguageModelRemote::LanguageModelRemote()
+  : m_multiGet(false)
+  , m_curId(1000)
+{
+  bzero((char *)&m_server, sizeof(m_server));
+}
+
 bool LanguageModelRemote::Load(const std::string &filePath
                                , FactorType factorType
                                , size_t nGramOrder)
@@ -24,12 +37,23 @@ bool LanguageModelRemote::Load(const std::string &filePath
 
   int cutAt = filePath.find(':',0);
   std::string host = filePath.substr(0,cutAt);
-  //std::cerr << "port string = '" << filePath.substr(cutAt+1,filePath.size()-cutAt) << "'\n";
-  int port = atoi(filePath.substr(cutAt+1,filePath.size()-cutAt).c_str());
-  bool good = start(host,port);
+  std::string port = filePath.substr(cutAt+1);
+  cutAt = port.find(':',0);
+  if (cutAt != (int)std::string::npos) {
+    m_multiGet = (port.substr(cutAt+1) == "batch");
+    port = port.substr(0,cutAt);
+  }
+  bool good = start(host,atoi(port.c_str()));
   if (!good) {
     std::cerr << "failed to connect to lm server on " << host << " on port " << port << std::endl;
   }
+
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  m_sentenceStart = factorCollection.AddFactor(Output, m_factorType, BOS_);
+  m_sentenceStartArray[m_factorType] = m_sentenceStart;
+  m_sentenceEnd = factorCollection.AddFactor(Output, m_factorType, EOS_);
+  m_sentenceEndArray[m_factorType] = m_sentenceEnd;
+
   ClearSentenceCache();
   return good;
 }
@@ -38,61 +62,71 @@ bool LanguageModelRemote::Load(const std::string &filePath
 bool LanguageModelRemote::start(const std::string& host, int port)
 {
   //std::cerr << "host = " << host << ", port = " << port << "\n";
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-  hp = gethostbyname(host.c_str());
+  struct hostent *hp = gethostbyname(host.c_str());
   if (hp==NULL) {
     herror("gethostbyname failed");
     exit(1);
   }
 
-  bzero((char *)&server, sizeof(server));
-  bcopy(hp->h_addr, (char *)&server.sin_addr, hp->h_length);
-  server.sin_family = hp->h_addrtype;
-  server.sin_port = htons(port);
+  bzero((char *)&m_server, sizeof(m_server));
+  bcopy(hp->h_addr, (char *)&m_server.sin_addr, hp->h_length);
+  m_server.sin_family = hp->h_addrtype;
+  m_server.sin_port = htons(port);
 
-  int errors = 0;
-  while (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
-    //std::cerr << "Error: connect()\n";
-    sleep(1);
-    errors++;
-    if (errors > 5) return false;
-  }
-  return true;
+  // the loading thread keeps this connection, decoding threads open their own
+  m_connection.reset(new Connection(m_server));
+  return m_connection->IsOpen();
 }
 
-LMResult LanguageModelRemote::GetValue(const std::vector<const Word*> &contextFactor, State* finalState) const
+LanguageModelRemote::Connection &LanguageModelRemote::GetConnection() const
 {
-  LMResult ret;
-  ret.unknown = false;
-  size_t count = contextFactor.size();
-  if (count == 0) {
-    if (finalState) *finalState = NULL;
-    ret.score = 0.0;
-    return ret;
+  Connection *connection = m_connection.get();
+  if (connection == NULL) {
+    connection = new Connection(m_server);
+    m_connection.reset(connection);
   }
-  //std::cerr << "contextFactor.size() = " << count << "\n";
-  size_t max = m_nGramOrder;
-  const FactorType factor = GetFactorType();
-  if (max > count) max = count;
+  if (!connection->IsOpen()) {
+    std::cerr << "failed to connect to lm server" << std::endl;
+    exit(1);
+  }
+  return *connection;
+}
+
+void LanguageModelRemote::ClearSentenceCache()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+  // m_curId is not reset: states handed out earlier may still be compared
+  m_cache.tree.clear();
+}
 
+LanguageModelRemote::Cache &LanguageModelRemote::Find(const LMContext &contextFactor) const
+{
+  const FactorType factor = GetFactorType();
   Cache* cur = &m_cache;
-  int pc = static_cast<int>(count) - 1;
+  int pc = static_cast<int>(contextFactor.size()) - 1;
   for (int i = 0; i < pc; ++i) {
     const Factor* f = contextFactor[i]->GetFactor(factor);
     cur = &cur->tree[f ? f : BOS];
   }
   const Factor* event_word = contextFactor[pc]->GetFactor(factor);
   cur = &cur->tree[event_word ? event_word : EOS];
-  if (cur->prob) {
-    if (finalState) *finalState = cur->boState;
-    ret.score = cur->prob;
-    return ret;
+  if (cur->boState == NULL) {
+    cur->boState = reinterpret_cast<State>(m_curId);
+    ++m_curId;
   }
-  cur->boState = *reinterpret_cast<const State*>(&m_curId);
-  ++m_curId;
+  return *cur;
+}
+
+void LanguageModelRemote::AppendNGram(std::ostream &os, const LMContext &contextFactor) const
+{
+  size_t count = contextFactor.size();
+  size_t max = m_nGramOrder;
+  const FactorType factor = GetFactorType();
+  if (max > count) max = count;
 
-  std::ostringstream os;
-  os << "prob ";
+  const Factor* event_word = contextFactor[count-1]->GetFactor(factor);
   if (event_word == NULL) {
     os << "</s>";
   } else {
@@ -106,39 +140,161 @@ LMResult LanguageModelRemote::GetValue(const std::vector<const Word*> &contextFa
       os << ' ' << f->GetString();
     }
   }
-  os << std::endl;
-  std::string out = os.str();
-  write(sock, out.c_str(), out.size());
-  char res[6];
-  int r = read(sock, res, 6);
-  int errors = 0;
-  int cnt = 0;
-  while (1) {
-    if (r < 0) {
-      errors++;
-      sleep(1);
-      //std::cerr << "Error: read()\n";
-      if (errors > 5) exit(1);
-    } else if (r==0 || res[cnt] == '\n') {
-      break;
-    } else {
-      cnt += r;
-      if (cnt==6) break;
-      read(sock, &res[cnt], 6-cnt);
+}
+
+void LanguageModelRemote::Query(const std::string &request, size_t count, float *probs) const
+{
+  Connection &connection = GetConnection();
+  if (!connection.Send(request)) {
+    std::cerr << "failed to send request to lm server" << std::endl;
+    exit(1);
+  }
+  // "mprob" is answered by count floats, each "prob" by a float; both end in \r\n
+  const size_t replySize = m_multiGet ? count * sizeof(float) + 2 : count * (sizeof(float) + 2);
+  std::vector<char> reply(replySize);
+  if (!connection.Receive(&reply.front(), replySize)) {
+    std::cerr << "failed to read reply from lm server" << std::endl;
+    exit(1);
+  }
+  const size_t stride = m_multiGet ? sizeof(float) : sizeof(float) + 2;
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(&probs[i], &reply[i * stride], sizeof(float));
+  }
+}
+
+void LanguageModelRemote::Score(const LMContext *ngrams, size_t count, LMResult *results, State *finalState) const
+{
+  std::vector<Cache*> nodes(count, static_cast<Cache*>(NULL));
+  std::vector<size_t> missing;
+  std::ostringstream request;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+    for (size_t i = 0; i < count; ++i) {
+      results[i].unknown = false;
+      results[i].score = 0.0;
+      if (ngrams[i].empty()) continue;
+      Cache &cur = Find(ngrams[i]);
+      nodes[i] = &cur;
+      if (cur.prob) {
+        results[i].score = cur.prob;
+        continue;
+      }
+      if (m_multiGet) {
+        request << (missing.empty() ? "mprob " : " | ");
+      } else {
+        request << "prob ";
+      }
+      AppendNGram(request, ngrams[i]);
+      if (!m_multiGet) request << '\n';
+      missing.push_back(i);
+    }
+  }
+
+  if (!missing.empty()) {
+    if (m_multiGet) request << '\n';
+    std::vector<float> probs(missing.size());
+    Query(request.str(), missing.size(), &probs.front());
+
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+    for (size_t i = 0; i < missing.size(); ++i) {
+      Cache &cur = *nodes[missing[i]];
+      cur.prob = FloorScore(TransformLMScore(probs[i]));
+      results[missing[i]].score = cur.prob;
     }
   }
-  cur->prob = FloorScore(TransformLMScore(*reinterpret_cast<float*>(res)));
-  if (finalState) {
-    *finalState = cur->boState;
+
+  if (finalState && count) {
+    *finalState = nodes[count - 1] ? nodes[count - 1]->boState : NULL;
   }
-  ret.score = cur->prob;
+}
+
+LMResult LanguageModelRemote::GetValue(const LMContext &contextFactor, State* finalState) const
+{
+  LMResult ret;
+  Score(&contextFactor, 1, &ret, finalState);
   return ret;
 }
 
+void LanguageModelRemote::GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const
+{
+  std::vector<LMContext> ngrams;
+  ngrams.reserve(end - begin);
+  for (size_t pos = begin ; pos < end ; ++pos) {
+    ngrams.push_back(GetNGram(words, pos));
+  }
+  if (!ngrams.empty()) {
+    Score(&ngrams.front(), ngrams.size(), results, &GetPointer(state));
+  }
+}
+
 LanguageModelRemote::~LanguageModelRemote()
+{
+}
+
+LanguageModelRemote::Connection::Connection(const struct sockaddr_in &server)
+{
+  m_sock = socket(AF_INET, SOCK_STREAM, 0);
+  int errors = 0;
+  while (connect(m_sock, (const struct sockaddr *)&server, sizeof(server)) < 0) {
+    //std::cerr << "Error: connect()\n";
+    sleep(1);
+    errors++;
+    if (errors > 5) {
+      close(m_sock);
+      m_sock = -1;
+      return;
+    }
+  }
+  // requests are small and answered before the next one is sent
+  int flag = 1;
+  setsockopt(m_sock, IPPROTO_TCP, TCP_NODELAY, (void *)&flag, sizeof(flag));
+}
+
+LanguageModelRemote::Connection::~Connection()
 {
   // Step 8 When finished send all lingering transmissions and close the connection
-  close(sock);
+  if (m_sock >= 0) close(m_sock);
+}
+
+bool LanguageModelRemote::Connection::Send(const std::string &request)
+{
+  const char *data = request.data();
+  size_t left = request.size();
+  while (left) {
+    ssize_t r = write(m_sock, data, left);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += r;
+    left -= r;
+  }
+  return true;
+}
+
+bool LanguageModelRemote::Connection::Receive(char *buffer, size_t size)
+{
+  int errors = 0;
+  while (size) {
+    ssize_t r = read(m_sock, buffer, size);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      errors++;
+      sleep(1);
+      //std::cerr << "Error: read()\n";
+      if (errors > 5) return false;
+    } else if (r == 0) {
+      return false;
+    } else {
+      buffer += r;
+      size -= r;
+    }
+  }
+  return true;
 }
 
 }
@@ -4,13 +4,25 @@
 #include "LM/SingleFactor.h"
 #include "TypeDef.h"
 #include "Factor.h"
+#include <map>
+#include <memory>
+#include <string>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
 namespace Moses
 {
 
+/** Language model served by contrib/lmserver.
+ *  The file name is host:port, or host:port:batch to send all n-grams missing
+ *  from the cache in one "mprob" request instead of pipelined "prob" requests.
+ */
 class LanguageModelRemote : public LanguageModelPointerState
 {
 private:
@@ -18,24 +30,59 @@ private:
     std::map<const Factor*, Cache> tree;
     float prob;
     State boState;
-    Cache() : prob(0) {}
+    Cache() : prob(0), boState(NULL) {}
+  };
+
+  //! a connection to the server; each decoding thread has its own
+  class Connection
+  {
+  public:
+    explicit Connection(const struct sockaddr_in &server);
+    ~Connection();
+
+    bool IsOpen() const {
+      return m_sock >= 0;
+    }
+    bool Send(const std::string &request);
+    bool Receive(char *buffer, size_t size);
+
+  private:
+    int m_sock;
   };
 
-  int sock, port;
-  struct hostent *hp;
-  struct sockaddr_in server;
+  struct sockaddr_in m_server;
+  bool m_multiGet;
   mutable size_t m_curId;
   mutable Cache m_cache;
-  bool start(const std::string& host, int port);
+#ifdef WITH_THREADS
+  mutable boost::mutex m_cacheMutex;
+  mutable boost::thread_specific_ptr<Connection> m_connection;
+#else
+  mutable std::auto_ptr<Connection> m_connection;
+#endif
+
   static const Factor* BOS;
   static const Factor* EOS;
+
+  bool start(const std::string& host, int port);
+  Connection &GetConnection() const;
+  Cache &Find(const LMContext &contextFactor) const;
+  void AppendNGram(std::ostream &out, const LMContext &contextFactor) const;
+  //! ask the server for the scores of the n-grams in request
+  void Query(const std::string &request, size_t count, float *probs) const;
+  //! score count n-grams with one round trip to the server for those not cached
+  void Score(const LMContext *ngrams, size_t count, LMResult *results, State *finalState) const;
+
 public:
+  LanguageModelRemote();
   ~LanguageModelRemote();
-  void ClearSentenceCache() {
-    m_cache.tree.clear();
-    m_curId = 1000;
+  void ClearSentenceCache();
+  //! the cache is locked and every thread has its own connection
+  bool IsSearchThreadSafe() const {
+    return true;
   }
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
+  virtual LMResult GetValue(const LMContext &contextFactor, State* finalState = 0) const;
+  virtual void GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const;
   bool Load(const std::string &filePath
             , FactorType factorType
             , size_t nGramOrder);
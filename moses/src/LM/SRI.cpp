@@ -132,7 +132,7 @@ LMResult LanguageModelSRI::GetValue(VocabIndex wordId, VocabIndex *context) cons
   return ret;
 }
 
-LMResult LanguageModelSRI::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+LMResult LanguageModelSRI::GetValue(const LMContext &contextFactor, State* finalState) const
 {
   LMResult ret;
   FactorType	factorType = GetFactorType();
@@ -56,7 +56,7 @@ public:
             , FactorType factorType
             , size_t nGramOrder);
 
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
+  virtual LMResult GetValue(const LMContext &contextFactor, State* finalState = 0) const;
 };
 
 
@@ -58,6 +58,15 @@ struct PointerState : public FFState {
     else if (other.lmstate < lmstate) return -1;
     return 0;
   }
+  // the backend's pointer is all a state holds. Its value differs from run
+  // to run, but only picks the slot of a hypothesis in the stack's table,
+  // which does not decide the order hypotheses are visited in
+  size_t Hash() const {
+    return reinterpret_cast<size_t>(lmstate);
+  }
+  bool Equal(const FFState& o) const {
+    return lmstate == static_cast<const PointerState&>(o).lmstate;
+  }
 };
 
 LanguageModelPointerState::LanguageModelPointerState()
@@ -83,9 +92,22 @@ FFState *LanguageModelPointerState::NewState(const FFState *from) const
   return new PointerState(from ? static_cast<const PointerState*>(from)->lmstate : NULL);
 }
 
-LMResult LanguageModelPointerState::GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const
+LMResult LanguageModelPointerState::GetValueForgotState(const LMContext &contextFactor, FFState &outState) const
+{
+  return GetValue(contextFactor, &GetPointer(outState));
+}
+
+void LanguageModelPointerState::GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const
+{
+  State &finalState = GetPointer(state);
+  for (size_t pos = begin ; pos < end ; ++pos) {
+    *results++ = GetValue(GetNGram(words, pos), &finalState);
+  }
+}
+
+LanguageModelPointerState::State &LanguageModelPointerState::GetPointer(FFState &state)
 {
-  return GetValue(contextFactor, &static_cast<PointerState&>(outState).lmstate);
+  return static_cast<PointerState&>(state).lmstate;
 }
 
 }
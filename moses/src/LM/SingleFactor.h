@@ -81,9 +81,15 @@ protected:
   virtual const FFState *GetBeginSentenceState() const;
   virtual FFState *NewState(const FFState *from = NULL) const;
 
-  virtual LMResult GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const;
+  virtual LMResult GetValueForgotState(const LMContext &contextFactor, FFState &outState) const;
 
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = NULL) const = 0;
+  //! calls GetValue() directly for each n-gram
+  virtual void GetValues(const Word *const *words, size_t begin, size_t end, FFState &state, LMResult *results) const;
+
+  //! the backend state held by a state of this LM
+  static State &GetPointer(FFState &state);
+
+  virtual LMResult GetValue(const LMContext &contextFactor, State* finalState = NULL) const = 0;
 };
 
 
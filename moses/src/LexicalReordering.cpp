@@ -3,6 +3,7 @@
 #include "FFState.h"
 #include "LexicalReordering.h"
 #include "LexicalReorderingState.h"
+#include "Manager.h"
 #include "StaticData.h"
 
 namespace Moses
@@ -78,7 +79,7 @@ FFState* LexicalReordering::Evaluate(const Hypothesis& hypo,
 {
   Scores score(GetNumScoreComponents(), 0);
   const LexicalReorderingState *prev = dynamic_cast<const LexicalReorderingState *>(prev_state);
-  LexicalReorderingState *next_state = prev->Expand(hypo.GetTranslationOption(), score);
+  LexicalReorderingState *next_state = prev->Expand(hypo.GetTranslationOption(), score, hypo.GetArena());
 
   out->PlusEquals(this, score);
 
@@ -49,6 +49,11 @@ public:
 
   virtual const FFState* EmptyHypothesisState(const InputType &input) const;
 
+  //! the table is only read when translation options are collected, Evaluate() uses their cached scores
+  virtual bool IsSearchThreadSafe() const {
+    return true;
+  }
+
   virtual std::string GetScoreProducerDescription(unsigned) const {
     return "LexicalReordering_" + m_modelTypeString;
   }
@@ -1,6 +1,7 @@
 
 #include <vector>
 #include <string>
+#include <boost/functional/hash.hpp>
 #include "util/check.hh"
 
 #include "FFState.h"
@@ -115,7 +116,7 @@ LexicalReorderingState *LexicalReorderingConfiguration::CreateLexicalReorderingS
       return fwd;
   }
 
-  return new BidirectionalReorderingState(*this, bwd, fwd, 0);
+  return new BidirectionalReorderingState(*this, bwd, fwd, 0, false);
 }
 
 void LexicalReorderingState::CopyScores(Scores& scores, const TranslationOption &topt, ReorderingType reoType) const
@@ -168,6 +169,15 @@ int LexicalReorderingState::ComparePrevScores(const Scores *other) const
   return 0;
 }
 
+size_t LexicalReorderingState::HashPrevScores() const
+{
+  if(m_prevScore == NULL)
+    return 0;
+
+  const Scores &my = *m_prevScore;
+  return boost::hash_range(my.begin() + m_offset, my.begin() + m_offset + m_configuration.GetNumberOfTypes());
+}
+
 PhraseBasedReorderingState::PhraseBasedReorderingState(const PhraseBasedReorderingState *prev, const TranslationOption &topt)
   : LexicalReorderingState(prev, topt), m_prevRange(topt.GetSourceWordsRange()), m_first(false) {}
 
@@ -196,7 +206,28 @@ int PhraseBasedReorderingState::Compare(const FFState& o) const
   return 1;
 }
 
-LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
+size_t PhraseBasedReorderingState::Hash() const
+{
+  size_t seed = m_prevRange.GetStartPos();
+  boost::hash_combine(seed, m_prevRange.GetEndPos());
+  if (m_direction == LexicalReorderingConfiguration::Forward)
+    boost::hash_combine(seed, HashPrevScores());
+  return seed;
+}
+
+bool PhraseBasedReorderingState::Equal(const FFState& o) const
+{
+  if (&o == this)
+    return true;
+
+  const PhraseBasedReorderingState &other = static_cast<const PhraseBasedReorderingState&>(o);
+  if (!(m_prevRange == other.m_prevRange))
+    return false;
+  return m_direction != LexicalReorderingConfiguration::Forward
+         || ComparePrevScores(other.m_prevScore) == 0;
+}
+
+LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOption& topt, Scores& scores, MemoryArena &arena) const
 {
   ReorderingType reoType;
   const WordsRange currWordsRange = topt.GetSourceWordsRange();
@@ -218,7 +249,7 @@ LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOpti
     CopyScores(scores, topt, reoType);
   }
 
-  return new PhraseBasedReorderingState(this, topt);
+  return new (arena) PhraseBasedReorderingState(this, topt);
 }
 
 LexicalReorderingState::ReorderingType PhraseBasedReorderingState::GetOrientationTypeMSD(WordsRange currRange) const
@@ -293,11 +324,27 @@ int BidirectionalReorderingState::Compare(const FFState& o) const
     return m_forward->Compare(*other.m_forward);
 }
 
-LexicalReorderingState* BidirectionalReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
+size_t BidirectionalReorderingState::Hash() const
 {
-  LexicalReorderingState *newbwd = m_backward->Expand(topt, scores);
-  LexicalReorderingState *newfwd = m_forward->Expand(topt, scores);
-  return new BidirectionalReorderingState(m_configuration, newbwd, newfwd, m_offset);
+  size_t seed = m_backward->Hash();
+  boost::hash_combine(seed, m_forward->Hash());
+  return seed;
+}
+
+bool BidirectionalReorderingState::Equal(const FFState& o) const
+{
+  if (&o == this)
+    return true;
+
+  const BidirectionalReorderingState &other = static_cast<const BidirectionalReorderingState &>(o);
+  return m_backward->Equal(*other.m_backward) && m_forward->Equal(*other.m_forward);
+}
+
+LexicalReorderingState* BidirectionalReorderingState::Expand(const TranslationOption& topt, Scores& scores, MemoryArena &arena) const
+{
+  LexicalReorderingState *newbwd = m_backward->Expand(topt, scores, arena);
+  LexicalReorderingState *newfwd = m_forward->Expand(topt, scores, arena);
+  return new (arena) BidirectionalReorderingState(m_configuration, newbwd, newfwd, m_offset, true);
 }
 
 ///////////////////////////
@@ -317,10 +364,21 @@ int HierarchicalReorderingBackwardState::Compare(const FFState& o) const
   return m_reoStack.Compare(other.m_reoStack);
 }
 
-LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const TranslationOption& topt, Scores& scores) const
+size_t HierarchicalReorderingBackwardState::Hash() const
+{
+  return m_reoStack.Hash();
+}
+
+bool HierarchicalReorderingBackwardState::Equal(const FFState& o) const
+{
+  const HierarchicalReorderingBackwardState& other = static_cast<const HierarchicalReorderingBackwardState&>(o);
+  return m_reoStack.Equal(other.m_reoStack);
+}
+
+LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const TranslationOption& topt, Scores& scores, MemoryArena &arena) const
 {
 
-  HierarchicalReorderingBackwardState* nextState = new HierarchicalReorderingBackwardState(this, topt, m_reoStack);
+  HierarchicalReorderingBackwardState* nextState = new (arena) HierarchicalReorderingBackwardState(this, topt, m_reoStack);
   ReorderingType reoType;
   const LexicalReorderingConfiguration::ModelType modelType = m_configuration.GetModelType();
 
@@ -409,6 +467,23 @@ int HierarchicalReorderingForwardState::Compare(const FFState& o) const
   return 1;
 }
 
+size_t HierarchicalReorderingForwardState::Hash() const
+{
+  size_t seed = m_prevRange.GetStartPos();
+  boost::hash_combine(seed, m_prevRange.GetEndPos());
+  boost::hash_combine(seed, HashPrevScores());
+  return seed;
+}
+
+bool HierarchicalReorderingForwardState::Equal(const FFState& o) const
+{
+  if (&o == this)
+    return true;
+
+  const HierarchicalReorderingForwardState &other = static_cast<const HierarchicalReorderingForwardState&>(o);
+  return m_prevRange == other.m_prevRange && ComparePrevScores(other.m_prevScore) == 0;
+}
+
 // For compatibility with the phrase-based reordering model, scoring is one step delayed.
 // The forward model takes determines orientations heuristically as follows:
 //  mono:   if the next phrase comes after the conditioning phrase and
@@ -420,7 +495,7 @@ int HierarchicalReorderingForwardState::Compare(const FFState& o) const
 //  dright: if the next phrase follows the conditioning phrase and other stuff comes in between
 //  dleft:  if the next phrase precedes the conditioning phrase and other stuff comes in between
 
-LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const TranslationOption& topt, Scores& scores) const
+LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const TranslationOption& topt, Scores& scores, MemoryArena &arena) const
 {
   const LexicalReorderingConfiguration::ModelType modelType = m_configuration.GetModelType();
   const WordsRange currWordsRange = topt.GetSourceWordsRange();
@@ -446,10 +521,10 @@ LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const Transla
     CopyScores(scores, topt, reoType);
   }
 
-  return new HierarchicalReorderingForwardState(this, topt);
+  return new (arena) HierarchicalReorderingForwardState(this, topt);
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -461,7 +536,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return D;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -475,7 +550,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return DL;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -484,7 +559,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return NM;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, WordsBitmap /* coverage */) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, const WordsBitmap &/* coverage */) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos()) {
     return R;
@@ -7,6 +7,7 @@
 #include "FFState.h"
 #include "Hypothesis.h"
 #include "LexicalReordering.h"
+#include "MemoryArena.h"
 #include "WordsRange.h"
 #include "WordsBitmap.h"
 #include "ReorderingStack.h"
@@ -71,7 +72,9 @@ class LexicalReorderingState : public FFState
 public:
 
   virtual int Compare(const FFState& o) const = 0;
-  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores) const = 0;
+  virtual size_t Hash() const = 0;
+  virtual bool Equal(const FFState& o) const = 0;
+  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores, MemoryArena &arena) const = 0;
 
   static LexicalReorderingState* CreateLexicalReorderingState(const std::vector<std::string>& config,
       LexicalReorderingConfiguration::Direction dir, const InputType &input);
@@ -96,6 +99,7 @@ protected:
   void CopyScores(Scores& scores, const TranslationOption& topt, ReorderingType reoType) const;
   void ClearScores(Scores& scores) const;
   int ComparePrevScores(const Scores *other) const;
+  size_t HashPrevScores() const;
 
   //constants for the different type of reorderings (corresponding to indexes in the table file)
   static const ReorderingType M = 0;  // monotonic
@@ -113,17 +117,25 @@ class BidirectionalReorderingState : public LexicalReorderingState
 private:
   const LexicalReorderingState *m_backward;
   const LexicalReorderingState *m_forward;
+  bool m_inArena; //! whether the two states were created by Expand() in an arena
 public:
-  BidirectionalReorderingState(const LexicalReorderingConfiguration &config, const LexicalReorderingState *bw, const LexicalReorderingState *fw, size_t offset) :
-    LexicalReorderingState(config, LexicalReorderingConfiguration::Bidirectional, offset), m_backward(bw), m_forward(fw) {}
+  BidirectionalReorderingState(const LexicalReorderingConfiguration &config, const LexicalReorderingState *bw, const LexicalReorderingState *fw, size_t offset, bool inArena) :
+    LexicalReorderingState(config, LexicalReorderingConfiguration::Bidirectional, offset), m_backward(bw), m_forward(fw), m_inArena(inArena) {}
 
   ~BidirectionalReorderingState() {
-    delete m_backward;
-    delete m_forward;
+    if (m_inArena) {
+      m_backward->~LexicalReorderingState();
+      m_forward->~LexicalReorderingState();
+    } else {
+      delete m_backward;
+      delete m_forward;
+    }
   }
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& topt, Scores& scores) const;
+  virtual size_t Hash() const;
+  virtual bool Equal(const FFState& o) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& topt, Scores& scores, MemoryArena &arena) const;
 };
 
 //! State for the standard Moses implementation of lexical reordering models
@@ -138,7 +150,9 @@ public:
   PhraseBasedReorderingState(const PhraseBasedReorderingState *prev, const TranslationOption &topt);
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& topt, Scores& scores) const;
+  virtual size_t Hash() const;
+  virtual bool Equal(const FFState& o) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& topt, Scores& scores, MemoryArena &arena) const;
 
   ReorderingType GetOrientationTypeMSD(WordsRange currRange) const;
   ReorderingType GetOrientationTypeMSLR(WordsRange currRange) const;
@@ -159,7 +173,9 @@ public:
                                       const TranslationOption &topt, ReorderingStack reoStack);
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores) const;
+  virtual size_t Hash() const;
+  virtual bool Equal(const FFState& o) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores, MemoryArena &arena) const;
 
 private:
   ReorderingType GetOrientationTypeMSD(int reoDistance) const;
@@ -182,13 +198,15 @@ public:
   HierarchicalReorderingForwardState(const HierarchicalReorderingForwardState *prev, const TranslationOption &topt);
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores) const;
+  virtual size_t Hash() const;
+  virtual bool Equal(const FFState& o) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores, MemoryArena &arena) const;
 
 private:
-  ReorderingType GetOrientationTypeMSD(WordsRange currRange, WordsBitmap coverage) const;
-  ReorderingType GetOrientationTypeMSLR(WordsRange currRange, WordsBitmap coverage) const;
-  ReorderingType GetOrientationTypeMonotonic(WordsRange currRange, WordsBitmap coverage) const;
-  ReorderingType GetOrientationTypeLeftRight(WordsRange currRange, WordsBitmap coverage) const;
+  ReorderingType GetOrientationTypeMSD(WordsRange currRange, const WordsBitmap &coverage) const;
+  ReorderingType GetOrientationTypeMSLR(WordsRange currRange, const WordsBitmap &coverage) const;
+  ReorderingType GetOrientationTypeMonotonic(WordsRange currRange, const WordsBitmap &coverage) const;
+  ReorderingType GetOrientationTypeLeftRight(WordsRange currRange, const WordsBitmap &coverage) const;
 };
 
 }
@@ -3,6 +3,8 @@
 //#include "LVoc.h" //need IPhrase
 
 #include "StaticData.h"
+#include "InputFilter.h"
+#include "ModelSnapshot.h"
 #include "PhraseDictionary.h"
 #include "GenerationDictionary.h"
 #include "TargetPhrase.h"
@@ -161,6 +163,37 @@ std::string  LexicalReorderingTableMemory::MakeKey(const std::string& f,
 
 void  LexicalReorderingTableMemory::LoadFromFile(const std::string& filePath)
 {
+  // entries whose source phrase is not in the input are skipped
+  const InputFilter *filter = m_FactorsF.empty() ? NULL : StaticData::Instance().GetInputFilter();
+
+  // restore the table from its image if there is one for these settings
+  ModelSnapshot *snapshot = StaticData::Instance().GetModelSnapshot();
+  std::ostringstream settings;
+  if (snapshot) {
+    settings << "factors=";
+    ModelSnapshot::AddFactors(settings, m_FactorsF);
+    settings << "/";
+    ModelSnapshot::AddFactors(settings, m_FactorsE);
+    settings << "/";
+    ModelSnapshot::AddFactors(settings, m_FactorsC);
+    settings << " filter=";
+    if (filter)
+      ModelSnapshot::AddFile(settings, filter->GetFilePath());
+
+    SnapshotReader reader;
+    if (snapshot->Open(reader, "reordering-table", filePath, settings.str())) {
+      std::vector<float> scores;
+      const size_t size = reader.ReadSize();
+      for (size_t i = 0; i < size; ++i) {
+        const StringPiece key = reader.ReadString();
+        reader.ReadScores(scores);
+        m_Table.insert(m_Table.end(), TableType::value_type(key.as_string(), scores));
+      }
+      CHECK(reader.AtEnd());
+      return;
+    }
+  }
+
   std::string fileName = filePath;
   if(!FileExists(fileName) && FileExists(fileName+".gz")) {
     fileName += ".gz";
@@ -168,6 +201,10 @@ void  LexicalReorderingTableMemory::LoadFromFile(const std::string& filePath)
   InputFileStream file(fileName);
   std::string line(""), key("");
   int numScores = -1;
+  if (filter)
+    filter->Index(m_FactorsF);
+  std::string preFilterString;
+  bool preFilterKeep = true;
   std::cerr << "Loading table into memory...";
   while(!getline(file, line).eof()) {
     std::vector<std::string> tokens = TokenizeMultiCharSeparator(line, "|||");
@@ -178,6 +215,13 @@ void  LexicalReorderingTableMemory::LoadFromFile(const std::string& filePath)
       //there should be something for f
       f = auxClearString(tokens.at(t));
       ++t;
+      if(filter) {
+        if(f != preFilterString) {
+          preFilterString = f;
+          preFilterKeep = filter->IsInInput(f, m_FactorsF);
+        }
+        if(!preFilterKeep) continue;
+      }
     }
     if(!m_FactorsE.empty()) {
       //there should be something for e
@@ -205,6 +249,18 @@ void  LexicalReorderingTableMemory::LoadFromFile(const std::string& filePath)
     m_Table[MakeKey(f,e,c)] = p;
   }
   std::cerr << "done.\n";
+
+  if (snapshot) {
+    SnapshotWriter writer;
+    if (snapshot->Create(writer, "reordering-table", filePath, settings.str())) {
+      writer.WriteSize(m_Table.size());
+      for (TableType::const_iterator iter = m_Table.begin(); iter != m_Table.end(); ++iter) {
+        writer.WriteString(iter->first);
+        writer.WriteScores(iter->second);
+      }
+      snapshot->Commit(writer);
+    }
+  }
 }
 
 /*
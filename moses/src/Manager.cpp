@@ -28,12 +28,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
-#include "TrellisPathCollection.h"
+#include "NBestExtractor.h"
 #include "TranslationOption.h"
 #include "LexicalReordering.h"
 #include "LMList.h"
@@ -67,6 +68,13 @@ Manager::~Manager()
 
   m_system->CleanUpAfterSentenceProcessing();
 
+  // LM query caches add their counts to the stats when cleaned up
+  if (m_sentenceStats.get() && m_sentenceStats->GetNumLMCacheLookups() > 0) {
+    const SentenceStats &stats = *m_sentenceStats;
+    VERBOSE(2, "LM query cache: " << stats.GetNumLMCacheHits() << " hits in " << stats.GetNumLMCacheLookups()
+            << " lookups (" << (int)(100.0 * stats.GetNumLMCacheHits() / stats.GetNumLMCacheLookups()) << "%)" << endl);
+  }
+
   clock_t end = clock();
   float et = (end - m_start);
   et /= (float)CLOCKS_PER_SEC;
@@ -191,8 +199,8 @@ void Manager::printThisHypothesis(long translationId, const Hypothesis* hypo, co
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
- * this function controls this for one sentence.
+ * The heavy lifting is done in the NBestExtractor, which enumerates the
+ * paths lazily; this function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
  * \param ret holds the n-best list that was calculated
@@ -209,49 +217,22 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  // paths come out best first, sharing their beginnings until one is output
+  NBestExtractor extractor(sortedPureHypo);
 
-  set<Phrase> distinctHyps;
-
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  boost::unordered_set<Phrase> distinctHyps;
 
   // factor defines stopping point for distinct n-best list if too many candidates identical
   size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
-    // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    CHECK(path);
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
-    if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
-        delete path;
-        path = NULL;
-      }
-    } else {
-      ret.Add(path);
-    }
-
-
-    if(onlyDistinct) {
-      const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
-    }
+  for (size_t iteration = 0 ; ret.GetSize() < count && (iteration < count * nBestFactor) ; iteration++) {
+    if (!extractor.Next())
+      break;
+    if (onlyDistinct && !distinctHyps.insert(extractor.GetSurfacePhrase()).second)
+      continue;
+    ret.Add(extractor.CreatePath());
   }
 }
 
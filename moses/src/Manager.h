@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <ctime>
 #include "InputType.h"
 #include "Hypothesis.h"
+#include "MemoryArena.h"
 #include "StaticData.h"
 #include "TranslationOption.h"
 #include "TranslationOptionCollection.h"
@@ -96,6 +97,8 @@ class Manager
   const TranslationSystem* m_system;
 protected:
   // data
+  MemoryArena m_arena; /**< hypotheses, their states and arc lists for this sentence */
+  std::vector<void*> m_freeHypotheses; /**< slots in m_arena of destroyed hypotheses */
 //	InputType const& m_source; /**< source sentence to be translated */
   TranslationOptionCollection *m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   Search *m_search;
@@ -133,6 +136,22 @@ public:
   void printThisHypothesis(long translationId, const Hypothesis* hypo, const std::vector <const TargetPhrase* > & remainingPhrases, float remainingScore , std::ostream& outputStream) const;
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
+
+  //! per-sentence memory for the search space, released with the Manager
+  MemoryArena &GetArena() {
+    return m_arena;
+  }
+  //! memory for a new Hypothesis, reusing the slot of a destroyed one if possible
+  void *AllocateHypothesis() {
+    if (m_freeHypotheses.empty())
+      return m_arena.Allocate(sizeof(Hypothesis));
+    void *ret = m_freeHypotheses.back();
+    m_freeHypotheses.pop_back();
+    return ret;
+  }
+  void FreeHypothesis(void *hypo) {
+    m_freeHypotheses.push_back(hypo);
+  }
 #ifdef HAVE_PROTOBUF
   void SerializeSearchGraphPB(long translationId, std::ostream& outputStream) const;
 #endif
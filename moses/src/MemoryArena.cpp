@@ -0,0 +1,68 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdlib>
+#include "MemoryArena.h"
+
+namespace Moses
+{
+
+MemoryArena::~MemoryArena()
+{
+  for (size_t i = 0; i < m_blocks.size(); ++i) {
+    free(m_blocks[i].first);
+  }
+}
+
+size_t MemoryArena::GetReserved() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < m_blocks.size(); ++i) {
+    ret += m_blocks[i].second;
+  }
+  return ret;
+}
+
+bool MemoryArena::Contains(const void *ptr) const
+{
+  const char *mem = static_cast<const char*>(ptr);
+  // most lookups are for recent allocations, so start with the newest block
+  for (size_t i = m_blocks.size(); i > 0; --i) {
+    const std::pair<char*, size_t> &block = m_blocks[i - 1];
+    if (mem >= block.first && mem < block.first + block.second)
+      return true;
+  }
+  return false;
+}
+
+void MemoryArena::NewBlock(size_t minSize)
+{
+  // oversized requests get a block of their own
+  size_t size = (minSize > m_blockSize) ? minSize : m_blockSize;
+  char *block = static_cast<char*>(malloc(size));
+  if (block == NULL) throw std::bad_alloc();
+  m_blocks.push_back(std::make_pair(block, size));
+  m_current = block;
+  m_end = block + size;
+  // grow geometrically so long sentences need few blocks
+  if (m_blockSize < 16 * 1024 * 1024)
+    m_blockSize *= 2;
+}
+
+}
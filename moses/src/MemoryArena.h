@@ -0,0 +1,154 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_MemoryArena_h
+#define moses_MemoryArena_h
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace Moses
+{
+
+/** Bump allocator for objects that live as long as the search of one
+ * sentence (hypotheses, feature function states, arc lists).
+ * Memory is carved out of large blocks and only returned when the arena is
+ * destroyed, so a whole search space is released in a handful of frees.
+ * Destructors of objects placed in the arena are not run by the arena.
+ * Each Manager owns one arena; it is not thread safe.
+ */
+class MemoryArena
+{
+public:
+  explicit MemoryArena(size_t blockSize = 64 * 1024)
+    : m_blockSize(blockSize)
+    , m_current(NULL)
+    , m_end(NULL)
+    , m_allocated(0) {
+  }
+
+  ~MemoryArena();
+
+  //! memory for size bytes, aligned for any fundamental type
+  void *Allocate(size_t size) {
+    size = Aligned(size);
+    if (static_cast<size_t>(m_end - m_current) < size)
+      NewBlock(size);
+    void *ret = m_current;
+    m_current += size;
+    m_allocated += size;
+    return ret;
+  }
+
+  //! number of bytes handed out so far
+  size_t GetAllocated() const {
+    return m_allocated;
+  }
+
+  //! number of bytes reserved from the system
+  size_t GetReserved() const;
+
+  //! whether ptr points into memory of this arena
+  bool Contains(const void *ptr) const;
+
+  //! bytes taken by an allocation of size bytes
+  static size_t Aligned(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+private:
+  static const size_t ALIGNMENT = 16;
+
+  MemoryArena(const MemoryArena &); // not implemented
+  MemoryArena &operator=(const MemoryArena &); // not implemented
+
+  void NewBlock(size_t minSize);
+
+  size_t m_blockSize;
+  char *m_current, *m_end;
+  size_t m_allocated;
+  std::vector<std::pair<char*, size_t> > m_blocks;
+};
+
+/** STL allocator drawing from a MemoryArena. Deallocation is a no-op; the
+ * memory is reclaimed with the arena.
+ */
+template <class T> class ArenaAllocator
+{
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <class U> struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  explicit ArenaAllocator(MemoryArena &arena) : m_arena(&arena) {}
+  template <class U> ArenaAllocator(const ArenaAllocator<U> &other) : m_arena(other.GetArena()) {}
+
+  pointer address(reference x) const {
+    return &x;
+  }
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  pointer allocate(size_type n, const void * = 0) {
+    return static_cast<pointer>(m_arena->Allocate(n * sizeof(T)));
+  }
+  void deallocate(pointer, size_type) {}
+
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  void construct(pointer p, const T &val) {
+    new (p) T(val);
+  }
+  void destroy(pointer p) {
+    p->~T();
+  }
+
+  MemoryArena *GetArena() const {
+    return m_arena;
+  }
+
+private:
+  MemoryArena *m_arena;
+};
+
+template <class T, class U> inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+  return a.GetArena() == b.GetArena();
+}
+
+template <class T, class U> inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+  return a.GetArena() != b.GetArena();
+}
+
+}
+#endif
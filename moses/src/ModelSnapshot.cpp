@@ -0,0 +1,366 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/static_assert.hpp>
+
+#include "util/check.hh"
+#include "util/exception.hh"
+#include "util/murmur_hash.hh"
+
+#include "ModelSnapshot.h"
+#include "AlignmentInfo.h"
+#include "FactorCollection.h"
+#include "LMList.h"
+#include "Phrase.h"
+#include "StaticData.h"
+#include "UserMessage.h"
+#include "Util.h"
+#include "Word.h"
+
+namespace Moses
+{
+
+namespace
+{
+const char kMagic[] = "MosesImg";
+const size_t kMagicSize = sizeof(kMagic) - 1;
+const size_t kVersion = 1;
+
+// the flags of a word are a bit per factor after the non-terminal bit
+BOOST_STATIC_ASSERT(MAX_NUM_FACTORS < 63);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+  if (m_out.is_open()) {
+    m_out.close();
+    std::remove(m_tempPath.c_str());
+  }
+}
+
+bool SnapshotWriter::Create(const std::string &path, const std::string &key)
+{
+  m_path = path;
+  // several processes may write the same image at the same time
+  std::ostringstream tempPath;
+  tempPath << path << ".tmp." << getpid();
+  m_tempPath = tempPath.str();
+
+  m_out.open(m_tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_out.good()) {
+    TRACE_ERR("WARNING: cannot write model image " << m_tempPath << std::endl);
+    return false;
+  }
+  m_out.write(kMagic, kMagicSize);
+  WriteSize(kVersion);
+  WriteString(key);
+  return true;
+}
+
+bool SnapshotWriter::Commit()
+{
+  m_out.write(kMagic, kMagicSize);
+  m_out.close();
+  if (m_out.fail() || std::rename(m_tempPath.c_str(), m_path.c_str()) != 0) {
+    TRACE_ERR("WARNING: failed to write model image " << m_path << std::endl);
+    std::remove(m_tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+void SnapshotWriter::WriteSize(size_t value)
+{
+  char buffer[10];
+  size_t size = 0;
+  while (value >= 0x80) {
+    buffer[size++] = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buffer[size++] = static_cast<char>(value);
+  m_out.write(buffer, size);
+}
+
+void SnapshotWriter::WriteFloat(float value)
+{
+  m_out.write(reinterpret_cast<const char*>(&value), sizeof(float));
+}
+
+void SnapshotWriter::WriteString(const StringPiece &value)
+{
+  WriteSize(value.size());
+  m_out.write(value.data(), value.size());
+}
+
+void SnapshotWriter::WriteFactor(const Factor *factor)
+{
+  std::pair<boost::unordered_map<const Factor*, size_t>::iterator, bool> ret =
+    m_factorIds.insert(std::make_pair(factor, m_factorIds.size()));
+  WriteSize(ret.first->second);
+  if (ret.second) {
+    WriteString(factor->GetString());
+  }
+}
+
+void SnapshotWriter::WriteWord(const Word &word)
+{
+  // which factors are set, and whether it's a non-terminal
+  size_t flags = word.IsNonTerminal() ? 1 : 0;
+  for (size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+    if (word[i] != NULL)
+      flags |= size_t(2) << i;
+  }
+  WriteSize(flags);
+  for (size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+    if (word[i] != NULL)
+      WriteFactor(word[i]);
+  }
+}
+
+void SnapshotWriter::WritePhrase(const Phrase &phrase)
+{
+  WriteSize(phrase.GetSize());
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    WriteWord(phrase.GetWord(pos));
+  }
+}
+
+void SnapshotWriter::WriteScores(const std::vector<float> &scores)
+{
+  WriteSize(scores.size());
+  for (size_t i = 0; i < scores.size(); ++i) {
+    WriteFloat(scores[i]);
+  }
+}
+
+void SnapshotWriter::WriteAlignment(const AlignmentInfo &alignment)
+{
+  WriteSize(alignment.GetSize());
+  for (AlignmentInfo::const_iterator iter = alignment.begin(); iter != alignment.end(); ++iter) {
+    WriteSize(iter->first);
+    WriteSize(iter->second);
+  }
+}
+
+bool SnapshotReader::Open(const std::string &path, const std::string &key)
+{
+  if (!FileExists(path))
+    return false;
+  try {
+    m_file.reset(util::OpenReadOrThrow(path.c_str()));
+    const uint64_t size = util::SizeFile(m_file.get());
+    if (size == util::kBadSize || size < 2 * kMagicSize)
+      return false;
+    util::MapRead(util::POPULATE_OR_READ, m_file.get(), 0, size, m_mem);
+  } catch (const util::Exception &e) {
+    TRACE_ERR("WARNING: cannot read model image " << path << ": " << e.what() << std::endl);
+    return false;
+  }
+
+  const char *begin = static_cast<const char*>(m_mem.get());
+  m_pos = begin;
+  m_end = begin + m_mem.size() - kMagicSize;
+  if (std::memcmp(begin, kMagic, kMagicSize) != 0 || std::memcmp(m_end, kMagic, kMagicSize) != 0) {
+    TRACE_ERR("WARNING: " << path << " is not a complete model image" << std::endl);
+    return false;
+  }
+  m_pos += kMagicSize;
+  return ReadSize() == kVersion && ReadString() == key;
+}
+
+void SnapshotReader::Read(void *to, size_t size)
+{
+  CHECK(m_pos + size <= m_end);
+  std::memcpy(to, m_pos, size);
+  m_pos += size;
+}
+
+size_t SnapshotReader::ReadSize()
+{
+  size_t value = 0;
+  for (size_t shift = 0; ; shift += 7) {
+    CHECK(m_pos < m_end);
+    const unsigned char byte = static_cast<unsigned char>(*m_pos++);
+    value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+float SnapshotReader::ReadFloat()
+{
+  float value;
+  Read(&value, sizeof(float));
+  return value;
+}
+
+StringPiece SnapshotReader::ReadString()
+{
+  const size_t size = ReadSize();
+  CHECK(m_pos + size <= m_end);
+  StringPiece value(m_pos, size);
+  m_pos += size;
+  return value;
+}
+
+const Factor *SnapshotReader::ReadFactor()
+{
+  const size_t id = ReadSize();
+  if (id == m_factors.size()) {
+    m_factors.push_back(FactorCollection::Instance().AddFactor(ReadString()));
+  }
+  CHECK(id < m_factors.size());
+  return m_factors[id];
+}
+
+void SnapshotReader::ReadWord(Word &word)
+{
+  const size_t flags = ReadSize();
+  word.SetIsNonTerminal(flags & 1);
+  for (size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+    if (flags & (size_t(2) << i))
+      word[i] = ReadFactor();
+  }
+}
+
+void SnapshotReader::ReadPhrase(Phrase &phrase)
+{
+  const size_t size = ReadSize();
+  phrase.Reserve(phrase.GetSize() + size);
+  for (size_t pos = 0; pos < size; ++pos) {
+    ReadWord(phrase.AddWord());
+  }
+}
+
+void SnapshotReader::ReadScores(std::vector<float> &scores)
+{
+  scores.resize(ReadSize());
+  for (size_t i = 0; i < scores.size(); ++i) {
+    scores[i] = ReadFloat();
+  }
+}
+
+void SnapshotReader::ReadAlignment(std::set<std::pair<size_t,size_t> > &alignment)
+{
+  const size_t size = ReadSize();
+  for (size_t i = 0; i < size; ++i) {
+    const size_t sourcePos = ReadSize();
+    alignment.insert(std::make_pair(sourcePos, ReadSize()));
+  }
+}
+
+std::string ModelSnapshot::GetImagePath(const std::string &kind, const std::string &filePath) const
+{
+  std::ostringstream path;
+  path << m_dir << "/" << kind << "." << std::hex
+       << util::MurmurHash64A(filePath.data(), filePath.size()) << ".img";
+  return path.str();
+}
+
+bool ModelSnapshot::Open(SnapshotReader &reader, const std::string &kind
+                         , const std::string &filePath, const std::string &settings)
+{
+  const std::string path = GetImagePath(kind, filePath);
+  if (!reader.Open(path, GetKey(kind, filePath, settings))) {
+    VERBOSE(2, "No model image of " << filePath << " for these settings in " << m_dir << std::endl);
+    return false;
+  }
+  VERBOSE(1, "Restoring " << filePath << " from " << path << std::endl);
+  ++m_restored;
+  return true;
+}
+
+bool ModelSnapshot::Create(SnapshotWriter &writer, const std::string &kind
+                           , const std::string &filePath, const std::string &settings) const
+{
+  return writer.Create(GetImagePath(kind, filePath), GetKey(kind, filePath, settings));
+}
+
+std::string ModelSnapshot::GetKey(const std::string &kind, const std::string &filePath
+                                  , const std::string &settings) const
+{
+  // an image of an older version of the model file is not used
+  std::ostringstream key;
+  key << kind << "\n";
+  AddFile(key, filePath);
+  key << "\n" << settings;
+  return key.str();
+}
+
+void ModelSnapshot::AddFactors(std::ostream &settings, const std::vector<FactorType> &factors)
+{
+  for (size_t i = 0; i < factors.size(); ++i) {
+    settings << (i ? "," : "") << factors[i];
+  }
+}
+
+void ModelSnapshot::AddFile(std::ostream &settings, const std::string &filePath)
+{
+  settings << filePath;
+  struct stat info;
+  if (stat(filePath.c_str(), &info) == 0) {
+    settings << ":" << static_cast<UINT64>(info.st_size) << ":" << static_cast<UINT64>(info.st_mtime);
+  }
+}
+
+void ModelSnapshot::AddScoreSettings(std::ostream &settings, const std::vector<float> &weight
+                                     , const LMList &languageModels)
+{
+  const StaticData &staticData = StaticData::Instance();
+  settings << std::setprecision(9) << "weights=";
+  for (size_t i = 0; i < weight.size(); ++i) {
+    settings << weight[i] << " ";
+  }
+  const std::vector<std::string> &weightWP = staticData.GetParam("weight-w");
+  for (size_t i = 0; i < weightWP.size(); ++i) {
+    settings << "w=" << weightWP[i] << " ";
+  }
+  for (LMList::const_iterator iter = languageModels.begin(); iter != languageModels.end(); ++iter) {
+    const LanguageModel &lm = **iter;
+    settings << lm.GetScoreProducerDescription() << "=" << lm.GetWeight() << "," << lm.GetOOVWeight() << " ";
+  }
+  const std::vector<std::string> &lmFiles = staticData.GetParam("lmodel-file");
+  for (size_t i = 0; i < lmFiles.size(); ++i) {
+    // type factor order path
+    const std::vector<std::string> token = Tokenize(lmFiles[i]);
+    settings << "lm=" << lmFiles[i];
+    if (!token.empty()) {
+      settings << ",";
+      AddFile(settings, token.back());
+    }
+    settings << " ";
+  }
+  settings << "oov-feature=" << staticData.GetLMEnableOOVFeature();
+}
+
+bool ModelSnapshot::Commit(SnapshotWriter &writer)
+{
+  if (!writer.Commit())
+    return false;
+  ++m_written;
+  return true;
+}
+
+}
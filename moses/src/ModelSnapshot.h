@@ -0,0 +1,169 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_ModelSnapshot_h
+#define moses_ModelSnapshot_h
+
+#include <fstream>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#include "util/file.hh"
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class AlignmentInfo;
+class Factor;
+class LMList;
+class Phrase;
+class Word;
+
+/** Writes the binary image of a loaded model. The model writes its entries
+ * in its own in-memory order with the functions below. Integers are stored
+ * as variable length bytes and factors by an id local to the image; the
+ * string of a factor follows the first use of its id. The image is written
+ * to a temporary file and only renamed to its final name by Commit().
+ */
+class SnapshotWriter
+{
+public:
+  SnapshotWriter() {}
+  //! removes the temporary file if the image was not committed
+  ~SnapshotWriter();
+
+  bool Create(const std::string &path, const std::string &key);
+  bool Commit();
+
+  void WriteSize(size_t value);
+  void WriteFloat(float value);
+  void WriteString(const StringPiece &value);
+  void WriteFactor(const Factor *factor);
+  void WriteWord(const Word &word);
+  void WritePhrase(const Phrase &phrase);
+  void WriteScores(const std::vector<float> &scores);
+  void WriteAlignment(const AlignmentInfo &alignment);
+
+private:
+  std::string m_path, m_tempPath;
+  std::ofstream m_out;
+  boost::unordered_map<const Factor*, size_t> m_factorIds;
+};
+
+/** Reads the image of a model, memory mapped. The factors of the image are
+ * added to the FactorCollection the first time they are read.
+ */
+class SnapshotReader
+{
+public:
+  SnapshotReader() : m_pos(NULL), m_end(NULL) {}
+
+  //! false if there is no complete image at path written with this key
+  bool Open(const std::string &path, const std::string &key);
+
+  size_t ReadSize();
+  float ReadFloat();
+  StringPiece ReadString();
+  const Factor *ReadFactor();
+  void ReadWord(Word &word);
+  void ReadPhrase(Phrase &phrase);
+  void ReadScores(std::vector<float> &scores);
+  void ReadAlignment(std::set<std::pair<size_t,size_t> > &alignment);
+
+  //! whether all of the image has been read
+  bool AtEnd() const {
+    return m_pos == m_end;
+  }
+
+private:
+  void Read(void *to, size_t size);
+
+  util::scoped_fd m_file;
+  util::scoped_memory m_mem;
+  const char *m_pos, *m_end;
+  std::vector<const Factor*> m_factors;
+};
+
+/** Directory of binary images of text models given with -model-snapshot.
+ * A text model that has an image there, written for the same file and the
+ * same settings (factors, weights, table limit, input filter, ...), is
+ * restored from it instead of being parsed. Otherwise the model is loaded
+ * from its file and its image is written, to be used by the next runs.
+ * The size and modification time of the model file, and of the other files
+ * the model depends on, are part of the settings, so an image is rebuilt
+ * when one of them changes.
+ */
+class ModelSnapshot
+{
+public:
+  explicit ModelSnapshot(const std::string &dir)
+    : m_dir(dir), m_restored(0), m_written(0) {}
+
+  /** open the image of the model of this kind loaded from filePath.
+   * False if there is none for these settings */
+  bool Open(SnapshotReader &reader, const std::string &kind
+            , const std::string &filePath, const std::string &settings);
+
+  //! start writing the image of a model, false if that's not possible
+  bool Create(SnapshotWriter &writer, const std::string &kind
+              , const std::string &filePath, const std::string &settings) const;
+
+  //! finish an image started with Create()
+  bool Commit(SnapshotWriter &writer);
+
+  //! add a list of factors to the settings of an image
+  static void AddFactors(std::ostream &settings, const std::vector<FactorType> &factors);
+
+  //! add a file, with its size and modification time, to the settings of an image
+  static void AddFile(std::ostream &settings, const std::string &filePath);
+
+  /** add the settings that the scores of target phrases, and so their order
+   * in a phrase table, depend on: weights and language models, with their files */
+  static void AddScoreSettings(std::ostream &settings, const std::vector<float> &weight
+                               , const LMList &languageModels);
+
+  const std::string &GetDirectory() const {
+    return m_dir;
+  }
+  //! number of models restored from and written to images
+  size_t GetRestored() const {
+    return m_restored;
+  }
+  size_t GetWritten() const {
+    return m_written;
+  }
+
+private:
+  std::string GetImagePath(const std::string &kind, const std::string &filePath) const;
+  std::string GetKey(const std::string &kind, const std::string &filePath, const std::string &settings) const;
+
+  std::string m_dir;
+  size_t m_restored, m_written;
+};
+
+}
+
+#endif
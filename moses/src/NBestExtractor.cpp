@@ -0,0 +1,143 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+
+#include "util/check.hh"
+
+#include "Hypothesis.h"
+#include "NBestExtractor.h"
+#include "StaticData.h"
+#include "TrellisPath.h"
+
+namespace Moses
+{
+
+NBestExtractor::NBestExtractor(const std::vector<const Hypothesis*> &finalHypos)
+  : m_numExtracted(0)
+{
+  for (size_t i = 0; i < finalHypos.size(); ++i) {
+    AddCandidate(m_root, NULL, finalHypos[i], 0, finalHypos[i]->GetTotalScore(), 0.0f);
+  }
+}
+
+bool NBestExtractor::Next()
+{
+  const Derivation *path = GetDerivation(m_root, m_numExtracted);
+  if (path == NULL)
+    return false;
+  ++m_numExtracted;
+
+  m_edges.clear();
+  for (const Derivation *derivation = path->prev; derivation; derivation = derivation->prev) {
+    m_edges.push_back(derivation->edge);
+  }
+  return true;
+}
+
+Phrase NBestExtractor::GetSurfacePhrase() const
+{
+  const std::vector<FactorType> &outputFactor = StaticData::Instance().GetOutputFactorOrder();
+
+  // the last edge is the initial hypothesis, which has no words
+  size_t size = 0;
+  for (size_t pos = 0; pos + 1 < m_edges.size(); ++pos) {
+    size += m_edges[pos]->GetCurrTargetLength();
+  }
+
+  Phrase ret(size);
+  for (int pos = (int) m_edges.size() - 2; pos >= 0; --pos) {
+    const Phrase &targetPhrase = m_edges[pos]->GetCurrTargetPhrase();
+    for (size_t wordPos = 0; wordPos < targetPhrase.GetSize(); ++wordPos) {
+      Word &newWord = ret.AddWord();
+      for (size_t i = 0 ; i < outputFactor.size() ; i++) {
+        FactorType factorType = outputFactor[i];
+        const Factor *factor = targetPhrase.GetFactor(wordPos, factorType);
+        CHECK(factor);
+        newWord[factorType] = factor;
+      }
+    }
+  }
+  return ret;
+}
+
+TrellisPath *NBestExtractor::CreatePath() const
+{
+  // TrellisPath takes the edges from the start of the sentence
+  std::vector<const Hypothesis*> edges(m_edges.rbegin(), m_edges.rend());
+  return new TrellisPath(edges);
+}
+
+const NBestExtractor::Derivation *NBestExtractor::GetDerivation(const Hypothesis *hypo, size_t k)
+{
+  Node &node = m_nodes[hypo];
+  if (node.best.empty() && node.candidates.empty()) {
+    // first visit: the best way into hypo through each of its arcs
+    AddCandidate(node, hypo, hypo->GetPrevHypo(), 0, 0.0f, 0.0f);
+    const ArcList *arcList = hypo->GetArcList();
+    if (arcList) {
+      for (ArcList::const_iterator iter = arcList->begin(); iter != arcList->end(); ++iter) {
+        const Hypothesis *arc = *iter;
+        AddCandidate(node, arc, arc->GetPrevHypo(), 0, arc->GetTotalScore() - hypo->GetTotalScore(), 0.0f);
+      }
+    }
+  }
+  return GetDerivation(node, k);
+}
+
+const NBestExtractor::Derivation *NBestExtractor::GetDerivation(Node &node, size_t k)
+{
+  while (node.best.size() <= k) {
+    if (node.numExpanded < node.best.size()) {
+      // the next derivation through the same edge uses the next one of its tail
+      const Derivation &last = *node.best[node.numExpanded++];
+      if (last.tail) {
+        const Derivation *next = GetDerivation(last.tail, last.rank + 1);
+        if (next)
+          AddCandidate(node, last.edge, last.tail, last.rank + 1, last.edgeScore, next->score);
+      }
+    }
+    if (node.candidates.empty())
+      return NULL;
+
+    std::pop_heap(node.candidates.begin(), node.candidates.end(), DerivationOrderer());
+    Derivation *derivation = node.candidates.back();
+    node.candidates.pop_back();
+    derivation->prev = derivation->tail ? GetDerivation(derivation->tail, derivation->rank) : NULL;
+    node.best.push_back(derivation);
+  }
+  return node.best[k];
+}
+
+void NBestExtractor::AddCandidate(Node &node, const Hypothesis *edge, const Hypothesis *tail
+                                  , size_t rank, float edgeScore, float tailScore)
+{
+  m_derivations.push_back(Derivation());
+  Derivation &derivation = m_derivations.back();
+  derivation.edge = edge;
+  derivation.tail = tail;
+  derivation.rank = rank;
+  derivation.edgeScore = edgeScore;
+  derivation.score = edgeScore + tailScore;
+  derivation.prev = NULL;
+  node.candidates.push_back(&derivation);
+  std::push_heap(node.candidates.begin(), node.candidates.end(), DerivationOrderer());
+}
+
+}
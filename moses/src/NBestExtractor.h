@@ -0,0 +1,104 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_NBestExtractor_h
+#define moses_NBestExtractor_h
+
+#include <deque>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#include "Phrase.h"
+
+namespace Moses
+{
+
+class Hypothesis;
+class TrellisPath;
+
+/** Enumerates the paths through the search graph of a sentence in order of
+ * score, lazily, as in algorithm 3 of Huang & Chiang, "Better k-best
+ * parsing" (2005).
+ * Each recombined hypothesis keeps the derivations of it found so far, best
+ * first, and a queue of candidates for the next one: one per incoming arc,
+ * each combining the arc with some derivation of the hypothesis it extends.
+ * A derivation points to the derivation it extends, so paths share their
+ * beginnings and none is copied until it is output. Only hypotheses on
+ * extracted paths are ever visited.
+ */
+class NBestExtractor
+{
+public:
+  //! paths ending in one of the hypotheses of the last stack
+  explicit NBestExtractor(const std::vector<const Hypothesis*> &finalHypos);
+
+  //! move to the next best path, false when there is none
+  bool Next();
+
+  //! output factors of the words of the current path
+  Phrase GetSurfacePhrase() const;
+
+  //! a new TrellisPath holding the current path
+  TrellisPath *CreatePath() const;
+
+private:
+  struct Derivation {
+    const Hypothesis *edge; //! last hypothesis or arc of the path, NULL for a complete path
+    const Hypothesis *tail; //! hypothesis the rest of the path ends in, NULL at the start
+    size_t rank; //! of the rest among the derivations of tail
+    float edgeScore; //! score of edge relative to the hypothesis it recombined into
+    float score; //! of the path relative to the best one through the same hypothesis
+    const Derivation *prev; //! the rest of the path, set when this one is extracted
+  };
+
+  struct DerivationOrderer {
+    bool operator()(const Derivation *a, const Derivation *b) const {
+      return a->score < b->score;
+    }
+  };
+
+  //! derivations of a hypothesis, or of all complete paths
+  struct Node {
+    Node() : numExpanded(0) {}
+    std::vector<const Derivation*> best; //! found so far, best first
+    std::vector<Derivation*> candidates; //! heap of candidates for the next one
+    size_t numExpanded; //! derivations in best whose successors are candidates
+  };
+
+  NBestExtractor(const NBestExtractor &); // not implemented
+  NBestExtractor &operator=(const NBestExtractor &); // not implemented
+
+  //! k-th best derivation of a hypothesis, or NULL if it has fewer
+  const Derivation *GetDerivation(const Hypothesis *hypo, size_t k);
+  //! k-th best derivation of node, extracting the ones before it if needed
+  const Derivation *GetDerivation(Node &node, size_t k);
+
+  void AddCandidate(Node &node, const Hypothesis *edge, const Hypothesis *tail
+                    , size_t rank, float edgeScore, float tailScore);
+
+  Node m_root; //! complete paths
+  boost::unordered_map<const Hypothesis*, Node> m_nodes;
+  std::deque<Derivation> m_derivations;
+  size_t m_numExtracted;
+  std::vector<const Hypothesis*> m_edges; //! of the current path, last first
+};
+
+}
+
+#endif
@@ -10,6 +10,10 @@
 #include "InputFileStream.h"
 #include "PhraseDictionaryTreeAdaptor.h"
 #include "Util.h"
+#include "Sentence.h"
+
+#include <set>
+#include <boost/shared_ptr.hpp>
 
 namespace Moses
 {
@@ -33,7 +37,7 @@ class PDTAimp
 protected:
   PDTAimp(PhraseDictionaryTreeAdaptor *p,unsigned nis)
     : m_languageModels(0),m_weightWP(0.0),m_dict(0),
-      m_obj(p),useCache(1),m_numInputScores(nis),totalE(0),distinctE(0) {}
+      m_obj(p),useCache(1),m_numInputScores(nis),m_presorted(false),totalE(0),distinctE(0) {}
 
 public:
   std::vector<float> m_weights;
@@ -51,6 +55,10 @@ public:
 
   std::vector<vTPC> m_rangeCache;
   unsigned m_numInputScores;
+  // table is sorted by our weights, so only the first ttable-limit candidates are read
+  bool m_presorted;
+  // candidates looked up ahead for the current sentence, if any
+  boost::shared_ptr<const PrefetchedCandidates> m_prefetched;
 
   UniqueObjectManager<Phrase> uniqSrcPhr;
 
@@ -107,6 +115,7 @@ public:
     m_cache.clear();
     m_rangeCache.clear();
     uniqSrcPhr.clear();
+    m_prefetched.reset();
   }
 
   TargetPhraseCollection const*
@@ -131,9 +140,15 @@ public:
     }
 
     // get target phrases in string representation
-    std::vector<StringTgtCand> cands;
-    std::vector<std::string> wacands;
-    m_dict->GetTargetCandidates(srcString,cands,wacands);
+    PrefetchedCandidates::Entry lookedUp;
+    PrefetchedCandidates::Entry const* found=m_prefetched ? m_prefetched->Find(srcString) : 0;
+    if(!found) {
+      m_dict->GetTargetCandidates(srcString,lookedUp.cands,lookedUp.wa,
+                                  m_presorted ? m_obj->m_tableLimit : 0);
+      found=&lookedUp;
+    }
+    std::vector<StringTgtCand> const& cands=found->cands;
+    std::vector<std::string> const& wacands=found->wa;
     if(cands.empty()) {
       return 0;
     }
@@ -176,6 +191,45 @@ public:
 
 
 
+  // look up all source phrases of the sentences up to the maximum phrase
+  // length in one sweep over the table
+  PrefetchedCandidates* Prefetch(const std::vector<InputType*>& sources) const {
+    CHECK(m_dict);
+    const size_t maxPhraseLength=StaticData::Instance().GetMaxPhraseLength();
+    PrefetchedCandidates *rv=new PrefetchedCandidates;
+
+    std::set<std::vector<std::string> > phrases;
+    for(size_t i=0; i<sources.size(); ++i) {
+      Sentence const* sentence=dynamic_cast<Sentence const*>(sources[i]);
+      if(!sentence) continue;
+      rv->AddTranslationId(sentence->GetTranslationId());
+      for(size_t start=0; start<sentence->GetSize(); ++start) {
+        std::vector<std::string> phrase;
+        for(size_t end=start; end<sentence->GetSize() && end-start<maxPhraseLength; ++end) {
+          phrase.push_back(std::string());
+          Factors2String(sentence->GetWord(end),phrase.back());
+          phrases.insert(phrase);
+        }
+      }
+    }
+
+    std::vector<std::vector<std::string> > src(phrases.begin(),phrases.end());
+    std::vector<std::vector<StringTgtCand> > cands;
+    std::vector<std::vector<std::string> > wa;
+    m_dict->GetTargetCandidates(src,cands,wa,
+                                m_presorted ? m_obj->m_tableLimit : 0);
+    m_dict->FreeMemory();
+
+    for(size_t i=0; i<src.size(); ++i) {
+      PrefetchedCandidates::Entry& entry=rv->Add(src[i]);
+      entry.cands.swap(cands[i]);
+      entry.wa.swap(wa[i]);
+    }
+    VERBOSE(2,"prefetched " << rv->GetSize() << " source phrases of "
+            << sources.size() << " sentences\n");
+    return rv;
+  }
+
   void Create(const std::vector<FactorType> &input
               , const std::vector<FactorType> &output
               , const std::string &filePath
@@ -212,6 +266,22 @@ public:
       UserMessage::Add(strme.str());
       exit(1);
     }
+
+    // reading the best candidates only is valid if they were sorted with the
+    // translation model weights we decode with. For confusion network and
+    // lattice input, weight starts with the weights of the input scores
+    m_presorted=false;
+    if (m_dict->IsSorted()) {
+      const std::vector<float> &sortWeights=m_dict->GetSortWeights();
+      m_presorted = (sortWeights.size()==weight.size()-m_numInputScores);
+      for(size_t i=0; m_presorted && i<sortWeights.size(); ++i)
+        m_presorted = (fabs(sortWeights[i]-weight[i+m_numInputScores]) < 1e-6);
+      if (m_presorted) {
+        VERBOSE(1,"bin ttable is presorted with the decoding weights\n");
+      } else {
+        TRACE_ERR("WARNING: bin ttable was presorted with different weights, reading all candidates\n");
+      }
+    }
   }
 
   typedef PhraseDictionaryTree::PrefixPtr PPtr;
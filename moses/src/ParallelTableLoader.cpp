@@ -0,0 +1,252 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <map>
+#include <stdexcept>
+
+#include <boost/exception_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "util/tokenize_piece.hh"
+
+#include "ParallelTableLoader.h"
+#include "ThreadPool.h"
+
+namespace Moses
+{
+
+namespace
+{
+// lines per chunk of work, chunks are only cut between source phrases
+const size_t CHUNK_LINES = 10000;
+}
+
+class ParallelTableLoader::LineReader
+{
+public:
+  LineReader() : m_lineNum(0) {}
+  virtual ~LineReader() {}
+
+  //! next line, false at the end of the file
+  virtual bool ReadLine(std::string &line) = 0;
+
+  /** read the next chunk of at least CHUNK_LINES lines, up to the end of a
+   * source phrase. Returns false at the end of the file. */
+  bool ReadChunk(const ParallelTableLoader &loader, std::vector<std::string> &lines, size_t &firstLine) {
+    firstLine = m_lineNum + 1 - (m_nextLine.empty() ? 0 : 1);
+    if (!m_nextLine.empty()) {
+      lines.push_back(std::string());
+      lines.back().swap(m_nextLine);
+    }
+    std::string line;
+    while (ReadLine(line)) {
+      ++m_lineNum;
+      if (lines.size() >= CHUNK_LINES && loader.GetSourceKey(line) != loader.GetSourceKey(lines.back())) {
+        m_nextLine.swap(line);
+        return true;
+      }
+      lines.push_back(line);
+    }
+    return !lines.empty();
+  }
+
+private:
+  size_t m_lineNum;
+  std::string m_nextLine; //! first line of the next chunk
+};
+
+class ParallelTableLoader::FilePieceReader : public ParallelTableLoader::LineReader
+{
+public:
+  FilePieceReader(util::FilePiece &in) : m_in(in) {}
+
+  bool ReadLine(std::string &line) {
+    try {
+      StringPiece piece = m_in.ReadLine();
+      line.assign(piece.data(), piece.size());
+      return true;
+    } catch (const util::EndOfFileException &) {
+      return false;
+    }
+  }
+
+private:
+  util::FilePiece &m_in;
+};
+
+class ParallelTableLoader::StreamReader : public ParallelTableLoader::LineReader
+{
+public:
+  StreamReader(std::istream &in) : m_in(in) {}
+
+  bool ReadLine(std::string &line) {
+    return !getline(m_in, line).fail();
+  }
+
+private:
+  std::istream &m_in;
+};
+
+//! parsed chunks, handed to Merge() in file order
+class ParallelTableLoader::ChunkQueue
+{
+  //! the parsed chunk, or the exception Parse() threw
+  struct Entry {
+    Chunk *chunk;
+    boost::exception_ptr error;
+  };
+
+public:
+  ~ChunkQueue() {
+    // left over if merging stopped on an exception
+    for (std::map<size_t, Entry>::iterator iter = m_chunks.begin(); iter != m_chunks.end(); ++iter)
+      delete iter->second.chunk;
+  }
+
+  void Put(size_t id, Chunk *chunk, const boost::exception_ptr &error) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    Entry &entry = m_chunks[id];
+    entry.chunk = chunk;
+    entry.error = error;
+#ifdef WITH_THREADS
+    m_done.notify_all();
+#endif
+  }
+
+  /** chunk id, or NULL if it is not parsed yet and wait is false. Throws the
+   * exception that parsing the chunk threw */
+  Chunk *Get(size_t id, bool wait) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (wait && m_chunks.find(id) == m_chunks.end())
+      m_done.wait(lock);
+#endif
+    std::map<size_t, Entry>::iterator iter = m_chunks.find(id);
+    if (iter == m_chunks.end())
+      return NULL;
+    Entry entry = iter->second;
+    m_chunks.erase(iter);
+    if (entry.error)
+      boost::rethrow_exception(entry.error);
+    return entry.chunk;
+  }
+
+private:
+  std::map<size_t, Entry> m_chunks;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+#endif
+};
+
+class ParallelTableLoader::ParseTask : public Task
+{
+public:
+  ParseTask(ParallelTableLoader &loader, size_t id, std::vector<std::string> *lines, size_t firstLine, ChunkQueue &queue)
+    : m_loader(loader), m_id(id), m_lines(lines), m_firstLine(firstLine), m_queue(queue) {}
+
+  ~ParseTask() {
+    delete m_lines;
+  }
+
+  //! an exception is handed to the merging thread with the chunk
+  void Run() {
+    Chunk *chunk = NULL;
+    boost::exception_ptr error;
+    try {
+      chunk = m_loader.Parse(*m_lines, m_firstLine);
+    } catch (const std::exception &e) {
+      // without C++11 exception_ptr would only keep the type of e, not its message
+      error = boost::copy_exception(std::runtime_error(e.what()));
+    } catch (...) {
+      error = boost::current_exception();
+    }
+    m_queue.Put(m_id, chunk, error);
+  }
+
+private:
+  ParallelTableLoader &m_loader;
+  size_t m_id;
+  std::vector<std::string> *m_lines;
+  size_t m_firstLine;
+  ChunkQueue &m_queue;
+};
+
+StringPiece ParallelTableLoader::GetSourceKey(const StringPiece &line) const
+{
+  return *util::TokenIter<util::MultiCharacter>(line, util::MultiCharacter("|||"));
+}
+
+void ParallelTableLoader::Load(util::FilePiece &in)
+{
+  FilePieceReader reader(in);
+  Load(reader);
+}
+
+void ParallelTableLoader::Load(std::istream &in)
+{
+  StreamReader reader(in);
+  Load(reader);
+}
+
+void ParallelTableLoader::Load(LineReader &reader)
+{
+  size_t firstLine;
+#ifdef WITH_THREADS
+  if (m_numThreads > 1) {
+    // workers parse the chunks. This thread reads them, and merges the parsed
+    // chunks in order. Chunks parsed or waiting to be merged are bounded, and
+    // so is memory
+    ChunkQueue queue;
+    ThreadPool pool(m_numThreads);
+    const size_t maxPending = 4 * m_numThreads;
+    size_t numRead = 0, numMerged = 0;
+    while (true) {
+      std::vector<std::string> *lines = new std::vector<std::string>;
+      if (!reader.ReadChunk(*this, *lines, firstLine)) {
+        delete lines;
+        break;
+      }
+      pool.Submit(new ParseTask(*this, numRead++, lines, firstLine, queue));
+      while (Chunk *chunk = queue.Get(numMerged, numRead - numMerged >= maxPending)) {
+        Merge(chunk);
+        ++numMerged;
+      }
+    }
+    for (; numMerged < numRead; ++numMerged)
+      Merge(queue.Get(numMerged, true));
+    pool.Stop(true);
+    return;
+  }
+#endif
+
+  std::vector<std::string> lines;
+  while (reader.ReadChunk(*this, lines, firstLine)) {
+    Merge(Parse(lines, firstLine));
+    lines.clear();
+  }
+}
+
+}
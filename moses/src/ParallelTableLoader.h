@@ -0,0 +1,84 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_ParallelTableLoader_h
+#define moses_ParallelTableLoader_h
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "util/file_piece.hh"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+/** Parses a text model file on several threads. The file is cut into chunks
+ * of lines that end where the first field, the source phrase, changes.
+ * Subclasses parse a chunk in Parse(), which runs on a worker thread, and add
+ * the result to the model in Merge(), which runs in the calling thread on one
+ * chunk at a time and in file order, so the model is built as if the file
+ * was read in one pass. With one thread everything runs in the calling thread.
+ * An exception thrown by Parse() on a worker is rethrown by Load() when the
+ * chunk is due to be merged.
+ */
+class ParallelTableLoader
+{
+public:
+  //! result of parsing a chunk
+  class Chunk
+  {
+  public:
+    virtual ~Chunk() {}
+  };
+
+  explicit ParallelTableLoader(size_t numThreads) : m_numThreads(numThreads) {}
+  virtual ~ParallelTableLoader() {}
+
+  void Load(util::FilePiece &in);
+  void Load(std::istream &in);
+
+protected:
+  //! parse lines of the file, the first is line number firstLine, counting from 1
+  virtual Chunk *Parse(const std::vector<std::string> &lines, size_t firstLine) = 0;
+
+  //! add a parsed chunk to the model, and delete it
+  virtual void Merge(Chunk *chunk) = 0;
+
+  //! lines with the same key are kept in one chunk. By default the first field
+  virtual StringPiece GetSourceKey(const StringPiece &line) const;
+
+private:
+  class LineReader;
+  class FilePieceReader;
+  class StreamReader;
+  class ParseTask;
+  class ChunkQueue;
+
+  friend class ParseTask;
+
+  void Load(LineReader &reader);
+
+  size_t m_numThreads;
+};
+
+}
+
+#endif
@@ -76,6 +76,9 @@ Parameter::Parameter()
   AddParam("stack", "s", "maximum stack size for histogram pruning");
   AddParam("stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
   AddParam("threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam("thread-queue-size", "maximum number of input sentences read ahead of the decoding threads (default 10 per thread, 0 = no limit)");
+  AddParam("pin-threads", "bind each decoding thread to its own cpu (Linux only)");
+  AddParam("search-threads", "number of threads expanding the hypotheses of one stack in normal phrase-based search (default 1). Ignored with -v 2 and up, or if a feature is not thread safe");
   AddParam("translation-details", "T", "for each best hypothesis, report translation details to the given file");
   AddParam("ttable-file", "location and properties of the translation tables");
   AddParam("ttable-limit", "ttl", "maximum number of translation table entries per input phrase");
@@ -112,8 +115,15 @@ Parameter::Parameter()
   AddParam("lmbr-map-weight", "weight given to map solution when doing lattice MBR (default 0)");
   AddParam("lattice-hypo-set", "to use lattice as hypo set during lattice MBR");
   AddParam("clean-lm-cache", "clean language model caches after N translations (default N=1)");
+  AddParam("lm-query-cache", "memoize up to N language model evaluations per sentence and search thread (default N=0, off)");
   AddParam("use-persistent-cache", "cache translation options across sentences (default true)");
-  AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases)");
+  AddParam("persistent-cache-size", "maximum number of input phrases in the cache for translation options (default no limit besides persistent-cache-memory)");
+  AddParam("persistent-cache-memory", "maximum memory used by the cache for translation options, in megabytes (default 256)");
+  AddParam("ondisk-mmap", "memory map on-disk rule tables and share them between threads (default false)");
+  AddParam("ondisk-node-cache", "number of on-disk rule table nodes kept in memory across sentences, if not memory mapped (default 10,000)");
+  AddParam("filter-by-input", "skip entries of text phrase and reordering tables whose source phrase is not in this file, which has to be the input to translate (default: input-file)");
+  AddParam("model-snapshot", "directory of binary images of the text models: models are restored from their image if there is one for the same settings, otherwise their image is written after loading them");
+  AddParam("prefetch-batch", "look up the phrases of this many input sentences in binary phrase tables in one sweep before decoding them (default 0 = off)");
   AddParam("recover-input-path", "r", "(conf net/word lattice only) - recover input path corresponding to the best translation");
   AddParam("output-word-graph", "owg", "Output stack info as word graph. Takes filename, 0=only hypos in stack, 1=stack + nbest hypos");
   AddParam("time-out", "seconds after which is interrupted (-1=no time-out, default is -1)");
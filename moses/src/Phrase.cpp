@@ -24,6 +24,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <sstream>
 #include <string>
+#include <cstring>
+#include <boost/functional/hash.hpp>
+#include <boost/static_assert.hpp>
 #include "memory.h"
 #include "FactorCollection.h"
 #include "Phrase.h"
@@ -37,6 +40,9 @@ using namespace std;
 namespace Moses
 {
 
+// Compare() reads words as raw memory
+BOOST_STATIC_ASSERT(sizeof(Word) == (MAX_NUM_FACTORS + 1) * sizeof(UINT32));
+
 Phrase::Phrase(size_t reserveSize)
 {
   m_words.reserve(reserveSize);
@@ -140,6 +146,13 @@ void Phrase::CreateFromString(const std::vector<FactorType> &factorOrder, const
 {
   FactorCollection &factorCollection = FactorCollection::Instance();
 
+  // phrases of loaded tables are kept for good, so allocate exactly
+  size_t numWords = 0;
+  for (util::TokenIter<util::AnyCharacter, true> word_it(phraseString, util::AnyCharacter(" \t")); word_it; ++word_it) {
+    ++numWords;
+  }
+  m_words.reserve(m_words.size() + numWords);
+
   for (util::TokenIter<util::AnyCharacter, true> word_it(phraseString, util::AnyCharacter(" \t")); word_it; ++word_it) {
     Word &word = AddWord();
     size_t index = 0;
@@ -216,6 +229,12 @@ int Phrase::Compare(const Phrase &other) const
     return (thisSize < compareSize) ? -1 : 1;
   }
 
+  // words are plain arrays of factor ids, so identical phrases are found
+  // with one memcmp over the contiguous words
+  if (thisSize == 0 || std::memcmp(&m_words[0], &other.m_words[0], thisSize * sizeof(Word)) == 0) {
+    return 0;
+  }
+
   for (size_t pos = 0 ; pos < thisSize ; pos++) {
     const Word &thisWord	= GetWord(pos)
                             ,&otherWord	= other.GetWord(pos);
@@ -343,6 +362,13 @@ ostream& operator<<(ostream& out, const Phrase& phrase)
   return out;
 }
 
+size_t hash_value(const Phrase &phrase)
+{
+  size_t seed = phrase.GetSize();
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    boost::hash_combine(seed, hash_value(phrase.GetWord(pos)));
+  }
+  return seed;
 }
 
-
+}
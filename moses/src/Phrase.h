@@ -130,6 +130,11 @@ public:
     m_words.clear();
   }
 
+  //! make room for size words, so that adding them allocates no more
+  void Reserve(size_t size) {
+    m_words.reserve(size);
+  }
+
   void RemoveWord(size_t pos) {
     CHECK(pos < m_words.size());
     m_words.erase(m_words.begin() + pos);
@@ -159,6 +164,9 @@ public:
 
 };
 
+//! hash of the words, consistent with Phrase::Compare() under the conditions of hash_value(const Word&)
+size_t hash_value(const Phrase &phrase);
+
 
 }
 #endif
@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "PhraseDictionary.h"
 #include "PhraseDictionaryTreeAdaptor.h"
+#include "PhraseDictionaryTree.h"
+#include "PhraseDictionaryMapped.h"
 #include "RuleTable/PhraseDictionarySCFG.h"
 #include "RuleTable/PhraseDictionaryOnDisk.h"
 #include "RuleTable/PhraseDictionaryALSuffixArray.h"
@@ -68,7 +70,10 @@ PhraseDictionaryFeature::PhraseDictionaryFeature
 {
   const StaticData& staticData = StaticData::Instance();
   const_cast<ScoreIndexManager&>(staticData.GetScoreIndexManager()).AddScoreProducer(this);
-  if (implementation == Memory || implementation == SCFG || implementation == SuffixArray) {
+  if (implementation == Memory || implementation == SCFG || implementation == SuffixArray
+      || implementation == MMap || implementation == Compact
+      || (implementation == OnDisk && staticData.GetOnDiskMMap())) {
+    // a memory mapped on-disk table holds no file position
     m_useThreadSafePhraseDictionary = true;
   } else {
     m_useThreadSafePhraseDictionary = false;
@@ -110,6 +115,38 @@ PhraseDictionary* PhraseDictionaryFeature::LoadPhraseTable(const TranslationSyst
                , system->GetWeightWordPenalty());
     CHECK(ret);
     return pdta;
+  } else if (m_implementation == MMap) {
+    // memory mapped binary phrase table, shared by all threads
+    if (staticData.GetInputType() != SentenceInput) {
+      UserMessage::Add("Memory mapped phrase tables only support sentence input");
+      CHECK(false);
+    }
+    PhraseDictionaryMMap* pdmm = new PhraseDictionaryMMap(m_numScoreComponent, this);
+    bool ret = pdmm->Load(GetInput()
+                          , GetOutput()
+                          , m_filePath
+                          , m_weight
+                          , m_tableLimit
+                          , system->GetLanguageModels()
+                          , system->GetWeightWordPenalty());
+    CHECK(ret);
+    return pdmm;
+  } else if (m_implementation == Compact) {
+    // compact binary phrase table, shared by all threads
+    if (staticData.GetInputType() != SentenceInput) {
+      UserMessage::Add("Compact phrase tables only support sentence input");
+      CHECK(false);
+    }
+    PhraseDictionaryCompact* pdc = new PhraseDictionaryCompact(m_numScoreComponent, this);
+    bool ret = pdc->Load(GetInput()
+                         , GetOutput()
+                         , m_filePath
+                         , m_weight
+                         , m_tableLimit
+                         , system->GetLanguageModels()
+                         , system->GetWeightWordPenalty());
+    CHECK(ret);
+    return pdc;
   } else if (m_implementation == SCFG || m_implementation == Hiero) {
     // memory phrase table
     if (m_implementation == Hiero) {
@@ -237,6 +274,40 @@ const PhraseDictionary* PhraseDictionaryFeature::GetDictionary() const
   return dict;
 }
 
+void PhraseDictionaryFeature::Prefetch(const TranslationSystem* system, const std::vector<InputType*>& sources)
+{
+  if (m_implementation != Binary || sources.empty()) return;
+
+  if (!m_prefetchPhraseDictionary.get()) {
+    m_prefetchPhraseDictionary.reset(LoadPhraseTable(system));
+  }
+  PhraseDictionaryTreeAdaptor *pdta = static_cast<PhraseDictionaryTreeAdaptor*>(m_prefetchPhraseDictionary.get());
+  boost::shared_ptr<const PrefetchedCandidates> batch(pdta->Prefetch(sources));
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_prefetchMutex);
+#endif
+  for (size_t i = 0; i < sources.size(); ++i) {
+    const long translationId = sources[i]->GetTranslationId();
+    if (batch->HasTranslationId(translationId))
+      m_prefetched[translationId] = batch;
+  }
+}
+
+boost::shared_ptr<const PrefetchedCandidates> PhraseDictionaryFeature::TakePrefetched(long translationId) const
+{
+  boost::shared_ptr<const PrefetchedCandidates> ret;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_prefetchMutex);
+#endif
+  std::map<long, boost::shared_ptr<const PrefetchedCandidates> >::iterator iter = m_prefetched.find(translationId);
+  if (iter != m_prefetched.end()) {
+    ret = iter->second;
+    m_prefetched.erase(iter);
+  }
+  return ret;
+}
+
 
 
 PhraseDictionaryFeature::~PhraseDictionaryFeature()
@@ -29,7 +29,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <vector>
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
 #ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/tss.hpp>
 #endif
 
@@ -51,6 +54,7 @@ class TranslationSystem;
 class ChartRuleLookupManager;
 
 class PhraseDictionaryFeature;
+class PrefetchedCandidates;
 
 /**
   * Abstract base class for phrase dictionaries (tables).
@@ -127,6 +131,14 @@ public:
   //Get the dictionary. Be sure to initialise it first.
   const PhraseDictionary* GetDictionary() const;
 
+  //Look up the source phrases of these sentences in one sweep before they are
+  //decoded. Only binary phrase tables support this, for others it does nothing.
+  void Prefetch(const TranslationSystem* system, const std::vector<InputType*>& sources);
+
+  //Hand over the candidates prefetched for the sentence with this id, if any.
+  //A batch is released once all its sentences have taken it.
+  boost::shared_ptr<const PrefetchedCandidates> TakePrefetched(long translationId) const;
+
 private:
   /** Load the appropriate phrase table */
   PhraseDictionary* LoadPhraseTable(const TranslationSystem* system);
@@ -149,6 +161,13 @@ private:
 
   bool m_useThreadSafePhraseDictionary;
   PhraseTableImplementation m_implementation;
+  //Own instance of the table for prefetching, and the batches of the
+  //sentences that have not started yet, by translation id
+  std::auto_ptr<PhraseDictionary> m_prefetchPhraseDictionary;
+  mutable std::map<long, boost::shared_ptr<const PrefetchedCandidates> > m_prefetched;
+#ifdef WITH_THREADS
+  mutable boost::mutex m_prefetchMutex;
+#endif
   std::string m_targetFile;
   std::string m_alignmentsFile;
 
@@ -0,0 +1,160 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cmath>
+#include <sstream>
+
+#include "PhraseDictionaryMapped.h"
+#include "StaticData.h"
+#include "UserMessage.h"
+#include "Util.h"
+
+namespace Moses
+{
+
+template <class Table>
+PhraseDictionaryMapped<Table>::ThreadLocalStorage::~ThreadLocalStorage()
+{
+  for (typename Cache::iterator iter = cache.begin(); iter != cache.end(); ++iter)
+    delete iter->second;
+}
+
+template <class Table>
+bool PhraseDictionaryMapped<Table>::Load(const std::vector<FactorType> &input
+    , const std::vector<FactorType> &output
+    , const std::string &filePath
+    , const std::vector<float> &weight
+    , size_t tableLimit
+    , const LMList &languageModels
+    , float weightWP)
+{
+  m_input = input;
+  m_weight = weight;
+  m_tableLimit = tableLimit;
+  m_languageModels = &languageModels;
+  m_weightWP = weightWP;
+
+  std::string fileName = filePath;
+  if (!FileExists(fileName) && FileExists(fileName + Table::FileSuffix()))
+    fileName += Table::FileSuffix();
+  if (!m_table.Load(fileName))
+    return false;
+
+  const typename Table::Header &header = m_table.GetHeader();
+  if (header.numScores != m_numScoreComponent) {
+    std::stringstream strme;
+    strme << "Phrase table " << fileName << " has " << header.numScores
+          << " scores, but " << m_numScoreComponent << " were specified";
+    UserMessage::Add(strme.str());
+    return false;
+  }
+
+  // the target vocabulary is small, so it is converted to words once
+  const std::string &factorDelimiter = StaticData::Instance().GetFactorDelimiter();
+  m_targetWords.resize(header.targetVocabSize);
+  for (size_t i = 0; i < m_targetWords.size(); ++i) {
+    const StringPiece word = m_table.GetTargetWord(i);
+    const std::vector<std::string> factors = TokenizeMultiCharSeparator(std::string(word.data(), word.size()), factorDelimiter);
+    if (factors.size() != output.size()) {
+      UserMessage::Add("Target word " + std::string(word.data(), word.size()) + " does not have the number of factors specified for the phrase table");
+      return false;
+    }
+    for (size_t f = 0; f < output.size(); ++f)
+      m_targetWords[i][output[f]] = FactorCollection::Instance().AddFactor(Output, output[f], factors[f]);
+  }
+
+  // reading the best targets only is valid if they were sorted with our weights
+  const std::vector<float> sortWeights = m_table.GetSortWeights();
+  m_presorted = !sortWeights.empty() && sortWeights.size() == weight.size();
+  for (size_t i = 0; m_presorted && i < sortWeights.size(); ++i)
+    m_presorted = (fabs(sortWeights[i] - weight[i]) < 1e-6);
+  if (!sortWeights.empty() && !m_presorted) {
+    TRACE_ERR("WARNING: phrase table was presorted with different weights, reading all candidates\n");
+  }
+
+  VERBOSE(1, "Phrase table " << fileName << ": " << header.numSources
+          << " source phrases, " << header.numPairs << " phrase pairs"
+          << (m_presorted ? ", presorted" : "") << std::endl);
+  return true;
+}
+
+template <class Table>
+typename PhraseDictionaryMapped<Table>::ThreadLocalStorage &PhraseDictionaryMapped<Table>::GetLocal() const
+{
+  if (m_local.get() == NULL)
+    m_local.reset(new ThreadLocalStorage);
+  return *m_local;
+}
+
+template <class Table>
+void PhraseDictionaryMapped<Table>::InitializeForInput(InputType const&)
+{
+  // the target phrases of the previous sentence are no longer in use
+  if (m_local.get() != NULL && m_local->cache.size() > MaxCachedSources)
+    m_local.reset(new ThreadLocalStorage);
+}
+
+template <class Table>
+const TargetPhraseCollection *PhraseDictionaryMapped<Table>::GetTargetPhraseCollection(const Phrase &source) const
+{
+  if (source.GetSize() == 0) return NULL;
+
+  Cache &cache = GetLocal().cache;
+  typename Cache::iterator iter = cache.lower_bound(source);
+  if (iter != cache.end() && iter->first == source)
+    return iter->second;
+  iter = cache.insert(iter, std::make_pair(source, static_cast<TargetPhraseCollection*>(NULL)));
+  iter->second = CreateTargetPhraseCollection(iter->first);
+  return iter->second;
+}
+
+template <class Table>
+TargetPhraseCollection *PhraseDictionaryMapped<Table>::CreateTargetPhraseCollection(const Phrase &source) const
+{
+  std::vector<std::string> words(source.GetSize());
+  for (size_t pos = 0; pos < words.size(); ++pos)
+    words[pos] = source.GetWord(pos).GetString(m_input, false);
+
+  std::vector<typename Table::Target> targets;
+  if (!m_table.Find(words, targets, m_presorted ? m_tableLimit : 0))
+    return NULL;
+
+  const size_t numScores = m_numScoreComponent;
+  TargetPhraseCollection *ret = new TargetPhraseCollection;
+  std::vector<float> scores(numScores);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    const typename Table::Target &target = targets[i];
+    TargetPhrase *targetPhrase = new TargetPhrase(Output);
+    for (size_t pos = 0; pos < target.GetSize(); ++pos)
+      targetPhrase->AddWord(m_targetWords[target.GetWord(pos)]);
+    std::copy(target.GetScores(), target.GetScores() + numScores, scores.begin());
+    targetPhrase->SetScore(m_feature, scores, m_weight, m_weightWP, *m_languageModels);
+    targetPhrase->SetSourcePhrase(&source);
+    if (target.GetAlignment().size())
+      targetPhrase->SetAlignmentInfo(target.GetAlignment());
+    ret->Add(targetPhrase);
+  }
+  ret->Sort(true, m_tableLimit);
+  return ret;
+}
+
+template class PhraseDictionaryMapped<PhraseTableMMap>;
+template class PhraseDictionaryMapped<PhraseTableCompact>;
+
+}
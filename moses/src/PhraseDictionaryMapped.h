@@ -0,0 +1,109 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_PhraseDictionaryMapped_h
+#define moses_PhraseDictionaryMapped_h
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+#include "PhraseDictionary.h"
+#include "PhraseTableCompact.h"
+#include "PhraseTableMMap.h"
+
+namespace Moses
+{
+
+/*** Phrase table in one of the memory mapped binary formats, PhraseTableMMap
+ * (processPhraseTable -mmap) or PhraseTableCompact (processPhraseTable
+ * -compact). The mapped file is shared read-only by all threads, so a single
+ * object serves the whole process. Target phrases are built on the first
+ * lookup of a source phrase and kept by the calling thread for later lookups,
+ * up to MaxCachedSources source phrases.
+ */
+template <class Table>
+class PhraseDictionaryMapped : public PhraseDictionary
+{
+  typedef PhraseDictionary MyBase;
+
+  //! target phrases by source phrase, NULL if it is not in the table
+  typedef std::map<Phrase, TargetPhraseCollection*> Cache;
+
+  struct ThreadLocalStorage {
+    ~ThreadLocalStorage();
+    Cache cache; //! keys are the source phrases the target phrases point to
+  };
+
+  //! beyond this, the cache of a thread is emptied before its next sentence
+  static const size_t MaxCachedSources = 10000;
+
+public:
+  PhraseDictionaryMapped(size_t numScoreComponent, PhraseDictionaryFeature* feature)
+    : PhraseDictionary(numScoreComponent,feature), m_weightWP(0), m_languageModels(NULL), m_presorted(false) {}
+
+  bool Load(const std::vector<FactorType> &input
+            , const std::vector<FactorType> &output
+            , const std::string &filePath
+            , const std::vector<float> &weight
+            , size_t tableLimit
+            , const LMList &languageModels
+            , float weightWP);
+
+  const TargetPhraseCollection *GetTargetPhraseCollection(const Phrase &source) const;
+
+  //! empty the cache of this thread if it grew too large
+  virtual void InitializeForInput(InputType const&);
+
+  virtual ChartRuleLookupManager *CreateRuleLookupManager(
+    const InputType &,
+    const ChartCellCollection &) {
+    CHECK(false);
+    return 0;
+  }
+
+private:
+  ThreadLocalStorage &GetLocal() const;
+  TargetPhraseCollection *CreateTargetPhraseCollection(const Phrase &source) const;
+
+  Table m_table;
+  std::vector<FactorType> m_input;
+  std::vector<Word> m_targetWords; //! target vocabulary of the table
+  std::vector<float> m_weight;
+  float m_weightWP;
+  const LMList *m_languageModels;
+  bool m_presorted; //! targets sorted with m_weight, so only the first m_tableLimit are read
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<ThreadLocalStorage> m_local;
+#else
+  mutable std::auto_ptr<ThreadLocalStorage> m_local;
+#endif
+};
+
+typedef PhraseDictionaryMapped<PhraseTableMMap> PhraseDictionaryMMap;
+typedef PhraseDictionaryMapped<PhraseTableCompact> PhraseDictionaryCompact;
+
+}
+
+#endif
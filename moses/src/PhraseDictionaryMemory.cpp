@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <sys/stat.h>
 #include <stdlib.h>
 #include "util/file_piece.hh"
+#include "util/check.hh"
 #include "util/tokenize_piece.hh"
 
 #include "PhraseDictionaryMemory.h"
@@ -38,6 +39,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "WordsRange.h"
 #include "UserMessage.h"
+#include "InputFilter.h"
+#include "ModelSnapshot.h"
+#include "ParallelTableLoader.h"
 
 using namespace std;
 
@@ -57,55 +61,113 @@ template <class It> StringPiece GrabOrDie(It &it, const std::string &file, size_
 }
 } // namespace
 
-bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
-                                  , const std::vector<FactorType> &output
-                                  , const string &filePath
-                                  , const vector<float> &weight
-                                  , size_t tableLimit
-                                  , const LMList &languageModels
-                                  , float weightWP)
+namespace {
+//! target phrases of consecutive lines with the same source phrase
+struct ParsedSource {
+  ParsedSource() : source(0) {}
+  Phrase source;
+  std::vector<TargetPhrase*> targets;
+};
+
+class ParsedChunk : public ParallelTableLoader::Chunk
 {
-  const StaticData &staticData = StaticData::Instance();
-
-  m_tableLimit = tableLimit;
+public:
+  ParsedChunk() : numElement(NOT_FOUND), firstLine(0) {}
+  ~ParsedChunk() {
+    for (size_t i = 0; i < sources.size(); ++i) {
+      RemoveAllInColl(sources[i]->targets);
+      delete sources[i];
+    }
+  }
 
-  util::FilePiece inFile(filePath.c_str(), staticData.GetVerboseLevel() >= 1 ? &std::cerr : NULL);
+  std::vector<ParsedSource*> sources;
+  size_t numElement; //! fields of the lines, NOT_FOUND if there were none
+  size_t firstLine;
+};
+} // namespace
 
-  size_t line_num = 0;
-  size_t numElement = NOT_FOUND; // 3=old format, 5=async format which include word alignment info
+/** Parses chunks of the phrase table on worker threads and adds them to the
+ * trie in file order */
+class PhraseDictionaryMemory::TableLoader : public ParallelTableLoader
+{
+public:
+  TableLoader(PhraseDictionaryMemory &dictionary
+              , const std::vector<FactorType> &input
+              , const std::vector<FactorType> &output
+              , const string &filePath
+              , const vector<float> &weight
+              , const LMList &languageModels
+              , float weightWP)
+    : ParallelTableLoader(StaticData::Instance().ThreadCount())
+    , m_dictionary(dictionary), m_input(input), m_output(output), m_filePath(filePath)
+    , m_weight(weight), m_languageModels(languageModels), m_weightWP(weightWP)
+    , m_numElement(NOT_FOUND) {}
+
+protected:
+  Chunk *Parse(const std::vector<std::string> &lines, size_t firstLine);
+  void Merge(Chunk *chunk);
+
+private:
+  PhraseDictionaryMemory &m_dictionary;
+  const std::vector<FactorType> &m_input, &m_output;
+  const string &m_filePath;
+  const vector<float> &m_weight;
+  const LMList &m_languageModels;
+  float m_weightWP;
+  size_t m_numElement; // 3=old format, 4=async format which include word alignment info
+};
+
+ParallelTableLoader::Chunk *PhraseDictionaryMemory::TableLoader::Parse(const std::vector<std::string> &lines, size_t firstLine)
+{
+  const StaticData &staticData = StaticData::Instance();
   const std::string& factorDelimiter = staticData.GetFactorDelimiter();
+  const size_t numScoreComponent = m_dictionary.m_numScoreComponent;
 
-  Phrase sourcePhrase(0);
+  std::auto_ptr<ParsedChunk> chunk(new ParsedChunk);
+  chunk->firstLine = firstLine;
+  ParsedSource *preSource = NULL;
+  std::string preSourceString;
   std::vector<float> scv;
-  scv.reserve(m_numScoreComponent);
+  scv.reserve(numScoreComponent);
 
-  TargetPhraseCollection *preSourceNode = NULL;
-  std::string preSourceString;
+  // entries whose source phrase is not in the input are skipped
+  const InputFilter *filter = staticData.GetInputFilter();
+  std::string preFilterString;
+  bool preFilterKeep = true;
 
-  while(true) {
-    ++line_num;
-    StringPiece line;
-    try {
-      line = inFile.ReadLine();
-    } catch (util::EndOfFileException &e) {
-      break;
-    }
+  for (size_t ind = 0; ind < lines.size(); ++ind) {
+    const size_t line_num = firstLine + ind;
+    StringPiece line(lines[ind]);
 
     util::TokenIter<util::MultiCharacter> pipes(line, util::MultiCharacter("|||"));
-    StringPiece sourcePhraseString(GrabOrDie(pipes, filePath, line_num));
-    StringPiece targetPhraseString(GrabOrDie(pipes, filePath, line_num));
-    StringPiece scoreString(GrabOrDie(pipes, filePath, line_num));
+    StringPiece sourcePhraseString(GrabOrDie(pipes, m_filePath, line_num));
+    StringPiece targetPhraseString(GrabOrDie(pipes, m_filePath, line_num));
+    StringPiece scoreString(GrabOrDie(pipes, m_filePath, line_num));
 
     bool isLHSEmpty = !util::TokenIter<util::AnyCharacter, true>(sourcePhraseString, util::AnyCharacter(" \t"));
     if (isLHSEmpty && !staticData.IsWordDeletionEnabled()) {
-      TRACE_ERR( filePath << ":" << line_num << ": pt entry contains empty source, skipping\n");
+      TRACE_ERR( m_filePath << ":" << line_num << ": pt entry contains empty source, skipping\n");
       continue;
     }
- 
+    if (filter) {
+      if (preFilterString != sourcePhraseString) {
+        preFilterString.assign(sourcePhraseString.data(), sourcePhraseString.size());
+        preFilterKeep = filter->IsInInput(sourcePhraseString, m_input);
+      }
+      if (!preFilterKeep) continue;
+    }
+
+    // Reuse source if possible.  Otherwise, create it.
+    if (!preSource || preSourceString != sourcePhraseString) {
+      preSource = new ParsedSource;
+      chunk->sources.push_back(preSource);
+      preSource->source.CreateFromString(m_input, sourcePhraseString, factorDelimiter);
+      preSourceString.assign(sourcePhraseString.data(), sourcePhraseString.size());
+    }
+
     //target
     std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(Output));
-    targetPhrase->SetSourcePhrase(&sourcePhrase); // TODO(bhaddow): This is a dangling pointer
-    targetPhrase->CreateFromString(output, targetPhraseString, factorDelimiter);
+    targetPhrase->CreateFromString(m_output, targetPhraseString, factorDelimiter);
 
     scv.clear();
     for (util::TokenIter<util::AnyCharacter, true> token(scoreString, util::AnyCharacter(" \t")); token; ++token) {
@@ -119,14 +181,14 @@ bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
         abort();
       }
     }
-    if (scv.size() != m_numScoreComponent) {
+    if (scv.size() != numScoreComponent) {
       stringstream strme;
-      strme << "Size of scoreVector != number (" <<scv.size() << "!=" <<m_numScoreComponent<<") of score components on line " << line_num;
+      strme << "Size of scoreVector != number (" <<scv.size() << "!=" <<numScoreComponent<<") of score components on line " << line_num;
       UserMessage::Add(strme.str());
       abort();
     }
     // scv good to go sir!
-    targetPhrase->SetScore(m_feature, scv, weight, weightWP, languageModels);
+    targetPhrase->SetScore(m_dictionary.m_feature, scv, m_weight, m_weightWP, m_languageModels);
 
     size_t consumed = 3;
     if (pipes) {
@@ -135,35 +197,174 @@ bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
     }
     // Check number of entries delimited by ||| agrees across all lines.  
     for (; pipes; ++pipes, ++consumed) {}
-    if (numElement != consumed) {
-      if (numElement == NOT_FOUND) {
-        numElement = consumed;
+    if (chunk->numElement != consumed) {
+      if (chunk->numElement == NOT_FOUND) {
+        chunk->numElement = consumed;
       } else {
-        stringstream strme;
-        strme << "Syntax error at " << filePath << ":" << line_num;
-        UserMessage::Add(strme.str());
-        abort();
+        ParserDeath(m_filePath, line_num);
       }
     }
 
-    // Reuse source if possible.  Otherwise, create node for it.  
-    if (preSourceString == sourcePhraseString && preSourceNode) {
-      preSourceNode->Add(targetPhrase.release());
-    } else {
-      sourcePhrase.Clear();
-      sourcePhrase.CreateFromString(input, sourcePhraseString, factorDelimiter);
-      preSourceNode = CreateTargetPhraseCollection(sourcePhrase);
-      preSourceNode->Add(targetPhrase.release());
-      preSourceString.assign(sourcePhraseString.data(), sourcePhraseString.size());
+    preSource->targets.push_back(targetPhrase.release());
+  }
+  return chunk.release();
+}
+
+void PhraseDictionaryMemory::TableLoader::Merge(Chunk *parsed)
+{
+  std::auto_ptr<ParsedChunk> chunk(static_cast<ParsedChunk*>(parsed));
+  if (chunk->numElement != NOT_FOUND) {
+    if (m_numElement == NOT_FOUND) {
+      m_numElement = chunk->numElement;
+    } else if (m_numElement != chunk->numElement) {
+      ParserDeath(m_filePath, chunk->firstLine);
+    }
+  }
+
+  for (size_t i = 0; i < chunk->sources.size(); ++i) {
+    ParsedSource &parsedSource = *chunk->sources[i];
+    TargetPhraseCollection *sourceNode = m_dictionary.CreateTargetPhraseCollection(parsedSource.source);
+    for (size_t j = 0; j < parsedSource.targets.size(); ++j) {
+      // TODO(bhaddow): This is a dangling pointer
+      parsedSource.targets[j]->SetSourcePhrase(&parsedSource.source);
+      sourceNode->Add(parsedSource.targets[j]);
+    }
+    parsedSource.targets.clear();
+  }
+}
+
+bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
+                                  , const std::vector<FactorType> &output
+                                  , const string &filePath
+                                  , const vector<float> &weight
+                                  , size_t tableLimit
+                                  , const LMList &languageModels
+                                  , float weightWP)
+{
+  const StaticData &staticData = StaticData::Instance();
+
+  m_tableLimit = tableLimit;
+
+  // restore the trie from its image if there is one for these settings
+  ModelSnapshot *snapshot = staticData.GetModelSnapshot();
+  std::ostringstream settings;
+  if (snapshot) {
+    const InputFilter *filter = staticData.GetInputFilter();
+    settings << "factors=";
+    ModelSnapshot::AddFactors(settings, input);
+    settings << "/";
+    ModelSnapshot::AddFactors(settings, output);
+    settings << " scores=" << m_numScoreComponent << " table-limit=" << m_tableLimit
+             << " word-deletion=" << staticData.IsWordDeletionEnabled()
+             << " filter=";
+    if (filter)
+      ModelSnapshot::AddFile(settings, filter->GetFilePath());
+    settings << " ";
+    ModelSnapshot::AddScoreSettings(settings, weight, languageModels);
+
+    SnapshotReader reader;
+    if (snapshot->Open(reader, "phrase-table", filePath, settings.str())) {
+      Restore(reader, m_collection, weight, languageModels, weightWP);
+      CHECK(reader.AtEnd());
+      ReportMemoryUsage(filePath);
+      return true;
     }
   }
 
+  util::FilePiece inFile(filePath.c_str(), staticData.GetVerboseLevel() >= 1 ? &std::cerr : NULL);
+
+  const InputFilter *filter = staticData.GetInputFilter();
+  if (filter)
+    filter->Index(input);
+
+  // the table is parsed on -threads threads
+  TableLoader loader(*this, input, output, filePath, weight, languageModels, weightWP);
+  loader.Load(inFile);
+
   // sort each target phrase collection
   m_collection.Sort(m_tableLimit);
 
+  if (snapshot) {
+    SnapshotWriter writer;
+    if (snapshot->Create(writer, "phrase-table", filePath, settings.str())) {
+      Snapshot(writer, m_collection);
+      snapshot->Commit(writer);
+    }
+  }
+
+  ReportMemoryUsage(filePath);
   return true;
 }
 
+void PhraseDictionaryMemory::ReportMemoryUsage(const std::string &filePath) const
+{
+  if (StaticData::Instance().GetVerboseLevel() < 1) return;
+  TableMemoryUsage usage;
+  usage.AddNode(sizeof(PhraseDictionaryNode));
+  AddMemoryUsage(usage, m_collection);
+  usage.Report(filePath);
+}
+
+void PhraseDictionaryMemory::AddMemoryUsage(TableMemoryUsage &usage, const PhraseDictionaryNode &node) const
+{
+  if (node.GetTargetPhraseCollection())
+    usage.AddCollection(*node.GetTargetPhraseCollection());
+  for (PhraseDictionaryNode::const_iterator iter = node.begin(); iter != node.end(); ++iter) {
+    // a map entry is the word, the node and the links of the tree
+    usage.AddNode(sizeof(*iter) + 4 * sizeof(void*));
+    AddMemoryUsage(usage, iter->second);
+  }
+}
+
+void PhraseDictionaryMemory::Snapshot(SnapshotWriter &writer, const PhraseDictionaryNode &node) const
+{
+  // target phrases in their sorted order, 0 if the node has no collection
+  const TargetPhraseCollection *coll = node.GetTargetPhraseCollection();
+  writer.WriteSize(coll ? coll->GetSize() + 1 : 0);
+  if (coll) {
+    for (TargetPhraseCollection::const_iterator iter = coll->begin(); iter != coll->end(); ++iter) {
+      const TargetPhrase &targetPhrase = **iter;
+      writer.WritePhrase(targetPhrase);
+      writer.WriteScores(targetPhrase.GetScoreBreakdown().GetScoresForProducer(m_feature));
+      writer.WriteAlignment(targetPhrase.GetAlignmentInfo());
+    }
+  }
+
+  writer.WriteSize(node.m_map.size());
+  for (PhraseDictionaryNode::const_iterator iter = node.begin(); iter != node.end(); ++iter) {
+    writer.WriteWord(iter->first);
+    Snapshot(writer, iter->second);
+  }
+}
+
+void PhraseDictionaryMemory::Restore(SnapshotReader &reader, PhraseDictionaryNode &node
+                                     , const std::vector<float> &weight, const LMList &languageModels, float weightWP)
+{
+  const size_t collSize = reader.ReadSize();
+  if (collSize > 0) {
+    TargetPhraseCollection *coll = node.CreateTargetPhraseCollection();
+    std::vector<float> scv;
+    std::set<std::pair<size_t,size_t> > alignmentInfo;
+    for (size_t i = 0; i < collSize - 1; ++i) {
+      TargetPhrase *targetPhrase = new TargetPhrase(Output);
+      reader.ReadPhrase(*targetPhrase);
+      reader.ReadScores(scv);
+      targetPhrase->SetScore(m_feature, scv, weight, weightWP, languageModels);
+      alignmentInfo.clear();
+      reader.ReadAlignment(alignmentInfo);
+      targetPhrase->SetAlignmentInfo(alignmentInfo);
+      coll->Add(targetPhrase);
+    }
+  }
+
+  const size_t numChildren = reader.ReadSize();
+  for (size_t i = 0; i < numChildren; ++i) {
+    Word word;
+    reader.ReadWord(word);
+    Restore(reader, *node.GetOrCreateChild(word), weight, languageModels, weightWP);
+  }
+}
+
 TargetPhraseCollection *PhraseDictionaryMemory::CreateTargetPhraseCollection(const Phrase &source)
 {
   const size_t size = source.GetSize();
@@ -25,10 +25,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "PhraseDictionary.h"
 #include "PhraseDictionaryNode.h"
+#include "TargetPhraseCollection.h"
 
 namespace Moses
 {
 
+class SnapshotReader;
+class SnapshotWriter;
+
 /*** Implementation of a phrase table in a trie.  Looking up a phrase of
  * length n words requires n look-ups to find the TargetPhraseCollection.
  */
@@ -37,11 +41,25 @@ class PhraseDictionaryMemory : public PhraseDictionary
   typedef PhraseDictionary MyBase;
   friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryMemory&);
 
+  class TableLoader;
+  friend class TableLoader;
+
 protected:
   PhraseDictionaryNode m_collection;
 
   TargetPhraseCollection *CreateTargetPhraseCollection(const Phrase &source);
 
+  //! write the trie below node, and its target phrases, to a model image
+  void Snapshot(SnapshotWriter &writer, const PhraseDictionaryNode &node) const;
+  //! read a trie written by Snapshot() into node
+  void Restore(SnapshotReader &reader, PhraseDictionaryNode &node
+               , const std::vector<float> &weight, const LMList &languageModels, float weightWP);
+
+  //! the nodes and target phrases of the table, at verbosity 1
+  void ReportMemoryUsage(const std::string &filePath) const;
+  //! add up the memory taken by the trie below node
+  void AddMemoryUsage(TableMemoryUsage &usage, const PhraseDictionaryNode &node) const;
+
 public:
   PhraseDictionaryMemory(size_t numScoreComponent, PhraseDictionaryFeature* feature)
     : PhraseDictionary(numScoreComponent,feature) {}
@@ -1,6 +1,7 @@
 // $Id$
 // vim:tabstop=2
 #include "PhraseDictionaryTree.h"
+#include <algorithm>
 #include <map>
 #include "util/check.hh"
 #include <sstream>
@@ -8,6 +9,9 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#ifndef WIN32
+#include <fcntl.h>
+#endif
 
 namespace Moses
 {
@@ -28,18 +32,20 @@ class TgtCand
   IPhrase e;
   Scores sc;
   std::string m_alignment;
+  float m_weightedScore;
 public:
-  TgtCand() {}
+  TgtCand() : m_weightedScore(0.0) {}
 
   TgtCand(const IPhrase& a, const Scores& b , const std::string& alignment)
     : e(a)
     , sc(b)
     , m_alignment(alignment)
+    , m_weightedScore(0.0)
   {}
 
-  TgtCand(const IPhrase& a,const Scores& b) : e(a),sc(b) {}
+  TgtCand(const IPhrase& a,const Scores& b) : e(a),sc(b),m_weightedScore(0.0) {}
 
-  TgtCand(FILE* f) {
+  TgtCand(FILE* f) : m_weightedScore(0.0) {
     readBin(f);
   }
 
@@ -75,39 +81,86 @@ public:
   const std::string& GetAlignment() const {
     return m_alignment;
   }
+
+  // weighted sum of the log scores, only set in presorted tables
+  float GetWeightedScore() const {
+    return m_weightedScore;
+  }
+  void SetWeightedScore(const std::vector<float>& weights) {
+    CHECK(weights.size()==sc.size());
+    m_weightedScore=0.0;
+    for(size_t i=0; i<sc.size(); ++i)
+      m_weightedScore+=weights[i]*FloorScore(TransformScore(sc[i]));
+  }
+  void writeWeightedScore(FILE* f) const {
+    fWrite(f,m_weightedScore);
+  }
+  void readWeightedScore(FILE* f) {
+    fRead(f,m_weightedScore);
+  }
+};
+
+// best weighted score first
+struct TgtCandWeightedScoreOrder {
+  bool operator()(const TgtCand& a,const TgtCand& b) const {
+    return a.GetWeightedScore()>b.GetWeightedScore();
+  }
 };
 
 
+// In presorted tables each candidate is preceded by its weighted score and
+// the candidates of a source phrase are stored best first, so reading can
+// stop after the first maxCands of them (0 reads all).
 class TgtCands : public std::vector<TgtCand>
 {
   typedef std::vector<TgtCand> MyBase;
 public:
   TgtCands() : MyBase() {}
 
-  void writeBin(FILE* f) const {
+  void writeBin(FILE* f,bool scored=false) const {
     unsigned s=size();
     fWrite(f,s);
-    for(size_t i=0; i<s; ++i) MyBase::operator[](i).writeBin(f);
+    for(size_t i=0; i<s; ++i) {
+      if(scored) MyBase::operator[](i).writeWeightedScore(f);
+      MyBase::operator[](i).writeBin(f);
+    }
   }
 
-  void writeBinWithAlignment(FILE* f) const {
+  void writeBinWithAlignment(FILE* f,bool scored=false) const {
     unsigned s=size();
     fWrite(f,s);
-    for(size_t i=0; i<s; ++i) MyBase::operator[](i).writeBinWithAlignment(f);
+    for(size_t i=0; i<s; ++i) {
+      if(scored) MyBase::operator[](i).writeWeightedScore(f);
+      MyBase::operator[](i).writeBinWithAlignment(f);
+    }
   }
 
-  void readBin(FILE* f) {
+  void readBin(FILE* f,bool scored=false,size_t maxCands=0) {
     unsigned s;
     fRead(f,s);
+    if(scored && maxCands && maxCands<s) s=maxCands;
     resize(s);
-    for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBin(f);
+    for(size_t i=0; i<s; ++i) {
+      if(scored) MyBase::operator[](i).readWeightedScore(f);
+      MyBase::operator[](i).readBin(f);
+    }
   }
 
-  void readBinWithAlignment(FILE* f) {
+  void readBinWithAlignment(FILE* f,bool scored=false,size_t maxCands=0) {
     unsigned s;
     fRead(f,s);
+    if(scored && maxCands && maxCands<s) s=maxCands;
     resize(s);
-    for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBinWithAlignment(f);
+    for(size_t i=0; i<s; ++i) {
+      if(scored) MyBase::operator[](i).readWeightedScore(f);
+      MyBase::operator[](i).readBinWithAlignment(f);
+    }
+  }
+
+  // score with the given weights and order best first
+  void SortByWeightedScore(const std::vector<float>& weights) {
+    for(iterator i=begin(); i!=end(); ++i) i->SetWeightedScore(weights);
+    std::stable_sort(begin(),end(),TgtCandWeightedScoreOrder());
   }
 };
 
@@ -156,6 +209,9 @@ public:
   bool usewordalign;
   bool printwordalign;
 
+  // weights the candidates were sorted with, empty if the table is not presorted
+  std::vector<float> sortWeights;
+
   PDTimp() : os(0),ot(0), usewordalign(false), printwordalign(false) {
     PTF::setDefault(InvalidOffT);
   }
@@ -186,19 +242,38 @@ public:
 
   int Read(const std::string& fn);
 
-  void GetTargetCandidates(const IPhrase& f,TgtCands& tgtCands) {
-    if(f.empty()) return;
-    if(f[0]>=data.size()) return;
-    if(!data[f[0]]) return;
+  bool IsSorted() const {
+    return !sortWeights.empty();
+  }
+
+  void ReadTgtCands(TgtCands& tgtCands,size_t maxCands) {
+    if (UseWordAlignment()) tgtCands.readBinWithAlignment(ot,IsSorted(),maxCands);
+    else tgtCands.readBin(ot,IsSorted(),maxCands);
+  }
+
+  void WriteTgtCands(const TgtCands& tgtCands,FILE* f) {
+    if (PrintWordAlignment()) tgtCands.writeBinWithAlignment(f,IsSorted());
+    else tgtCands.writeBin(f,IsSorted());
+  }
+
+  // offset of the target candidates of f in the tgtdata file
+  OFF_T FindTgtCands(const IPhrase& f) {
+    if(f.empty()) return InvalidOffT;
+    if(f[0]>=data.size()) return InvalidOffT;
+    if(!data[f[0]]) return InvalidOffT;
     CHECK(data[f[0]]->findKey(f[0])<data[f[0]]->size());
-    OFF_T tCandOffset=data[f[0]]->find(f);
+    return data[f[0]]->find(f);
+  }
+
+  void GetTargetCandidates(const IPhrase& f,TgtCands& tgtCands,size_t maxCands=0) {
+    OFF_T tCandOffset=FindTgtCands(f);
     if(tCandOffset==InvalidOffT) return;
     fSeek(ot,tCandOffset);
-
-    if (UseWordAlignment())    	tgtCands.readBinWithAlignment(ot);
-    else tgtCands.readBin(ot);
+    ReadTgtCands(tgtCands,maxCands);
   }
 
+  void GetTargetCandidates(const std::vector<IPhrase>& fs,std::vector<TgtCands>& tgtCands,size_t maxCands=0);
+
   typedef PhraseDictionaryTree::PrefixPtr PPtr;
 
   void GetTargetCandidates(PPtr p,TgtCands& tgtCands) {
@@ -207,8 +282,7 @@ public:
     OFF_T tCandOffset=p.imp->ptr()->getData(p.imp->idx);
     if(tCandOffset==InvalidOffT) return;
     fSeek(ot,tCandOffset);
-    if (UseWordAlignment())    	tgtCands.readBinWithAlignment(ot);
-    else tgtCands.readBin(ot);
+    ReadTgtCands(tgtCands,0);
   }
 
   void PrintTgtCand(const TgtCands& tcands,std::ostream& out) const;
@@ -309,6 +383,16 @@ int PDTimp::Read(const std::string& fn)
   fReadVector(ii,srcOffsets);
   fClose(ii);
 
+  // presorted tables come with the weights they were sorted with
+  sortWeights.clear();
+  std::string ifw=fn+".binphr.sorted";
+  if (UseWordAlignment()) ifw+=".wa";
+  if (FileExists(ifw)) {
+    FILE *iw=fOpen(ifw.c_str(),"rb");
+    fReadVector(iw,sortWeights);
+    fClose(iw);
+  }
+
   os=fOpen(ifs.c_str(),"rb");
   ot=fOpen(ift.c_str(),"rb");
 
@@ -326,6 +410,77 @@ int PDTimp::Read(const std::string& fn)
   return 1;
 }
 
+namespace
+{
+typedef std::pair<OFF_T,OFF_T> FileRange;
+
+// gaps up to this size between ranges are read rather than seeked over
+const OFF_T ReadAheadGap=1<<20;
+// how much is read ahead from the start of a record of unknown length
+const OFF_T ReadAheadRecord=1<<16;
+
+// tell the kernel which parts of the file are read next, so that a cold file
+// is streamed in large sequential reads. The ranges have to be sorted.
+void AdviseReads(FILE* f,const std::vector<FileRange>& ranges)
+{
+#if !defined(WIN32) && defined(POSIX_FADV_WILLNEED)
+  int fd=fileno(f);
+  posix_fadvise(fd,0,0,POSIX_FADV_SEQUENTIAL);
+  for(size_t i=0; i<ranges.size();) {
+    OFF_T begin=ranges[i].first, end=ranges[i].second;
+    for(++i; i<ranges.size() && ranges[i].first<end+ReadAheadGap; ++i)
+      end=std::max(end,ranges[i].second);
+    posix_fadvise(fd,begin,end-begin,POSIX_FADV_WILLNEED);
+  }
+#endif
+}
+}
+
+void PDTimp::GetTargetCandidates(const std::vector<IPhrase>& fs,std::vector<TgtCands>& tgtCands,size_t maxCands)
+{
+  tgtCands.resize(fs.size());
+
+  // walk the source tree in phrase order, so that the subtree of each first
+  // word is loaded once and the subtrees in the order they are stored
+  std::vector<std::pair<IPhrase,size_t> > sorted;
+  sorted.reserve(fs.size());
+  for(size_t i=0; i<fs.size(); ++i)
+    if(!fs[i].empty() && fs[i][0]<data.size() && data[fs[i][0]])
+      sorted.push_back(std::make_pair(fs[i],i));
+  std::sort(sorted.begin(),sorted.end());
+
+  // a subtree ends where the next one in the file starts
+  std::vector<OFF_T> starts(srcOffsets);
+  std::sort(starts.begin(),starts.end());
+  std::vector<FileRange> srcRanges;
+  for(size_t i=0; i<sorted.size(); ++i) {
+    if(i && sorted[i].first[0]==sorted[i-1].first[0]) continue;
+    OFF_T begin=srcOffsets[sorted[i].first[0]];
+    std::vector<OFF_T>::const_iterator next=std::upper_bound(starts.begin(),starts.end(),begin);
+    srcRanges.push_back(FileRange(begin,next!=starts.end() ? *next : begin+ReadAheadRecord));
+  }
+  std::sort(srcRanges.begin(),srcRanges.end());
+  AdviseReads(os,srcRanges);
+
+  std::vector<std::pair<OFF_T,size_t> > offsets;
+  offsets.reserve(sorted.size());
+  for(size_t i=0; i<sorted.size(); ++i) {
+    OFF_T tCandOffset=FindTgtCands(sorted[i].first);
+    if(tCandOffset!=InvalidOffT) offsets.push_back(std::make_pair(tCandOffset,sorted[i].second));
+  }
+
+  // read the candidates in file order
+  std::sort(offsets.begin(),offsets.end());
+  std::vector<FileRange> tgtRanges(offsets.size());
+  for(size_t i=0; i<offsets.size(); ++i)
+    tgtRanges[i]=FileRange(offsets[i].first,offsets[i].first+ReadAheadRecord);
+  AdviseReads(ot,tgtRanges);
+  for(size_t i=0; i<offsets.size(); ++i) {
+    fSeek(ot,offsets[i].first);
+    ReadTgtCands(tgtCands[offsets[i].second],maxCands);
+  }
+}
+
 void PDTimp::PrintTgtCand(const TgtCands& tcand,std::ostream& out) const
 {
   for(size_t i=0; i<tcand.size(); ++i) {
@@ -336,6 +491,7 @@ void PDTimp::PrintTgtCand(const TgtCands& tcand,std::ostream& out) const
     const IPhrase& iphr=tcand[i].GetPhrase();
 
     out << i << " -- " << sc << " -- ";
+    if(IsSorted()) out << tcand[i].GetWeightedScore() << " -- ";
     for(size_t j=0; j<iphr.size(); ++j)			out << tv->symbol(iphr[j])<<" ";
     out<< " -- " << trgAlign;
     out << std::endl;
@@ -382,6 +538,21 @@ bool PhraseDictionaryTree::PrintWordAlignment()
   return imp->PrintWordAlignment();
 };
 
+void PhraseDictionaryTree::SetSortWeights(const std::vector<float>& weights)
+{
+  imp->sortWeights=weights;
+}
+
+bool PhraseDictionaryTree::IsSorted() const
+{
+  return imp->IsSorted();
+}
+
+const std::vector<float>& PhraseDictionaryTree::GetSortWeights() const
+{
+  return imp->sortWeights;
+}
+
 void PhraseDictionaryTree::FreeMemory() const
 {
   imp->FreeMemory();
@@ -389,7 +560,8 @@ void PhraseDictionaryTree::FreeMemory() const
 
 void PhraseDictionaryTree::
 GetTargetCandidates(const std::vector<std::string>& src,
-                    std::vector<StringTgtCand>& rv) const
+                    std::vector<StringTgtCand>& rv,
+                    size_t maxCands) const
 {
   IPhrase f(src.size());
   for(size_t i=0; i<src.size(); ++i) {
@@ -398,14 +570,15 @@ GetTargetCandidates(const std::vector<std::string>& src,
   }
 
   TgtCands tgtCands;
-  imp->GetTargetCandidates(f,tgtCands);
+  imp->GetTargetCandidates(f,tgtCands,maxCands);
   imp->ConvertTgtCand(tgtCands,rv);
 }
 
 void PhraseDictionaryTree::
 GetTargetCandidates(const std::vector<std::string>& src,
                     std::vector<StringTgtCand>& rv,
-                    std::vector<std::string>& wa) const
+                    std::vector<std::string>& wa,
+                    size_t maxCands) const
 {
   IPhrase f(src.size());
   for(size_t i=0; i<src.size(); ++i) {
@@ -414,10 +587,37 @@ GetTargetCandidates(const std::vector<std::string>& src,
   }
 
   TgtCands tgtCands;
-  imp->GetTargetCandidates(f,tgtCands);
+  imp->GetTargetCandidates(f,tgtCands,maxCands);
   imp->ConvertTgtCand(tgtCands,rv,wa);
 }
 
+void PhraseDictionaryTree::
+GetTargetCandidates(const std::vector<std::vector<std::string> >& src,
+                    std::vector<std::vector<StringTgtCand> >& rv,
+                    std::vector<std::vector<std::string> >& wa,
+                    size_t maxCands) const
+{
+  std::vector<IPhrase> fs(src.size());
+  for(size_t i=0; i<src.size(); ++i) {
+    fs[i].resize(src[i].size());
+    for(size_t j=0; j<src[i].size(); ++j) {
+      fs[i][j]=imp->sv->index(src[i][j]);
+      if(fs[i][j]==InvalidLabelId) {
+        fs[i].clear();
+        break;
+      }
+    }
+  }
+
+  std::vector<TgtCands> tgtCands;
+  imp->GetTargetCandidates(fs,tgtCands,maxCands);
+  rv.clear();
+  rv.resize(src.size());
+  wa.clear();
+  wa.resize(src.size());
+  for(size_t i=0; i<tgtCands.size(); ++i)
+    imp->ConvertTgtCand(tgtCands[i],rv[i],wa[i]);
+}
 
 void PhraseDictionaryTree::
 PrintTargetCandidates(const std::vector<std::string>& src,
@@ -447,11 +647,13 @@ int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out)
       oft(out+".binphr.tgtdata"),
       ofi(out+".binphr.idx"),
       ofsv(out+".binphr.srcvoc"),
-      oftv(out+".binphr.tgtvoc");
+      oftv(out+".binphr.tgtvoc"),
+      ofw(out+".binphr.sorted");
 
   if (PrintWordAlignment()) {
     ofn+=".wa";
     oft+=".wa";
+    ofw+=".wa";
   }
 
   FILE *os=fOpen(ofn.c_str(),"wb"),
@@ -512,6 +714,14 @@ int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out)
       sc.push_back(((tmp>0.0)?tmp:(float)1.0e-38));
     }
 
+    if(imp->IsSorted() && sc.size()!=imp->sortWeights.size()) {
+      std::stringstream strme;
+      strme << "Line " << lnc << " has " << sc.size() << " scores but "
+            << imp->sortWeights.size() << " sort weights were given";
+      UserMessage::Add(strme.str());
+      abort();
+    }
+
     if(f.empty()) {
       TRACE_ERR("WARNING: empty source phrase in line '"<<line<<"'\n");
       continue;
@@ -535,10 +745,8 @@ int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out)
     if(currF!=f) {
       // new src phrase
       currF=f;
-      if (PrintWordAlignment())
-        tgtCands.writeBinWithAlignment(ot);
-      else
-        tgtCands.writeBin(ot);
+      if(imp->IsSorted()) tgtCands.SortByWeightedScore(imp->sortWeights);
+      imp->WriteTgtCands(tgtCands,ot);
       tgtCands.clear();
 
       if(++count%10000==0) {
@@ -572,10 +780,8 @@ int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out)
     tgtCands.push_back(TgtCand(e,sc, alignmentString));
     CHECK(currFirstWord!=InvalidLabelId);
   }
-  if (PrintWordAlignment())
-    tgtCands.writeBinWithAlignment(ot);
-  else
-    tgtCands.writeBin(ot);
+  if(imp->IsSorted()) tgtCands.SortByWeightedScore(imp->sortWeights);
+  imp->WriteTgtCands(tgtCands,ot);
   tgtCands.clear();
 
   PTF pf;
@@ -611,6 +817,15 @@ int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out)
   imp->sv->Write(ofsv);
   imp->tv->Write(oftv);
 
+  if(imp->IsSorted()) {
+    FILE *ow=fOpen(ofw.c_str(),"wb");
+    fWriteVector(ow,imp->sortWeights);
+    fClose(ow);
+  } else if(FileExists(ofw)) {
+    // stale marker of an earlier presorted table with the same name
+    remove(ofw.c_str());
+  }
+
   return 1;
 }
 
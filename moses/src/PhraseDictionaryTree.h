@@ -3,6 +3,8 @@
 #ifndef moses_PhraseDictionaryTree_h
 #define moses_PhraseDictionaryTree_h
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -59,6 +61,15 @@ public:
     return 0;
   }
 
+  // sort the candidates of each source phrase by the weighted sum of their
+  // log scores when creating the table, best first, and store that sum.
+  // Must be called before Create(); one weight per score.
+  void SetSortWeights(const std::vector<float>& weights);
+
+  // whether the table read was created presorted, and with which weights
+  bool IsSorted() const;
+  const std::vector<float>& GetSortWeights() const;
+
   // convert from ascii phrase table format
   // note: only creates table, does not keep it in memory
   //        -> use Read(outFileNamePrefix);
@@ -77,14 +88,27 @@ public:
   void PrintTargetCandidates(const std::vector<std::string>& src,
                              std::ostream& out) const;
 
-  // get the target candidates for a given phrase
+  // get the target candidates for a given phrase.
+  // In a presorted table only the best maxCands are read (0 for all)
   void GetTargetCandidates(const std::vector<std::string>& src,
-                           std::vector<StringTgtCand>& rv) const;
+                           std::vector<StringTgtCand>& rv,
+                           size_t maxCands=0) const;
 
   // get the target candidates for a given phrase
   void GetTargetCandidates(const std::vector<std::string>& src,
                            std::vector<StringTgtCand>& rv,
-                           std::vector<std::string>& wa) const;
+                           std::vector<std::string>& wa,
+                           size_t maxCands=0) const;
+
+  // get the target candidates of many phrases in one sweep over the table:
+  // the source tree is walked in the order of the phrases and the candidates
+  // are read in the order they are stored, which turns the random seeks of
+  // single lookups into mostly sequential reads.
+  // rv[i] and wa[i] are the candidates of src[i]
+  void GetTargetCandidates(const std::vector<std::vector<std::string> >& src,
+                           std::vector<std::vector<StringTgtCand> >& rv,
+                           std::vector<std::vector<std::string> >& wa,
+                           size_t maxCands=0) const;
 
   /*****************************
    *   access to prefix tree   *
@@ -128,6 +152,41 @@ public:
   }
 };
 
+// target candidates of the source phrases of a batch of input sentences,
+// looked up in one sweep before the sentences are decoded.
+// Read-only once built, so it is shared by all decoding threads
+class PrefetchedCandidates
+{
+public:
+  struct Entry {
+    std::vector<StringTgtCand> cands;
+    std::vector<std::string> wa;
+  };
+
+  void AddTranslationId(long translationId) {
+    m_translationIds.insert(translationId);
+  }
+  // whether the sentence with this id was part of the batch
+  bool HasTranslationId(long translationId) const {
+    return m_translationIds.count(translationId) != 0;
+  }
+
+  Entry& Add(const std::vector<std::string>& src) {
+    return m_entries[src];
+  }
+  // the candidates of src, NULL if it was not looked up
+  const Entry* Find(const std::vector<std::string>& src) const {
+    std::map<std::vector<std::string>,Entry>::const_iterator i=m_entries.find(src);
+    return (i!=m_entries.end() ? &i->second : 0);
+  }
+  size_t GetSize() const {
+    return m_entries.size();
+  }
+
+private:
+  std::set<long> m_translationIds;
+  std::map<std::vector<std::string>,Entry> m_entries;
+};
 
 }
 
@@ -62,10 +62,22 @@ bool PhraseDictionaryTreeAdaptor::Load(const std::vector<FactorType> &input
 
 void PhraseDictionaryTreeAdaptor::InitializeForInput(InputType const& source)
 {
+  boost::shared_ptr<const PrefetchedCandidates> prefetched=GetFeature()->TakePrefetched(source.GetTranslationId());
+  // a sentence may be initialised more than once, it took its batch the first time
+  if(!prefetched && imp->m_prefetched && imp->m_prefetched->HasTranslationId(source.GetTranslationId()))
+    prefetched=imp->m_prefetched;
   imp->CleanUp();
   // caching only required for confusion net
   if(ConfusionNet const* cn=dynamic_cast<ConfusionNet const*>(&source))
     imp->CacheSource(*cn);
+  else
+    imp->m_prefetched=prefetched;
+}
+
+PrefetchedCandidates*
+PhraseDictionaryTreeAdaptor::Prefetch(const std::vector<InputType*>& sources) const
+{
+  return imp->Prefetch(sources);
 }
 
 TargetPhraseCollection const*
@@ -16,6 +16,7 @@ class Phrase;
 class PDTAimp;
 class WordsRange;
 class InputType;
+class PrefetchedCandidates;
 
 /*** Implementation of a phrase table in a trie that is binarized and
  * stored on disk.
@@ -62,6 +63,11 @@ public:
   size_t GetNumInputScores() const;
   virtual void InitializeForInput(InputType const& source);
 
+  // look up all source phrases of the given sentences in one sweep over the
+  // table. The decoding instances of this table use the result instead of
+  // looking the phrases up again, see PhraseDictionaryFeature::Prefetch
+  PrefetchedCandidates* Prefetch(const std::vector<InputType*>& sources) const;
+
   virtual ChartRuleLookupManager *CreateRuleLookupManager(
     const InputType &,
     const ChartCellCollection &) {
@@ -0,0 +1,497 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <boost/unordered_map.hpp>
+
+#include "util/bit_packing.hh"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "PhraseTableCompact.h"
+#include "InputFileStream.h"
+#include "UserMessage.h"
+#include "Util.h"
+
+namespace Moses
+{
+
+namespace
+{
+
+const char MAGIC[8] = "cmphtbl";
+
+// values of each score column kept to train the quantizer
+const size_t MAX_SCORE_SAMPLES = 1 << 22;
+
+class BitWriter
+{
+public:
+  BitWriter() : m_bits(0) {}
+
+  void Write(uint64_t value, uint8_t length) {
+    if (length == 0) return;
+    // util::WriteInt57 assumes zeroed memory and may touch 8 bytes
+    m_data.resize((m_bits + length) / 8 + 8, 0);
+    util::WriteInt57(&m_data[0], m_bits, length, value);
+    m_bits += length;
+  }
+  void WriteUnary(size_t value) {
+    for (size_t i = 0; i < value; ++i)
+      Write(1, 1);
+    Write(0, 1);
+  }
+  void Clear() {
+    m_data.clear();
+    m_bits = 0;
+  }
+  const uint8_t *GetData() const {
+    return &m_data[0];
+  }
+  size_t GetBytes() const {
+    return (m_bits + 7) / 8;
+  }
+
+private:
+  std::vector<uint8_t> m_data;
+  uint64_t m_bits;
+};
+
+class BitReader
+{
+public:
+  explicit BitReader(const void *base) : m_base(base), m_bits(0) {}
+
+  uint64_t Read(uint8_t length) {
+    if (length == 0) return 0;
+    uint64_t ret = util::ReadInt57(m_base, m_bits, length, (1ULL << length) - 1);
+    m_bits += length;
+    return ret;
+  }
+  size_t ReadUnary() {
+    size_t ret = 0;
+    while (Read(1)) ++ret;
+    return ret;
+  }
+
+private:
+  const void *m_base;
+  uint64_t m_bits;
+};
+
+struct Line {
+  std::string source;
+  std::vector<std::string> target;
+  std::vector<float> scores; //! floored log scores
+  std::vector<std::pair<size_t, size_t> > alignment; //! sorted
+};
+
+bool ParseLine(const std::string &text, size_t lineNum, size_t numScores, bool alignment, Line &out)
+{
+  std::vector<std::string> tokens = TokenizeMultiCharSeparator(text, "|||");
+  if (tokens.size() < 3 || (alignment && tokens.size() < 4)) {
+    std::stringstream strme;
+    strme << "Syntax error at line " << lineNum << " : " << text;
+    UserMessage::Add(strme.str());
+    return false;
+  }
+  out.source = Trim(tokens[0]);
+  out.target = Tokenize(tokens[1]);
+  std::vector<float> probs = Tokenize<float>(tokens[2]);
+  if (probs.size() != numScores) {
+    std::stringstream strme;
+    strme << "Line " << lineNum << " has " << probs.size() << " scores, expected " << numScores;
+    UserMessage::Add(strme.str());
+    return false;
+  }
+  out.scores.clear();
+  for (size_t i = 0; i < probs.size(); ++i)
+    out.scores.push_back(FloorScore(TransformScore(probs[i] > 0 ? probs[i] : 1.0e-38f)));
+  out.alignment.clear();
+  if (alignment) {
+    std::vector<std::string> points = Tokenize(tokens[3]);
+    for (size_t i = 0; i < points.size(); ++i) {
+      std::vector<size_t> point = Tokenize<size_t>(points[i], "-");
+      if (point.size() != 2) {
+        std::stringstream strme;
+        strme << "Bad alignment point " << points[i] << " at line " << lineNum;
+        UserMessage::Add(strme.str());
+        return false;
+      }
+      out.alignment.push_back(std::make_pair(point[0], point[1]));
+    }
+    std::sort(out.alignment.begin(), out.alignment.end());
+  }
+  return true;
+}
+
+/* Bins of equal population with the mean of their values as center, as in
+ * lm/quantize.cc. Sorts values. */
+void MakeBins(std::vector<float> &values, float *centers, uint64_t bins)
+{
+  std::sort(values.begin(), values.end());
+  const float *begin = values.empty() ? NULL : &values[0];
+  const float *start = begin, *finish;
+  for (uint64_t i = 0; i < bins; ++i, ++centers, start = finish) {
+    finish = begin + ((values.size() * (i + 1)) / bins);
+    if (finish == start) {
+      // zero length bucket
+      *centers = i ? *(centers - 1) : -std::numeric_limits<float>::infinity();
+    } else {
+      *centers = std::accumulate(start, finish, 0.0) / static_cast<float>(finish - start);
+    }
+  }
+}
+
+//! index of the center closest to value; centers are ascending
+uint64_t EncodeBin(const float *centers, uint64_t bins, float value)
+{
+  const float *above = std::lower_bound(centers, centers + bins, value);
+  if (above == centers) return 0;
+  if (above == centers + bins) return bins - 1;
+  return (*above - value < value - *(above - 1)) ? (above - centers) : (above - centers - 1);
+}
+
+struct Candidate {
+  std::vector<uint32_t> words;
+  std::vector<float> scores;
+  std::vector<std::pair<size_t, size_t> > alignment;
+  float weightedScore;
+};
+
+struct CandidateOrder {
+  bool operator()(const Candidate *a, const Candidate *b) const {
+    return a->weightedScore > b->weightedScore;
+  }
+};
+
+}
+
+bool PhraseTableCompact::Create(const std::string &inFile, const std::string &outFile, size_t numScores,
+                                bool alignment, const std::vector<float> &sortWeights, uint8_t scoreBits)
+{
+  if (!sortWeights.empty() && sortWeights.size() != numScores) {
+    UserMessage::Add("number of sort weights does not match the number of scores");
+    return false;
+  }
+  if (scoreBits == 0 || scoreBits > 24) {
+    UserMessage::Add("scores have to be quantized to between 1 and 24 bits");
+    return false;
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+
+  // first pass: vocabularies, field sizes and score samples
+  boost::unordered_map<std::string, uint32_t> sourceIds, targetIds;
+  std::vector<std::string> sourceVocab, targetVocab;
+  std::vector<std::vector<float> > samples(numScores);
+  uint64_t maxSourceLength = 0, maxTargets = 0, maxLength = 0, maxAlignCount = 0, maxAlignTarget = 0;
+  {
+    InputFileStream in(inFile);
+    std::string text, prevSource;
+    Line line;
+    size_t lineNum = 0, targets = 0;
+    uint64_t random = 1;
+    while (getline(in, text)) {
+      ++lineNum;
+      if (!ParseLine(text, lineNum, numScores, alignment, line)) return false;
+      if (line.source != prevSource) {
+        const std::vector<std::string> words = Tokenize(line.source);
+        maxSourceLength = std::max<uint64_t>(maxSourceLength, words.size());
+        for (size_t i = 0; i < words.size(); ++i)
+          PhraseTableMMap::AddWord(words[i], sourceVocab, sourceIds);
+      }
+      targets = (line.source == prevSource) ? targets + 1 : 1;
+      prevSource = line.source;
+      maxTargets = std::max<uint64_t>(maxTargets, targets);
+      maxLength = std::max<uint64_t>(maxLength, line.target.size());
+      maxAlignCount = std::max<uint64_t>(maxAlignCount, line.alignment.size());
+      for (size_t i = 0; i < line.alignment.size(); ++i)
+        maxAlignTarget = std::max<uint64_t>(maxAlignTarget, line.alignment[i].second);
+      for (size_t i = 0; i < line.target.size(); ++i)
+        PhraseTableMMap::AddWord(line.target[i], targetVocab, targetIds);
+      // reservoir sampling, deterministic so that builds are reproducible
+      random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+      for (size_t i = 0; i < numScores; ++i) {
+        if (samples[i].size() < MAX_SCORE_SAMPLES) {
+          samples[i].push_back(line.scores[i]);
+        } else {
+          uint64_t slot = (random >> 11) % lineNum;
+          if (slot < MAX_SCORE_SAMPLES) samples[i][slot] = line.scores[i];
+        }
+      }
+    }
+  }
+
+  header.sourceLengthBits = util::RequiredBits(maxSourceLength);
+  header.sourceWordBits = util::RequiredBits(sourceVocab.empty() ? 0 : sourceVocab.size() - 1);
+  header.targetsBits = util::RequiredBits(maxTargets);
+  header.lengthBits = util::RequiredBits(maxLength);
+  header.wordBits = util::RequiredBits(targetVocab.empty() ? 0 : targetVocab.size() - 1);
+  header.scoreBits = scoreBits;
+  header.alignCountBits = util::RequiredBits(maxAlignCount);
+  header.alignTargetBits = util::RequiredBits(maxAlignTarget);
+
+  const uint64_t bins = 1ULL << scoreBits;
+  std::vector<float> centers(numScores * bins);
+  for (size_t i = 0; i < numScores; ++i)
+    MakeBins(samples[i], &centers[i * bins], bins);
+  std::vector<std::vector<float> >().swap(samples);
+
+  // second pass: records
+  FILE *out = fopen(outFile.c_str(), "wb");
+  if (out == NULL) {
+    UserMessage::Add("Cannot open " + outFile + " for writing");
+    return false;
+  }
+  uint64_t offset = 0;
+  PhraseTableMMap::WriteOrAbort(out, &header, sizeof(header), offset);
+
+  std::vector<std::pair<uint64_t, uint64_t> > sources;
+  {
+    InputFileStream in(inFile);
+    std::string text, currSource;
+    std::vector<uint32_t> sourceWords;
+    std::vector<uint64_t> sourceHashes;
+    std::vector<Candidate> candidates;
+    std::vector<const Candidate*> order;
+    BitWriter writer;
+    Line line;
+    size_t lineNum = 0;
+    while (true) {
+      const bool more = static_cast<bool>(getline(in, text));
+      if (more) {
+        ++lineNum;
+        if (!ParseLine(text, lineNum, numScores, alignment, line)) {
+          fclose(out);
+          return false;
+        }
+      }
+
+      // flush the previous source phrase
+      if (!candidates.empty() && (!more || line.source != currSource)) {
+        order.clear();
+        for (size_t i = 0; i < candidates.size(); ++i)
+          order.push_back(&candidates[i]);
+        if (!sortWeights.empty())
+          std::stable_sort(order.begin(), order.end(), CandidateOrder());
+
+        writer.Clear();
+        writer.Write(sourceWords.size(), header.sourceLengthBits);
+        for (size_t i = 0; i < sourceWords.size(); ++i)
+          writer.Write(sourceWords[i], header.sourceWordBits);
+        writer.Write(order.size(), header.targetsBits);
+        for (size_t i = 0; i < order.size(); ++i) {
+          const Candidate &cand = *order[i];
+          writer.Write(cand.words.size(), header.lengthBits);
+          for (size_t j = 0; j < cand.words.size(); ++j)
+            writer.Write(cand.words[j], header.wordBits);
+          for (size_t j = 0; j < numScores; ++j)
+            writer.Write(EncodeBin(&centers[j * bins], bins, cand.scores[j]), scoreBits);
+          if (alignment) {
+            writer.Write(cand.alignment.size(), header.alignCountBits);
+            size_t prevSourcePos = 0;
+            for (size_t j = 0; j < cand.alignment.size(); ++j) {
+              writer.WriteUnary(cand.alignment[j].first - prevSourcePos);
+              writer.Write(cand.alignment[j].second, header.alignTargetBits);
+              prevSourcePos = cand.alignment[j].first;
+            }
+          }
+        }
+        sources.push_back(std::make_pair(PhraseTableMMap::HashPhrase(&sourceHashes[0], sourceHashes.size()), offset));
+        PhraseTableMMap::WriteOrAbort(out, writer.GetData(), writer.GetBytes(), offset);
+        header.numPairs += candidates.size();
+        candidates.clear();
+        if (sources.size() % 10000 == 0) {
+          TRACE_ERR(".");
+          if (sources.size() % 500000 == 0) TRACE_ERR("[phrase:" << sources.size() << "]\n");
+        }
+      }
+      if (!more) break;
+
+      if (candidates.empty()) {
+        currSource = line.source;
+        std::vector<std::string> words = Tokenize(currSource);
+        if (words.empty()) {
+          TRACE_ERR("WARNING: empty source phrase in line '" << text << "'\n");
+          continue;
+        }
+        sourceWords.clear();
+        sourceHashes.clear();
+        for (size_t i = 0; i < words.size(); ++i) {
+          sourceWords.push_back(sourceIds[words[i]]);
+          sourceHashes.push_back(PhraseTableMMap::HashWord(words[i]));
+        }
+      }
+
+      candidates.push_back(Candidate());
+      Candidate &cand = candidates.back();
+      for (size_t i = 0; i < line.target.size(); ++i)
+        cand.words.push_back(targetIds[line.target[i]]);
+      cand.scores = line.scores;
+      cand.alignment = line.alignment;
+      cand.weightedScore = 0;
+      for (size_t i = 0; i < sortWeights.size(); ++i)
+        cand.weightedScore += sortWeights[i] * cand.scores[i];
+    }
+  }
+  // bit_packing reads 8 bytes at a time
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  PhraseTableMMap::WriteOrAbort(out, zeros, sizeof(zeros), offset);
+
+  if (!PhraseTableMMap::WriteSourceTable(out, offset, sources, header.sourceTableOffset, header.sourceTableBytes)) {
+    fclose(out);
+    return false;
+  }
+  header.numSources = sources.size();
+  header.sourceVocabSize = sourceVocab.size();
+  PhraseTableMMap::WriteVocab(out, offset, sourceVocab, header.sourceVocabOffset, header.sourceStringsOffset);
+
+  PhraseTableMMap::PadTo(out, offset, 8);
+  header.centersOffset = offset;
+  PhraseTableMMap::WriteOrAbort(out, &centers[0], centers.size() * sizeof(float), offset);
+
+  header.targetVocabSize = targetVocab.size();
+  PhraseTableMMap::WriteVocab(out, offset, targetVocab, header.targetVocabOffset, header.targetStringsOffset);
+
+  PhraseTableMMap::PadTo(out, offset, 8);
+  header.numSortWeights = sortWeights.size();
+  header.sortWeightsOffset = offset;
+  if (!sortWeights.empty())
+    PhraseTableMMap::WriteOrAbort(out, &sortWeights[0], sortWeights.size() * sizeof(float), offset);
+
+  memcpy(header.magic, MAGIC, sizeof(header.magic));
+  header.version = VERSION;
+  header.numScores = numScores;
+  header.hasAlignment = alignment;
+  header.fileSize = offset;
+  fseek(out, 0, SEEK_SET);
+  PhraseTableMMap::WriteOrAbort(out, &header, sizeof(header), offset);
+  if (fclose(out) != 0) {
+    UserMessage::Add("Error writing " + outFile);
+    return false;
+  }
+
+  TRACE_ERR("distinct source phrases: " << header.numSources
+            << " number of phrase pairs: " << header.numPairs
+            << " target vocabulary: " << header.targetVocabSize
+            << " size: " << header.fileSize << " bytes\n");
+  return true;
+}
+
+bool PhraseTableCompact::Load(const std::string &file, util::LoadMethod method)
+{
+  try {
+    util::scoped_fd fd(util::OpenReadOrThrow(file.c_str()));
+    const uint64_t size = util::SizeFile(fd.get());
+    if (size < sizeof(Header)) {
+      UserMessage::Add(file + " is not a compact phrase table");
+      return false;
+    }
+    util::MapRead(method, fd.get(), 0, size, m_memory);
+  } catch (const util::Exception &e) {
+    UserMessage::Add(std::string("Cannot map phrase table: ") + e.what());
+    return false;
+  }
+
+  m_header = reinterpret_cast<const Header*>(Begin());
+  if (memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0 || m_header->version != VERSION) {
+    UserMessage::Add(file + " is not a compact phrase table of this version; rebuild it with processPhraseTable -compact");
+    return false;
+  }
+  if (m_header->fileSize != m_memory.size()) {
+    UserMessage::Add(file + " is truncated");
+    return false;
+  }
+  util::BitPackingSanity();
+  m_centers = reinterpret_cast<const float*>(Begin() + m_header->centersOffset);
+  // read only: Find does not write to the table
+  m_sourceTable = PhraseTableMMap::SourceTable(const_cast<char*>(Begin()) + m_header->sourceTableOffset,
+                  m_header->sourceTableBytes);
+  return true;
+}
+
+bool PhraseTableCompact::Find(const std::vector<std::string> &words, std::vector<Target> &out, size_t maxTargets) const
+{
+  const size_t size = words.size();
+  if (size == 0) return false;
+  std::vector<uint64_t> hashes(size);
+  for (size_t pos = 0; pos < size; ++pos)
+    hashes[pos] = PhraseTableMMap::HashWord(words[pos]);
+
+  PhraseTableMMap::SourceTable::ConstIterator iter;
+  if (!m_sourceTable.Find(PhraseTableMMap::HashPhrase(&hashes[0], size), iter)) return false;
+
+  const Header &header = *m_header;
+  const uint64_t bins = 1ULL << header.scoreBits;
+  BitReader reader(Begin() + iter->offset);
+  // the hash may be shared by another phrase
+  if (reader.Read(header.sourceLengthBits) != size) return false;
+  for (size_t pos = 0; pos < size; ++pos) {
+    if (GetSourceWord(reader.Read(header.sourceWordBits)) != StringPiece(words[pos]))
+      return false;
+  }
+  size_t numTargets = reader.Read(header.targetsBits);
+  if (maxTargets > 0 && maxTargets < numTargets)
+    numTargets = maxTargets;
+
+  out.resize(numTargets);
+  for (size_t i = 0; i < numTargets; ++i) {
+    Target &target = out[i];
+    target.words.resize(reader.Read(header.lengthBits));
+    for (size_t j = 0; j < target.words.size(); ++j)
+      target.words[j] = reader.Read(header.wordBits);
+    target.scores.resize(header.numScores);
+    for (size_t j = 0; j < header.numScores; ++j)
+      target.scores[j] = m_centers[j * bins + reader.Read(header.scoreBits)];
+    target.alignment.clear();
+    if (header.hasAlignment) {
+      const size_t numPoints = reader.Read(header.alignCountBits);
+      size_t sourcePos = 0;
+      for (size_t j = 0; j < numPoints; ++j) {
+        sourcePos += reader.ReadUnary();
+        target.alignment.insert(std::make_pair(sourcePos, static_cast<size_t>(reader.Read(header.alignTargetBits))));
+      }
+    }
+  }
+  return true;
+}
+
+StringPiece PhraseTableCompact::GetSourceWord(uint32_t id) const
+{
+  return PhraseTableMMap::GetVocabWord(Begin(), m_header->sourceVocabOffset, m_header->sourceStringsOffset, id);
+}
+
+StringPiece PhraseTableCompact::GetTargetWord(uint32_t id) const
+{
+  return PhraseTableMMap::GetVocabWord(Begin(), m_header->targetVocabOffset, m_header->targetStringsOffset, id);
+}
+
+std::vector<float> PhraseTableCompact::GetSortWeights() const
+{
+  const float *begin = reinterpret_cast<const float*>(Begin() + m_header->sortWeightsOffset);
+  return std::vector<float>(begin, begin + m_header->numSortWeights);
+}
+
+}
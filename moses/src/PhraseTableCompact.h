@@ -0,0 +1,136 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_PhraseTableCompact_h
+#define moses_PhraseTableCompact_h
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+#include "PhraseTableMMap.h"
+
+namespace Moses
+{
+
+/** Compact variant of PhraseTableMMap, for tables that would not otherwise
+ * fit in memory. It is memory mapped the same way and looked up through the
+ * same source hash table, but
+ *  - the records are bit packed with util/bit_packing.hh, every field using
+ *    just the bits its largest value needs: target phrases are vocabulary ids
+ *    of RequiredBits(vocabulary size) bits,
+ *  - each score column is quantized into 2^scoreBits bins of equal
+ *    population, as lm/quantize.cc does for KenLM, and stored as a bin index,
+ *  - alignment points are sorted and their source positions delta encoded in
+ *    unary, which takes one or two bits for most points.
+ *
+ * A record is the source length, source word ids[source length] and the
+ * number of targets, followed by the targets, each
+ *   length, word ids[length], score bins[numScores],
+ *   number of alignment points, points (unary source delta, target position)
+ * Records start on byte boundaries.
+ */
+class PhraseTableCompact
+{
+public:
+  static const uint32_t VERSION = 2;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numScores;
+    uint32_t hasAlignment;
+    uint32_t numSortWeights; //! 0 if the targets are in table order
+    uint64_t numSources, numPairs, sourceVocabSize, targetVocabSize;
+    uint8_t sourceLengthBits, sourceWordBits;
+    uint8_t targetsBits, lengthBits, wordBits, scoreBits, alignCountBits, alignTargetBits;
+    uint64_t sourceTableOffset, sourceTableBytes;
+    uint64_t sourceVocabOffset, sourceStringsOffset;
+    uint64_t centersOffset; //! float[numScores << scoreBits], bin centers of each score
+    uint64_t targetVocabOffset, targetStringsOffset;
+    uint64_t sortWeightsOffset;
+    uint64_t fileSize;
+  };
+
+  //! decoded target phrase, with the accessors of PhraseTableMMap::Target
+  struct Target {
+    std::vector<uint32_t> words;
+    std::vector<float> scores;
+    std::set<std::pair<size_t, size_t> > alignment;
+
+    size_t GetSize() const {
+      return words.size();
+    }
+    const float *GetScores() const {
+      return &scores[0];
+    }
+    uint32_t GetWord(size_t pos) const {
+      return words[pos];
+    }
+    const std::set<std::pair<size_t, size_t> > &GetAlignment() const {
+      return alignment;
+    }
+  };
+
+  //! processPhraseTable -compact appends this to the file name
+  static const char *FileSuffix() {
+    return ".binphr.compact";
+  }
+
+  PhraseTableCompact() : m_header(NULL), m_centers(NULL) {}
+
+  /** convert from the text phrase table format, sorted by source phrase.
+   * The file is read twice, to size the fields and train the quantizer.
+   * If sortWeights is not empty, the targets of each source phrase are stored
+   * by descending weighted log score. Returns false on error. */
+  static bool Create(const std::string &inFile, const std::string &outFile, size_t numScores,
+                     bool alignment, const std::vector<float> &sortWeights, uint8_t scoreBits = 8);
+
+  //! map the table. Returns false on error
+  bool Load(const std::string &file, util::LoadMethod method = util::LAZY);
+
+  /** decode the first maxTargets targets (0 for all) of the source phrase
+   * with the given words. Returns false if it is not in the table. */
+  bool Find(const std::vector<std::string> &words, std::vector<Target> &out, size_t maxTargets = 0) const;
+
+  const Header &GetHeader() const {
+    return *m_header;
+  }
+  StringPiece GetSourceWord(uint32_t id) const;
+  StringPiece GetTargetWord(uint32_t id) const;
+  std::vector<float> GetSortWeights() const;
+
+private:
+  const char *Begin() const {
+    return m_memory.begin();
+  }
+
+  util::scoped_memory m_memory;
+  const Header *m_header;
+  const float *m_centers;
+  PhraseTableMMap::SourceTable m_sourceTable;
+};
+
+}
+
+#endif
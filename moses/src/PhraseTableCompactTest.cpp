@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PhraseTableCompact.h"
+#include "Util.h"
+
+#define BOOST_TEST_MODULE PhraseTableCompactTest
+#include <boost/test/unit_test.hpp>
+
+using namespace Moses;
+
+namespace
+{
+
+const char *TABLE =
+  "das haus ||| the building ||| 0.1 0.2 ||| 0-0 1-1\n"
+  "das haus ||| the house ||| 0.8 0.5 ||| 0-0 1-1\n"
+  "das kleine haus ||| the small house ||| 0.6 0.4 ||| 0-0 1-1 2-2\n"
+  "haus ||| house ||| 0.7 0.6 ||| 0-0\n"
+  "haus ||| home ||| 0.3 0.4 ||| 0-0\n";
+
+const char *TEXT_NAME = "phrase_table_compact_test.txt";
+const char *FILE_NAME = "phrase_table_compact_test.binphr.compact";
+
+std::string TargetString(const PhraseTableCompact &table, const PhraseTableCompact::Target &target)
+{
+  std::string ret;
+  for (size_t pos = 0; pos < target.GetSize(); ++pos) {
+    if (pos) ret += " ";
+    const StringPiece word = table.GetTargetWord(target.GetWord(pos));
+    ret.append(word.data(), word.size());
+  }
+  return ret;
+}
+
+struct TableFixture {
+  TableFixture() {
+    {
+      std::ofstream text(TEXT_NAME);
+      text << TABLE;
+    }
+    std::vector<float> sortWeights(2, 1.0);
+    BOOST_REQUIRE(PhraseTableCompact::Create(TEXT_NAME, FILE_NAME, 2, true, sortWeights));
+    BOOST_REQUIRE(table.Load(FILE_NAME));
+  }
+  ~TableFixture() {
+    std::remove(TEXT_NAME);
+    std::remove(FILE_NAME);
+  }
+  PhraseTableCompact table;
+};
+
+BOOST_FIXTURE_TEST_CASE(header, TableFixture)
+{
+  const PhraseTableCompact::Header &header = table.GetHeader();
+  BOOST_CHECK_EQUAL(3U, header.numSources);
+  BOOST_CHECK_EQUAL(5U, header.numPairs);
+  BOOST_CHECK_EQUAL(3U, header.sourceVocabSize);
+  BOOST_CHECK_EQUAL(2U, table.GetSortWeights().size());
+}
+
+BOOST_FIXTURE_TEST_CASE(round_trip, TableFixture)
+{
+  std::vector<PhraseTableCompact::Target> targets;
+  BOOST_REQUIRE(table.Find(Tokenize("das haus"), targets));
+  BOOST_REQUIRE_EQUAL(2U, targets.size());
+
+  // sorted by weighted score; few distinct scores, so quantization is exact
+  BOOST_CHECK_EQUAL("the house", TargetString(table, targets[0]));
+  BOOST_CHECK_CLOSE(FloorScore(TransformScore(0.8f)), targets[0].GetScores()[0], 0.001);
+  BOOST_CHECK_CLOSE(FloorScore(TransformScore(0.5f)), targets[0].GetScores()[1], 0.001);
+  BOOST_CHECK_EQUAL(2U, targets[0].GetAlignment().size());
+  BOOST_CHECK(targets[0].GetAlignment().count(std::make_pair(1, 1)));
+  BOOST_CHECK_EQUAL("the building", TargetString(table, targets[1]));
+
+  BOOST_REQUIRE(table.Find(Tokenize("das kleine haus"), targets));
+  BOOST_REQUIRE_EQUAL(1U, targets.size());
+  BOOST_CHECK_EQUAL("the small house", TargetString(table, targets[0]));
+  BOOST_CHECK_EQUAL(3U, targets[0].GetAlignment().size());
+  BOOST_CHECK(targets[0].GetAlignment().count(std::make_pair(2, 2)));
+
+  BOOST_REQUIRE(table.Find(Tokenize("haus"), targets, 1));
+  BOOST_REQUIRE_EQUAL(1U, targets.size());
+  BOOST_CHECK_EQUAL("house", TargetString(table, targets[0]));
+}
+
+BOOST_FIXTURE_TEST_CASE(unknown_source, TableFixture)
+{
+  std::vector<PhraseTableCompact::Target> targets;
+  BOOST_CHECK(!table.Find(Tokenize("das"), targets));
+  BOOST_CHECK(!table.Find(Tokenize("haus das"), targets));
+  BOOST_CHECK(!table.Find(Tokenize("das kleine"), targets));
+  BOOST_CHECK(!table.Find(Tokenize("kleine haus"), targets));
+  BOOST_CHECK(!table.Find(Tokenize("hause"), targets));
+  BOOST_CHECK(!table.Find(std::vector<std::string>(), targets));
+}
+
+}
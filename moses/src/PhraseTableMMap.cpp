@@ -0,0 +1,379 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
+#include "PhraseTableMMap.h"
+#include "UserMessage.h"
+#include "Util.h"
+
+namespace Moses
+{
+
+namespace
+{
+
+const char MAGIC[8] = "mmphtbl";
+
+struct Candidate {
+  std::vector<uint32_t> words;
+  std::vector<float> scores;
+  std::string alignment;
+  float weightedScore;
+};
+
+struct CandidateOrder {
+  bool operator()(const Candidate *a, const Candidate *b) const {
+    return a->weightedScore > b->weightedScore;
+  }
+};
+
+//! append the record of one source phrase to buffer
+void AppendRecord(const std::vector<uint32_t> &source, const std::vector<Candidate> &targets,
+                  const std::vector<float> &sortWeights, std::vector<char> &buffer)
+{
+  std::vector<const Candidate*> order(targets.size());
+  for (size_t i = 0; i < targets.size(); ++i)
+    order[i] = &targets[i];
+  if (!sortWeights.empty())
+    std::stable_sort(order.begin(), order.end(), CandidateOrder());
+
+  buffer.clear();
+  uint32_t head[2] = {static_cast<uint32_t>(source.size()), static_cast<uint32_t>(targets.size())};
+  buffer.insert(buffer.end(), reinterpret_cast<const char*>(head), reinterpret_cast<const char*>(head + 2));
+  buffer.insert(buffer.end(), reinterpret_cast<const char*>(&source[0]),
+                reinterpret_cast<const char*>(&source[0] + source.size()));
+  for (size_t i = 0; i < order.size(); ++i) {
+    const Candidate &cand = *order[i];
+    uint32_t sizes[2] = {static_cast<uint32_t>(cand.words.size()), static_cast<uint32_t>(cand.alignment.size())};
+    buffer.insert(buffer.end(), reinterpret_cast<const char*>(sizes), reinterpret_cast<const char*>(sizes + 2));
+    buffer.insert(buffer.end(), reinterpret_cast<const char*>(&cand.scores[0]),
+                  reinterpret_cast<const char*>(&cand.scores[0] + cand.scores.size()));
+    if (!cand.words.empty())
+      buffer.insert(buffer.end(), reinterpret_cast<const char*>(&cand.words[0]),
+                    reinterpret_cast<const char*>(&cand.words[0] + cand.words.size()));
+    buffer.insert(buffer.end(), cand.alignment.begin(), cand.alignment.end());
+    buffer.resize((buffer.size() + 3) & ~3, 0);
+  }
+}
+
+}
+
+uint64_t PhraseTableMMap::HashWord(const StringPiece &word)
+{
+  return util::MurmurHashNative(word.data(), word.size());
+}
+
+uint64_t PhraseTableMMap::HashPhrase(const uint64_t *words, size_t size)
+{
+  uint64_t ret = util::MurmurHashNative(words, size * sizeof(uint64_t));
+  // 0 marks empty buckets
+  return ret ? ret : 1;
+}
+
+void PhraseTableMMap::WriteOrAbort(FILE *out, const void *data, size_t size, uint64_t &offset)
+{
+  if (size && fwrite(data, 1, size, out) != size) {
+    TRACE_ERR("ERROR: fwrite!\n");
+    abort();
+  }
+  offset += size;
+}
+
+void PhraseTableMMap::PadTo(FILE *out, uint64_t &offset, size_t alignment)
+{
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  WriteOrAbort(out, zeros, (alignment - offset % alignment) % alignment, offset);
+}
+
+bool PhraseTableMMap::WriteSourceTable(FILE *out, uint64_t &offset,
+                                       std::vector<std::pair<uint64_t, uint64_t> > &sources,
+                                       uint64_t &tableOffset, uint64_t &tableBytes)
+{
+  std::sort(sources.begin(), sources.end());
+  for (size_t i = 1; i < sources.size(); ++i) {
+    if (sources[i].first == sources[i - 1].first) {
+      UserMessage::Add("Source phrases are repeated or collide; the phrase table has to be sorted by source phrase");
+      return false;
+    }
+  }
+  PadTo(out, offset, 8);
+  tableOffset = offset;
+  tableBytes = SourceTable::Size(sources.size(), 1.5);
+  std::vector<char> table(tableBytes, 0);
+  SourceTable sourceTable(&table[0], table.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    SourceEntry entry;
+    entry.key = sources[i].first;
+    entry.offset = sources[i].second;
+    sourceTable.Insert(entry);
+  }
+  WriteOrAbort(out, &table[0], table.size(), offset);
+  return true;
+}
+
+uint32_t PhraseTableMMap::AddWord(const std::string &word, std::vector<std::string> &vocab,
+                                  boost::unordered_map<std::string, uint32_t> &ids)
+{
+  std::pair<boost::unordered_map<std::string, uint32_t>::iterator, bool> ins =
+    ids.insert(std::make_pair(word, static_cast<uint32_t>(vocab.size())));
+  if (ins.second) vocab.push_back(word);
+  return ins.first->second;
+}
+
+void PhraseTableMMap::WriteVocab(FILE *out, uint64_t &offset, const std::vector<std::string> &vocab,
+                                 uint64_t &vocabOffset, uint64_t &stringsOffset)
+{
+  PadTo(out, offset, 8);
+  vocabOffset = offset;
+  std::vector<uint64_t> stringOffsets(1, 0);
+  for (size_t i = 0; i < vocab.size(); ++i)
+    stringOffsets.push_back(stringOffsets.back() + vocab[i].size());
+  WriteOrAbort(out, &stringOffsets[0], stringOffsets.size() * sizeof(uint64_t), offset);
+  stringsOffset = offset;
+  for (size_t i = 0; i < vocab.size(); ++i)
+    WriteOrAbort(out, vocab[i].data(), vocab[i].size(), offset);
+}
+
+StringPiece PhraseTableMMap::GetVocabWord(const char *base, uint64_t vocabOffset, uint64_t stringsOffset, uint32_t id)
+{
+  const uint64_t *offsets = reinterpret_cast<const uint64_t*>(base + vocabOffset);
+  return StringPiece(base + stringsOffset + offsets[id], offsets[id + 1] - offsets[id]);
+}
+
+bool PhraseTableMMap::Create(std::istream &in, const std::string &outFile, size_t numScores,
+                             bool alignment, const std::vector<float> &sortWeights)
+{
+  if (!sortWeights.empty() && sortWeights.size() != numScores) {
+    UserMessage::Add("number of sort weights does not match the number of scores");
+    return false;
+  }
+
+  FILE *out = fopen(outFile.c_str(), "wb");
+  if (out == NULL) {
+    UserMessage::Add("Cannot open " + outFile + " for writing");
+    return false;
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  uint64_t offset = 0;
+  WriteOrAbort(out, &header, sizeof(header), offset);
+
+  boost::unordered_map<std::string, uint32_t> sourceIds, targetIds;
+  std::vector<std::string> sourceVocab, targetVocab;
+  std::vector<std::pair<uint64_t, uint64_t> > sources;
+
+  std::vector<uint32_t> currSource;
+  std::vector<uint64_t> currSourceHashes;
+  std::string currSourceString;
+  std::vector<Candidate> candidates;
+  std::vector<char> buffer;
+  std::string line;
+  size_t lineNum = 0;
+
+  while (true) {
+    const bool more = static_cast<bool>(getline(in, line));
+    std::vector<std::string> tokens;
+    if (more) {
+      ++lineNum;
+      tokens = TokenizeMultiCharSeparator(line, "|||");
+      if (tokens.size() < 3 || (alignment && tokens.size() < 4)) {
+        std::stringstream strme;
+        strme << "Syntax error at line " << lineNum << " : " << line;
+        UserMessage::Add(strme.str());
+        fclose(out);
+        return false;
+      }
+    }
+
+    // flush the previous source phrase
+    if (!currSource.empty() && (!more || Trim(tokens[0]) != currSourceString)) {
+      AppendRecord(currSource, candidates, sortWeights, buffer);
+      PadTo(out, offset, 8);
+      sources.push_back(std::make_pair(HashPhrase(&currSourceHashes[0], currSourceHashes.size()), offset));
+      WriteOrAbort(out, &buffer[0], buffer.size(), offset);
+      header.numPairs += candidates.size();
+      candidates.clear();
+      currSource.clear();
+      currSourceHashes.clear();
+      if (sources.size() % 10000 == 0) {
+        TRACE_ERR(".");
+        if (sources.size() % 500000 == 0) TRACE_ERR("[phrase:" << sources.size() << "]\n");
+      }
+    }
+    if (!more) break;
+
+    if (currSource.empty()) {
+      currSourceString = Trim(tokens[0]);
+      std::vector<std::string> words = Tokenize(currSourceString);
+      if (words.empty()) {
+        TRACE_ERR("WARNING: empty source phrase in line '" << line << "'\n");
+        continue;
+      }
+      for (size_t i = 0; i < words.size(); ++i) {
+        currSource.push_back(AddWord(words[i], sourceVocab, sourceIds));
+        currSourceHashes.push_back(HashWord(words[i]));
+      }
+    }
+
+    candidates.push_back(Candidate());
+    Candidate &cand = candidates.back();
+    std::vector<std::string> words = Tokenize(tokens[1]);
+    for (size_t i = 0; i < words.size(); ++i)
+      cand.words.push_back(AddWord(words[i], targetVocab, targetIds));
+    std::vector<float> probs = Tokenize<float>(tokens[2]);
+    if (probs.size() != numScores) {
+      std::stringstream strme;
+      strme << "Line " << lineNum << " has " << probs.size() << " scores, expected " << numScores;
+      UserMessage::Add(strme.str());
+      fclose(out);
+      return false;
+    }
+    cand.weightedScore = 0;
+    for (size_t i = 0; i < probs.size(); ++i) {
+      cand.scores.push_back(FloorScore(TransformScore(probs[i] > 0 ? probs[i] : 1.0e-38f)));
+      if (!sortWeights.empty()) cand.weightedScore += sortWeights[i] * cand.scores.back();
+    }
+    if (alignment) cand.alignment = Trim(tokens[3]);
+  }
+
+  if (!WriteSourceTable(out, offset, sources, header.sourceTableOffset, header.sourceTableBytes)) {
+    fclose(out);
+    return false;
+  }
+  header.numSources = sources.size();
+  header.sourceVocabSize = sourceVocab.size();
+  WriteVocab(out, offset, sourceVocab, header.sourceVocabOffset, header.sourceStringsOffset);
+  header.targetVocabSize = targetVocab.size();
+  WriteVocab(out, offset, targetVocab, header.targetVocabOffset, header.targetStringsOffset);
+
+  PadTo(out, offset, 8);
+  header.numSortWeights = sortWeights.size();
+  header.sortWeightsOffset = offset;
+  if (!sortWeights.empty())
+    WriteOrAbort(out, &sortWeights[0], sortWeights.size() * sizeof(float), offset);
+
+  memcpy(header.magic, MAGIC, sizeof(header.magic));
+  header.version = VERSION;
+  header.numScores = numScores;
+  header.hasAlignment = alignment;
+  header.fileSize = offset;
+  fseek(out, 0, SEEK_SET);
+  WriteOrAbort(out, &header, sizeof(header), offset);
+  if (fclose(out) != 0) {
+    UserMessage::Add("Error writing " + outFile);
+    return false;
+  }
+
+  TRACE_ERR("distinct source phrases: " << header.numSources
+            << " number of phrase pairs: " << header.numPairs
+            << " target vocabulary: " << header.targetVocabSize << "\n");
+  return true;
+}
+
+bool PhraseTableMMap::Load(const std::string &file, util::LoadMethod method)
+{
+  try {
+    util::scoped_fd fd(util::OpenReadOrThrow(file.c_str()));
+    const uint64_t size = util::SizeFile(fd.get());
+    if (size < sizeof(Header)) {
+      UserMessage::Add(file + " is not a memory mapped phrase table");
+      return false;
+    }
+    util::MapRead(method, fd.get(), 0, size, m_memory);
+  } catch (const util::Exception &e) {
+    UserMessage::Add(std::string("Cannot map phrase table: ") + e.what());
+    return false;
+  }
+
+  m_header = reinterpret_cast<const Header*>(Begin());
+  if (memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0 || m_header->version != VERSION) {
+    UserMessage::Add(file + " is not a memory mapped phrase table of this version; rebuild it with processPhraseTable -mmap");
+    return false;
+  }
+  if (m_header->fileSize != m_memory.size()) {
+    UserMessage::Add(file + " is truncated");
+    return false;
+  }
+  // read only: Find does not write to the table
+  m_sourceTable = SourceTable(const_cast<char*>(Begin()) + m_header->sourceTableOffset,
+                              m_header->sourceTableBytes);
+  return true;
+}
+
+bool PhraseTableMMap::Find(const std::vector<std::string> &words, Record &out) const
+{
+  const size_t size = words.size();
+  if (size == 0) return false;
+  std::vector<uint64_t> hashes(size);
+  for (size_t pos = 0; pos < size; ++pos)
+    hashes[pos] = HashWord(words[pos]);
+
+  SourceTable::ConstIterator iter;
+  if (!m_sourceTable.Find(HashPhrase(&hashes[0], size), iter)) return false;
+  Record record(Begin() + iter->offset);
+  // the hash may be shared by another phrase
+  if (record.GetSourceSize() != size) return false;
+  for (size_t pos = 0; pos < size; ++pos) {
+    if (GetSourceWord(record.GetSourceWord(pos)) != StringPiece(words[pos]))
+      return false;
+  }
+  out = record;
+  return true;
+}
+
+bool PhraseTableMMap::Find(const std::vector<std::string> &words, std::vector<Target> &out, size_t maxTargets) const
+{
+  Record record;
+  if (!Find(words, record)) return false;
+  size_t numTargets = record.GetNumTargets();
+  if (maxTargets > 0 && maxTargets < numTargets)
+    numTargets = maxTargets;
+  out.clear();
+  out.reserve(numTargets);
+  Target target = record.GetFirstTarget(m_header->numScores);
+  for (size_t i = 0; i < numTargets; ++i, target = target.Next())
+    out.push_back(target);
+  return true;
+}
+
+StringPiece PhraseTableMMap::GetSourceWord(uint32_t id) const
+{
+  return GetVocabWord(Begin(), m_header->sourceVocabOffset, m_header->sourceStringsOffset, id);
+}
+
+StringPiece PhraseTableMMap::GetTargetWord(uint32_t id) const
+{
+  return GetVocabWord(Begin(), m_header->targetVocabOffset, m_header->targetStringsOffset, id);
+}
+
+std::vector<float> PhraseTableMMap::GetSortWeights() const
+{
+  const float *begin = reinterpret_cast<const float*>(Begin() + m_header->sortWeightsOffset);
+  return std::vector<float>(begin, begin + m_header->numSortWeights);
+}
+
+}
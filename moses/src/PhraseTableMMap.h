@@ -0,0 +1,206 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_PhraseTableMMap_h
+#define moses_PhraseTableMMap_h
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+
+#include "util/mmap.hh"
+#include "util/probing_hash_table.hh"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+/** Binary phrase table in a single file that is memory mapped read-only and
+ * used in place, so one copy in the page cache serves all decoder threads
+ * and processes on a host.
+ *
+ * Layout: a Header, the records of all source phrases, a probing hash table
+ * from source phrase to record, the source and target vocabularies and the
+ * sort weights. The hash table is keyed by a 64 bit hash of the source words,
+ * as in the probing vocabulary of KenLM; since different phrases may share a
+ * hash, records hold the source words as ids into the source vocabulary and
+ * lookups compare them. Target words are ids into the target vocabulary.
+ * Scores are stored as floored log scores, ready for use.
+ *
+ * A source record is
+ *   uint32 source size, uint32 number of targets, uint32 word ids[source size]
+ * followed by the targets, each
+ *   uint32 target size, uint32 alignment size, float scores[numScores],
+ *   uint32 word ids[target size], char alignment[alignment size]
+ * padded to 4 bytes.
+ */
+class PhraseTableMMap
+{
+public:
+  static const uint32_t VERSION = 2;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numScores;
+    uint32_t hasAlignment;
+    uint32_t numSortWeights; //! 0 if the targets are in table order
+    uint64_t numSources, numPairs, sourceVocabSize, targetVocabSize;
+    uint64_t sourceTableOffset, sourceTableBytes;
+    uint64_t sourceVocabOffset, sourceStringsOffset;
+    uint64_t targetVocabOffset; //! uint64 offsets[targetVocabSize + 1] into the strings
+    uint64_t targetStringsOffset;
+    uint64_t sortWeightsOffset;
+    uint64_t fileSize;
+  };
+
+  //! target phrase in the mapped file
+  class Target
+  {
+  public:
+    explicit Target(const char *data, size_t numScores) : m_data(data), m_numScores(numScores) {}
+
+    size_t GetSize() const {
+      return Get32(0);
+    }
+    const float *GetScores() const {
+      return reinterpret_cast<const float*>(m_data + 8);
+    }
+    uint32_t GetWord(size_t pos) const {
+      return reinterpret_cast<const uint32_t*>(m_data + 8 + 4 * m_numScores)[pos];
+    }
+    StringPiece GetAlignment() const {
+      return StringPiece(m_data + 8 + 4 * (m_numScores + GetSize()), Get32(4));
+    }
+    //! the target following this one in the record
+    Target Next() const {
+      return Target(m_data + 8 + 4 * (m_numScores + GetSize()) + ((Get32(4) + 3) & ~3), m_numScores);
+    }
+
+  private:
+    uint32_t Get32(size_t offset) const {
+      return *reinterpret_cast<const uint32_t*>(m_data + offset);
+    }
+
+    const char *m_data;
+    size_t m_numScores;
+  };
+
+  //! source phrase record in the mapped file
+  class Record
+  {
+  public:
+    Record() : m_data(NULL) {}
+    explicit Record(const char *data) : m_data(data) {}
+
+    size_t GetSourceSize() const {
+      return reinterpret_cast<const uint32_t*>(m_data)[0];
+    }
+    size_t GetNumTargets() const {
+      return reinterpret_cast<const uint32_t*>(m_data)[1];
+    }
+    uint32_t GetSourceWord(size_t pos) const {
+      return reinterpret_cast<const uint32_t*>(m_data + 8)[pos];
+    }
+    Target GetFirstTarget(size_t numScores) const {
+      return Target(m_data + 8 + 4 * GetSourceSize(), numScores);
+    }
+
+  private:
+    const char *m_data;
+  };
+
+  PhraseTableMMap() : m_header(NULL) {}
+
+  //! processPhraseTable -mmap appends this to the file name
+  static const char *FileSuffix() {
+    return ".binphr.mmap";
+  }
+
+  /** convert from the text phrase table format, sorted by source phrase.
+   * If sortWeights is not empty, the targets of each source phrase are stored
+   * by descending weighted log score. Returns false on error. */
+  static bool Create(std::istream &in, const std::string &outFile, size_t numScores,
+                     bool alignment, const std::vector<float> &sortWeights);
+
+  //! map the table. Returns false on error
+  bool Load(const std::string &file, util::LoadMethod method = util::LAZY);
+
+  static uint64_t HashWord(const StringPiece &word);
+  static uint64_t HashPhrase(const uint64_t *words, size_t size);
+
+  //! record of the source phrase with the given words, if present
+  bool Find(const std::vector<std::string> &words, Record &out) const;
+  /** the first maxTargets targets (0 for all) of the source phrase with the
+   * given words, as PhraseTableCompact::Find(). Returns false if it is not in
+   * the table. */
+  bool Find(const std::vector<std::string> &words, std::vector<Target> &out, size_t maxTargets = 0) const;
+
+  const Header &GetHeader() const {
+    return *m_header;
+  }
+  StringPiece GetSourceWord(uint32_t id) const;
+  StringPiece GetTargetWord(uint32_t id) const;
+  std::vector<float> GetSortWeights() const;
+
+  /* Building blocks shared with PhraseTableCompact */
+
+  //! write size bytes, advancing offset. Aborts on error
+  static void WriteOrAbort(FILE *out, const void *data, size_t size, uint64_t &offset);
+  static void PadTo(FILE *out, uint64_t &offset, size_t alignment);
+  /** write the hash table from the phrase hashes in sources to their record
+   * offsets. Returns false if a hash is repeated. */
+  static bool WriteSourceTable(FILE *out, uint64_t &offset,
+                               std::vector<std::pair<uint64_t, uint64_t> > &sources,
+                               uint64_t &tableOffset, uint64_t &tableBytes);
+  //! add word to vocab unless it is known. Returns its id
+  static uint32_t AddWord(const std::string &word, std::vector<std::string> &vocab,
+                          boost::unordered_map<std::string, uint32_t> &ids);
+  static void WriteVocab(FILE *out, uint64_t &offset, const std::vector<std::string> &vocab,
+                         uint64_t &vocabOffset, uint64_t &stringsOffset);
+  static StringPiece GetVocabWord(const char *base, uint64_t vocabOffset, uint64_t stringsOffset, uint32_t id);
+
+  //! bucket of the source table: phrase hash to record offset
+  struct SourceEntry {
+    typedef uint64_t Key;
+    uint64_t key;
+    uint64_t offset;
+    Key GetKey() const {
+      return key;
+    }
+  };
+  typedef util::ProbingHashTable<SourceEntry, util::IdentityHash> SourceTable;
+
+private:
+
+  const char *Begin() const {
+    return m_memory.begin();
+  }
+
+  util::scoped_memory m_memory;
+  const Header *m_header;
+  SourceTable m_sourceTable;
+};
+
+}
+
+#endif
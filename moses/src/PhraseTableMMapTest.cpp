@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PhraseTableMMap.h"
+#include "Util.h"
+
+#define BOOST_TEST_MODULE PhraseTableMMapTest
+#include <boost/test/unit_test.hpp>
+
+using namespace Moses;
+
+namespace
+{
+
+const char *TABLE =
+  "das haus ||| the building ||| 0.1 0.2 ||| 0-0 1-1\n"
+  "das haus ||| the house ||| 0.8 0.5 ||| 0-0 1-1\n"
+  "haus ||| house ||| 0.7 0.6 ||| 0-0\n"
+  "haus ||| home ||| 0.3 0.4 ||| 0-0\n";
+
+const char *FILE_NAME = "phrase_table_mmap_test.binphr.mmap";
+
+std::vector<std::string> Words(const std::string &phrase)
+{
+  return Tokenize(phrase);
+}
+
+std::string TargetString(const PhraseTableMMap &table, const PhraseTableMMap::Target &target)
+{
+  std::string ret;
+  for (size_t pos = 0; pos < target.GetSize(); ++pos) {
+    if (pos) ret += " ";
+    const StringPiece word = table.GetTargetWord(target.GetWord(pos));
+    ret.append(word.data(), word.size());
+  }
+  return ret;
+}
+
+struct TableFixture {
+  TableFixture() {
+    std::vector<float> sortWeights(2, 1.0);
+    std::istringstream in(TABLE);
+    BOOST_REQUIRE(PhraseTableMMap::Create(in, FILE_NAME, 2, true, sortWeights));
+    BOOST_REQUIRE(table.Load(FILE_NAME));
+  }
+  ~TableFixture() {
+    std::remove(FILE_NAME);
+  }
+  PhraseTableMMap table;
+};
+
+BOOST_FIXTURE_TEST_CASE(header, TableFixture)
+{
+  const PhraseTableMMap::Header &header = table.GetHeader();
+  BOOST_CHECK_EQUAL(2U, header.numSources);
+  BOOST_CHECK_EQUAL(4U, header.numPairs);
+  BOOST_CHECK_EQUAL(2U, header.sourceVocabSize);
+  BOOST_CHECK_EQUAL(2U, table.GetSortWeights().size());
+}
+
+BOOST_FIXTURE_TEST_CASE(round_trip, TableFixture)
+{
+  PhraseTableMMap::Record record;
+  BOOST_REQUIRE(table.Find(Words("das haus"), record));
+  BOOST_REQUIRE_EQUAL(2U, record.GetSourceSize());
+  BOOST_CHECK_EQUAL("das", table.GetSourceWord(record.GetSourceWord(0)));
+  BOOST_CHECK_EQUAL("haus", table.GetSourceWord(record.GetSourceWord(1)));
+  BOOST_REQUIRE_EQUAL(2U, record.GetNumTargets());
+
+  // sorted by weighted score
+  PhraseTableMMap::Target target = record.GetFirstTarget(2);
+  BOOST_CHECK_EQUAL("the house", TargetString(table, target));
+  BOOST_CHECK_CLOSE(FloorScore(TransformScore(0.8f)), target.GetScores()[0], 0.001);
+  BOOST_CHECK_CLOSE(FloorScore(TransformScore(0.5f)), target.GetScores()[1], 0.001);
+  BOOST_CHECK_EQUAL("0-0 1-1", target.GetAlignment());
+  target = target.Next();
+  BOOST_CHECK_EQUAL("the building", TargetString(table, target));
+
+  BOOST_REQUIRE(table.Find(Words("haus"), record));
+  BOOST_REQUIRE_EQUAL(2U, record.GetNumTargets());
+  target = record.GetFirstTarget(2);
+  BOOST_CHECK_EQUAL("house", TargetString(table, target));
+  BOOST_CHECK_EQUAL("0-0", target.GetAlignment());
+  BOOST_CHECK_EQUAL("home", TargetString(table, target.Next()));
+}
+
+BOOST_FIXTURE_TEST_CASE(unknown_source, TableFixture)
+{
+  PhraseTableMMap::Record record;
+  BOOST_CHECK(!table.Find(Words("das"), record));
+  BOOST_CHECK(!table.Find(Words("haus das"), record));
+  BOOST_CHECK(!table.Find(Words("das haus haus"), record));
+  BOOST_CHECK(!table.Find(Words("hause"), record));
+  BOOST_CHECK(!table.Find(std::vector<std::string>(), record));
+}
+
+}
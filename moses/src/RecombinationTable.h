@@ -0,0 +1,210 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_RecombinationTable_h
+#define moses_RecombinationTable_h
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace Moses
+{
+
+/** Set of hypotheses in which recombinable hypotheses collide.
+ * The hypotheses are kept in a vector, in the order they were inserted, which
+ * is the order they are iterated in. An open addressing table with linear
+ * probing, keyed on Hypo::GetRecombinationHash(), holds their positions;
+ * entries with equal hashes are told apart by Equal. So the order of a stack
+ * does not depend on hash values, some of which come from pointers.
+ * The interface is the subset of std::set the hypothesis stacks use.
+ * Erased entries leave a hole, so erasing does not move other entries and
+ * iterators stay valid until the next insert.
+ */
+template <class Hypo, class Equal>
+class RecombinationTable
+{
+  //! NO_ENTRY marks a slot that never held an entry; it ends probe sequences
+  static const size_t NO_ENTRY = static_cast<size_t>(-1);
+
+  struct Slot {
+    Slot() : entry(NO_ENTRY), hash(0) {}
+    size_t entry; //! position in m_entries. The entry is NULL if erased
+    size_t hash;
+  };
+
+public:
+  class const_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Hypo *value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Hypo * const *pointer;
+    typedef Hypo * const &reference;
+
+    const_iterator() : m_entry(NULL), m_end(NULL) {}
+
+    reference operator*() const {
+      return *m_entry;
+    }
+    pointer operator->() const {
+      return m_entry;
+    }
+    const_iterator &operator++() {
+      ++m_entry;
+      SkipErased();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator ret(*this);
+      ++*this;
+      return ret;
+    }
+    bool operator==(const const_iterator &other) const {
+      return m_entry == other.m_entry;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return m_entry != other.m_entry;
+    }
+
+  private:
+    friend class RecombinationTable;
+
+    const_iterator(Hypo **entry, Hypo **end) : m_entry(entry), m_end(end) {
+      SkipErased();
+    }
+    void SkipErased() {
+      while (m_entry != m_end && *m_entry == NULL)
+        ++m_entry;
+    }
+
+    Hypo **m_entry, **m_end;
+  };
+  //! like those of std::set, iterators do not allow modifying entries
+  typedef const_iterator iterator;
+
+  RecombinationTable() : m_size(0) {}
+
+  const_iterator begin() const {
+    return m_entries.empty() ? const_iterator() : const_iterator(Begin(), End());
+  }
+  const_iterator end() const {
+    return m_entries.empty() ? const_iterator() : const_iterator(End(), End());
+  }
+  size_t size() const {
+    return m_size;
+  }
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  /** add hypo unless an equivalent hypothesis is present.
+   * Returns the position of hypo or of the equivalent hypothesis, and whether
+   * hypo was added. Invalidates iterators. */
+  std::pair<iterator, bool> insert(Hypo *hypo) {
+    if (2 * (m_entries.size() + 1) > m_slots.size())
+      Rehash();
+    const size_t hash = hypo->GetRecombinationHash();
+    const size_t mask = m_slots.size() - 1;
+    Slot *free = NULL;
+    size_t i = hash & mask;
+    for (; m_slots[i].entry != NO_ENTRY; i = (i + 1) & mask) {
+      Slot &slot = m_slots[i];
+      Hypo *other = m_entries[slot.entry];
+      if (other == NULL) {
+        if (free == NULL) free = &slot;
+      } else if (slot.hash == hash && m_equal(other, hypo)) {
+        return std::make_pair(const_iterator(Begin() + slot.entry, End()), false);
+      }
+    }
+    if (free == NULL)
+      free = &m_slots[i];
+    // a reused slot's erased entry stays a hole in m_entries until Rehash()
+    free->entry = m_entries.size();
+    free->hash = hash;
+    m_entries.push_back(hypo);
+    ++m_size;
+    return std::make_pair(const_iterator(End() - 1, End()), true);
+  }
+
+  //! position of the hypothesis equivalent to hypo, or end()
+  const_iterator find(const Hypo *hypo) const {
+    if (m_slots.empty()) return end();
+    const size_t hash = hypo->GetRecombinationHash();
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask; m_slots[i].entry != NO_ENTRY; i = (i + 1) & mask) {
+      const Slot &slot = m_slots[i];
+      const Hypo *other = m_entries[slot.entry];
+      if (other != NULL && slot.hash == hash && m_equal(other, hypo))
+        return const_iterator(Begin() + slot.entry, End());
+    }
+    return end();
+  }
+
+  void erase(const const_iterator &iter) {
+    *iter.m_entry = NULL;
+    --m_size;
+  }
+
+  //! remove all entries, keeping the allocated memory
+  void clear() {
+    std::fill(m_slots.begin(), m_slots.end(), Slot());
+    m_entries.clear();
+    m_size = 0;
+  }
+
+private:
+  Hypo **Begin() const {
+    return const_cast<Hypo**>(&m_entries[0]);
+  }
+  Hypo **End() const {
+    return Begin() + m_entries.size();
+  }
+
+  /** drop the holes of erased entries, keeping the order of the others, and
+   * rebuild the slots, sized for at least one more entry at a load of 1/4 */
+  void Rehash() {
+    m_entries.erase(std::remove(m_entries.begin(), m_entries.end(), static_cast<Hypo*>(NULL)), m_entries.end());
+    size_t capacity = 16;
+    while (capacity < 4 * (m_entries.size() + 1))
+      capacity *= 2;
+    std::vector<Slot>(capacity).swap(m_slots);
+    const size_t mask = capacity - 1;
+    for (size_t j = 0; j < m_entries.size(); ++j) {
+      const size_t hash = m_entries[j]->GetRecombinationHash();
+      size_t i = hash & mask;
+      while (m_slots[i].entry != NO_ENTRY)
+        i = (i + 1) & mask;
+      m_slots[i].entry = j;
+      m_slots[i].hash = hash;
+    }
+  }
+
+  std::vector<Hypo*> m_entries; //! in insertion order, NULL where erased
+  std::vector<Slot> m_slots; //! size is 0 or a power of 2
+  size_t m_size; //! number of entries that are not erased
+  Equal m_equal;
+};
+
+}
+
+#endif
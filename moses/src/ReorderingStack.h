@@ -28,6 +28,10 @@ private:
 public:
 
   int Compare(const ReorderingStack& o) const;
+  size_t Hash() const;
+  bool Equal(const ReorderingStack& o) const {
+    return m_stack == o.m_stack;
+  }
   int ShiftReduce(WordsRange input_span);
 
 private:
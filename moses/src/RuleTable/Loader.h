@@ -36,8 +36,14 @@ class WordPenaltyProducer;
 class RuleTableLoader
 {
  public:
+  RuleTableLoader() : m_numThreads(1) {}
   virtual ~RuleTableLoader() {}
 
+  //! parse the rules on this many threads, if the loader supports it
+  void SetNumThreads(size_t numThreads) {
+    m_numThreads = numThreads;
+  }
+
   virtual bool Load(const std::vector<FactorType> &input,
                     const std::vector<FactorType> &output,
                     std::istream &inStream,
@@ -48,6 +54,8 @@ class RuleTableLoader
                     RuleTableTrie &) = 0;
 
  protected:
+  size_t m_numThreads;
+
   // Provide access to RuleTableTrie's private SortAndPrune function.
   void SortAndPrune(RuleTableTrie &ruleTable) {
     ruleTable.SortAndPrune();
@@ -24,6 +24,7 @@
 #include <iterator>
 #include <algorithm>
 #include <sys/stat.h>
+#include "util/tokenize_piece.hh"
 #include "RuleTable/Trie.h"
 #include "FactorCollection.h"
 #include "Word.h"
@@ -34,6 +35,7 @@
 #include "UserMessage.h"
 #include "ChartTranslationOptionList.h"
 #include "FactorCollection.h"
+#include "ParallelTableLoader.h"
 
 using namespace std;
 
@@ -140,35 +142,84 @@ string *ReformatHieroRule(const string &lineOrig)
   return new string(ret.str());
 }
   
-bool RuleTableLoaderStandard::Load(FormatType format
-                                , const std::vector<FactorType> &input
-                                , const std::vector<FactorType> &output
-                                , std::istream &inStream
-                                , const std::vector<float> &weight
-                                , size_t /* tableLimit */
-                                , const LMList &languageModels
-                                , const WordPenaltyProducer* wpProducer
-                                , RuleTableTrie &ruleTable)
+namespace
 {
-  PrintUserTime("Start loading new format pt model");
-
-  const StaticData &staticData = StaticData::Instance();
-  const std::string& factorDelimiter = staticData.GetFactorDelimiter();
+//! a rule, parsed by a worker thread
+struct ParsedRule {
+  ParsedRule() : sourcePhrase(0), targetPhrase(NULL) {}
+  Phrase sourcePhrase;
+  Word sourceLHS;
+  TargetPhrase *targetPhrase;
+};
+
+class ParsedRules : public ParallelTableLoader::Chunk
+{
+public:
+  ~ParsedRules() {
+    for (size_t i = 0; i < rules.size(); ++i) {
+      delete rules[i]->targetPhrase;
+      delete rules[i];
+    }
+  }
 
+  std::vector<ParsedRule*> rules;
+};
+}
 
-  string lineOrig;
-  size_t count = 0;
+/** Parses chunks of the rule table on worker threads and adds the rules to
+ * the trie in file order */
+class RuleTableLoaderStandard::TableLoader : public ParallelTableLoader
+{
+public:
+  TableLoader(RuleTableLoaderStandard &owner
+              , FormatType format
+              , const std::vector<FactorType> &input
+              , const std::vector<FactorType> &output
+              , const std::vector<float> &weight
+              , const LMList &languageModels
+              , const WordPenaltyProducer* wpProducer
+              , RuleTableTrie &ruleTable)
+    : ParallelTableLoader(owner.m_numThreads)
+    , m_owner(owner), m_format(format), m_input(input), m_output(output), m_weight(weight)
+    , m_languageModels(languageModels), m_wpProducer(wpProducer), m_ruleTable(ruleTable) {}
+
+protected:
+  Chunk *Parse(const std::vector<std::string> &lines, size_t firstLine);
+  void Merge(Chunk *chunk);
+
+  // hiero rules start with the left hand side, so the source phrase is second
+  StringPiece GetSourceKey(const StringPiece &line) const {
+    util::TokenIter<util::MultiCharacter> pipes(line, util::MultiCharacter("|||"));
+    if (m_format == HieroFormat && pipes) ++pipes;
+    return pipes ? *pipes : line;
+  }
 
-  while(getline(inStream, lineOrig)) {
-    const string *line;
-    if (format == HieroFormat) { // reformat line
-      line = ReformatHieroRule(lineOrig);
-    }
-    else
-    { // do nothing to format of line
-      line = &lineOrig;
+private:
+  RuleTableLoaderStandard &m_owner;
+  FormatType m_format;
+  const std::vector<FactorType> &m_input, &m_output;
+  const std::vector<float> &m_weight;
+  const LMList &m_languageModels;
+  const WordPenaltyProducer* m_wpProducer;
+  RuleTableTrie &m_ruleTable;
+};
+
+ParallelTableLoader::Chunk *RuleTableLoaderStandard::TableLoader::Parse(const std::vector<std::string> &lines, size_t firstLine)
+{
+  const StaticData &staticData = StaticData::Instance();
+  const std::string& factorDelimiter = staticData.GetFactorDelimiter();
+  const size_t numScoreComponents = m_ruleTable.GetFeature()->GetNumScoreComponents();
+
+  std::auto_ptr<ParsedRules> chunk(new ParsedRules);
+  for (size_t ind = 0; ind < lines.size(); ++ind) {
+    const size_t count = firstLine + ind;
+    std::auto_ptr<string> reformatted;
+    const string *line = &lines[ind];
+    if (m_format == HieroFormat) { // reformat line
+      reformatted.reset(ReformatHieroRule(lines[ind]));
+      line = reformatted.get();
     }
-    
+
     vector<string> tokens;
     vector<float> scoreVector;
 
@@ -176,7 +227,7 @@ bool RuleTableLoaderStandard::Load(FormatType format
 
     if (tokens.size() != 4 && tokens.size() != 5) {
       stringstream strme;
-      strme << "Syntax error at " << ruleTable.GetFilePath() << ":" << count;
+      strme << "Syntax error at " << m_ruleTable.GetFilePath() << ":" << count;
       UserMessage::Add(strme.str());
       abort();
     }
@@ -188,12 +239,11 @@ bool RuleTableLoaderStandard::Load(FormatType format
 
     bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
     if (isLHSEmpty && !staticData.IsWordDeletionEnabled()) {
-      TRACE_ERR( ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
+      TRACE_ERR( m_ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
       continue;
     }
 
     Tokenize<float>(scoreVector, scoreString);
-    const size_t numScoreComponents = ruleTable.GetFeature()->GetNumScoreComponents();
     if (scoreVector.size() != numScoreComponents) {
       stringstream strme;
       strme << "Size of scoreVector != number (" << scoreVector.size() << "!="
@@ -204,17 +254,19 @@ bool RuleTableLoaderStandard::Load(FormatType format
     CHECK(scoreVector.size() == numScoreComponents);
 
     // parse source & find pt node
+    ParsedRule *rule = new ParsedRule;
+    chunk->rules.push_back(rule);
 
     // constituent labels
-    Word sourceLHS, targetLHS;
+    Word targetLHS;
 
     // source
-    Phrase sourcePhrase( 0);
-    sourcePhrase.CreateFromStringNewFormat(Input, input, sourcePhraseString, factorDelimiter, sourceLHS);
+    rule->sourcePhrase.CreateFromStringNewFormat(Input, m_input, sourcePhraseString, factorDelimiter, rule->sourceLHS);
 
     // create target phrase obj
     TargetPhrase *targetPhrase = new TargetPhrase(Output);
-    targetPhrase->CreateFromStringNewFormat(Output, output, targetPhraseString, factorDelimiter, targetLHS);
+    rule->targetPhrase = targetPhrase;
+    targetPhrase->CreateFromStringNewFormat(Output, m_output, targetPhraseString, factorDelimiter, targetLHS);
 
     // rest of target phrase
     targetPhrase->SetAlignmentInfo(alignString);
@@ -225,21 +277,36 @@ bool RuleTableLoaderStandard::Load(FormatType format
     std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),TransformScore);
     std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),FloorScore);
 
-    targetPhrase->SetScoreChart(ruleTable.GetFeature(), scoreVector, weight, languageModels,wpProducer);
-
-    TargetPhraseCollection &phraseColl = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase, *targetPhrase, sourceLHS);
-    phraseColl.Add(targetPhrase);
+    targetPhrase->SetScoreChart(m_ruleTable.GetFeature(), scoreVector, m_weight, m_languageModels, m_wpProducer);
+  }
+  return chunk.release();
+}
 
-    count++;
+void RuleTableLoaderStandard::TableLoader::Merge(Chunk *parsed)
+{
+  std::auto_ptr<ParsedRules> chunk(static_cast<ParsedRules*>(parsed));
+  for (size_t i = 0; i < chunk->rules.size(); ++i) {
+    ParsedRule &rule = *chunk->rules[i];
+    TargetPhraseCollection &phraseColl = m_owner.GetOrCreateTargetPhraseCollection(m_ruleTable, rule.sourcePhrase, *rule.targetPhrase, rule.sourceLHS);
+    phraseColl.Add(rule.targetPhrase);
+    rule.targetPhrase = NULL;
+  }
+}
 
-    if (format == HieroFormat) { // reformat line
-      delete line;
-    }
-    else
-    { // do nothing
-    }
+bool RuleTableLoaderStandard::Load(FormatType format
+                                , const std::vector<FactorType> &input
+                                , const std::vector<FactorType> &output
+                                , std::istream &inStream
+                                , const std::vector<float> &weight
+                                , size_t /* tableLimit */
+                                , const LMList &languageModels
+                                , const WordPenaltyProducer* wpProducer
+                                , RuleTableTrie &ruleTable)
+{
+  PrintUserTime("Start loading new format pt model");
 
-  }
+  TableLoader loader(*this, format, input, output, weight, languageModels, wpProducer, ruleTable);
+  loader.Load(inStream);
 
   // sort and prune each target phrase collection
   SortAndPrune(ruleTable);
@@ -32,6 +32,9 @@ enum FormatType
 
 class RuleTableLoaderStandard : public RuleTableLoader
 {
+  class TableLoader;
+  friend class TableLoader;
+
 protected:
 
   bool Load(FormatType format,
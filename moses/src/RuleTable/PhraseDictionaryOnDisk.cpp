@@ -32,6 +32,9 @@ namespace Moses
 {
 PhraseDictionaryOnDisk::~PhraseDictionaryOnDisk()
 {
+  const OnDiskPt::PhraseNodeCache &nodeCache = m_dbWrapper.GetNodeCache();
+  VERBOSE(2, "On-disk rule table node cache: " << nodeCache.GetHits() << " hits, "
+          << nodeCache.GetMisses() << " misses" << std::endl);
   CleanUp();
 }
 
@@ -54,8 +57,10 @@ bool PhraseDictionaryOnDisk::Load(const std::vector<FactorType> &input
 
   LoadTargetLookup();
 
-  if (!m_dbWrapper.BeginLoad(filePath))
+  const StaticData &staticData = StaticData::Instance();
+  if (!m_dbWrapper.BeginLoad(filePath, staticData.GetOnDiskMMap()))
     return false;
+  m_dbWrapper.SetNodeCacheSize(staticData.GetOnDiskNodeCacheSize());
 
   CHECK(m_dbWrapper.GetMisc("Version") == 3);
   CHECK(m_dbWrapper.GetMisc("NumSourceFactors") == input.size());
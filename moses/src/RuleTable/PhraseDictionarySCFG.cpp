@@ -33,6 +33,7 @@
 #include "StaticData.h"
 #include "WordsRange.h"
 #include "UserMessage.h"
+#include "ModelSnapshot.h"
 #include "CYKPlusParser/ChartRuleLookupManagerMemory.h"
 
 using namespace std;
@@ -103,6 +104,131 @@ void PhraseDictionarySCFG::SortAndPrune()
   }
 }
 
+void PhraseDictionarySCFG::Snapshot(SnapshotWriter &writer) const
+{
+  SnapshotNode(writer, m_collection);
+}
+
+void PhraseDictionarySCFG::Restore(SnapshotReader &reader,
+                                   const std::vector<float> &weight,
+                                   const LMList &languageModels,
+                                   const WordPenaltyProducer *wpProducer)
+{
+  RestoreNode(reader, m_collection, weight, languageModels, wpProducer);
+}
+
+void PhraseDictionarySCFG::ReportMemoryUsage() const
+{
+  if (StaticData::Instance().GetVerboseLevel() < 1) return;
+  TableMemoryUsage usage;
+  usage.AddNode(sizeof(PhraseDictionaryNodeSCFG));
+  AddMemoryUsage(usage, m_collection);
+  usage.Report(GetFilePath());
+}
+
+void PhraseDictionarySCFG::AddMemoryUsage(TableMemoryUsage &usage,
+                                          const PhraseDictionaryNodeSCFG &node) const
+{
+  if (node.GetTargetPhraseCollection()) {
+    usage.AddCollection(*node.GetTargetPhraseCollection());
+  }
+  // a hash map entry is the key, the node and the links of its bucket
+  for (PhraseDictionaryNodeSCFG::TerminalMap::const_iterator
+       iter = node.m_sourceTermMap.begin();
+       iter != node.m_sourceTermMap.end(); ++iter) {
+    usage.AddNode(sizeof(*iter) + 2 * sizeof(void*));
+    AddMemoryUsage(usage, iter->second);
+  }
+  for (PhraseDictionaryNodeSCFG::NonTerminalMap::const_iterator
+       iter = node.m_nonTermMap.begin();
+       iter != node.m_nonTermMap.end(); ++iter) {
+    usage.AddNode(sizeof(*iter) + 2 * sizeof(void*));
+    AddMemoryUsage(usage, iter->second);
+  }
+}
+
+void PhraseDictionarySCFG::SnapshotNode(SnapshotWriter &writer,
+                                        const PhraseDictionaryNodeSCFG &node) const
+{
+  // rules in their sorted order, 0 if the node has no collection
+  const TargetPhraseCollection *coll = node.GetTargetPhraseCollection();
+  writer.WriteSize(coll ? coll->GetSize() + 1 : 0);
+  if (coll) {
+    for (TargetPhraseCollection::const_iterator iter = coll->begin();
+         iter != coll->end(); ++iter) {
+      const TargetPhrase &targetPhrase = **iter;
+      writer.WritePhrase(targetPhrase);
+      writer.WriteWord(targetPhrase.GetTargetLHS());
+      writer.WriteScores(
+          targetPhrase.GetScoreBreakdown().GetScoresForProducer(GetFeature()));
+      writer.WriteAlignment(targetPhrase.GetAlignmentInfo());
+    }
+  }
+
+  writer.WriteSize(node.m_sourceTermMap.size());
+  for (PhraseDictionaryNodeSCFG::TerminalMap::const_iterator
+       iter = node.m_sourceTermMap.begin();
+       iter != node.m_sourceTermMap.end(); ++iter) {
+    writer.WriteWord(iter->first);
+    SnapshotNode(writer, iter->second);
+  }
+
+  writer.WriteSize(node.m_nonTermMap.size());
+  for (PhraseDictionaryNodeSCFG::NonTerminalMap::const_iterator
+       iter = node.m_nonTermMap.begin();
+       iter != node.m_nonTermMap.end(); ++iter) {
+    writer.WriteWord(iter->first.first);
+    writer.WriteWord(iter->first.second);
+    SnapshotNode(writer, iter->second);
+  }
+}
+
+void PhraseDictionarySCFG::RestoreNode(SnapshotReader &reader,
+                                       PhraseDictionaryNodeSCFG &node,
+                                       const std::vector<float> &weight,
+                                       const LMList &languageModels,
+                                       const WordPenaltyProducer *wpProducer)
+{
+  const size_t collSize = reader.ReadSize();
+  if (collSize > 0) {
+    TargetPhraseCollection &coll = node.GetOrCreateTargetPhraseCollection();
+    std::vector<float> scoreVector;
+    std::set<std::pair<size_t,size_t> > alignmentInfo;
+    for (size_t i = 0; i < collSize - 1; ++i) {
+      TargetPhrase *targetPhrase = new TargetPhrase(Output);
+      reader.ReadPhrase(*targetPhrase);
+      Word targetLHS;
+      reader.ReadWord(targetLHS);
+      reader.ReadScores(scoreVector);
+      alignmentInfo.clear();
+      reader.ReadAlignment(alignmentInfo);
+
+      targetPhrase->SetAlignmentInfo(alignmentInfo);
+      targetPhrase->SetTargetLHS(targetLHS);
+      targetPhrase->SetScoreChart(GetFeature(), scoreVector, weight,
+                                  languageModels, wpProducer);
+      coll.Add(targetPhrase);
+    }
+  }
+
+  const size_t numTerminals = reader.ReadSize();
+  for (size_t i = 0; i < numTerminals; ++i) {
+    Word sourceTerm;
+    reader.ReadWord(sourceTerm);
+    RestoreNode(reader, *node.GetOrCreateChild(sourceTerm), weight,
+                languageModels, wpProducer);
+  }
+
+  const size_t numNonTerminals = reader.ReadSize();
+  for (size_t i = 0; i < numNonTerminals; ++i) {
+    Word sourceNonTerm, targetNonTerm;
+    reader.ReadWord(sourceNonTerm);
+    reader.ReadWord(targetNonTerm);
+    RestoreNode(reader, *node.GetOrCreateChild(sourceNonTerm, targetNonTerm),
+                weight, languageModels, wpProducer);
+  }
+}
+
 TO_STRING_BODY(PhraseDictionarySCFG);
 
 // friend
@@ -59,7 +59,31 @@ class PhraseDictionarySCFG : public RuleTableTrie
 
   void SortAndPrune();
 
+  bool SupportsSnapshot() const { return true; }
+
+  void Snapshot(SnapshotWriter &writer) const;
+
+  void Restore(SnapshotReader &reader,
+               const std::vector<float> &weight,
+               const LMList &languageModels,
+               const WordPenaltyProducer *wpProducer);
+
+  void ReportMemoryUsage() const;
+
   PhraseDictionaryNodeSCFG m_collection;
+
+ private:
+  void SnapshotNode(SnapshotWriter &writer,
+                    const PhraseDictionaryNodeSCFG &node) const;
+
+  void RestoreNode(SnapshotReader &reader,
+                   PhraseDictionaryNodeSCFG &node,
+                   const std::vector<float> &weight,
+                   const LMList &languageModels,
+                   const WordPenaltyProducer *wpProducer);
+
+  void AddMemoryUsage(TableMemoryUsage &usage,
+                      const PhraseDictionaryNodeSCFG &node) const;
 };
 
 }  // namespace Moses
@@ -20,9 +20,12 @@
 #include "RuleTable/Trie.h"
 
 #include "InputFileStream.h"
+#include "ModelSnapshot.h"
 #include "RuleTable/Loader.h"
 #include "RuleTable/LoaderFactory.h"
+#include "StaticData.h"
 #include "Util.h"
+#include "util/check.hh"
 
 namespace Moses
 {
@@ -43,6 +46,27 @@ bool RuleTableTrie::Load(const std::vector<FactorType> &input,
   m_filePath = filePath;
   m_tableLimit = tableLimit;
 
+  // restore the trie from its image if there is one for these settings
+  ModelSnapshot *snapshot = SupportsSnapshot() ? StaticData::Instance().GetModelSnapshot() : NULL;
+  std::ostringstream settings;
+  if (snapshot) {
+    settings << "factors=";
+    ModelSnapshot::AddFactors(settings, input);
+    settings << "/";
+    ModelSnapshot::AddFactors(settings, output);
+    settings << " scores=" << m_numScoreComponent << " table-limit=" << m_tableLimit
+             << " word-deletion=" << StaticData::Instance().IsWordDeletionEnabled() << " ";
+    ModelSnapshot::AddScoreSettings(settings, weight, languageModels);
+
+    SnapshotReader reader;
+    if (snapshot->Open(reader, "rule-table", filePath, settings.str())) {
+      Restore(reader, weight, languageModels, wpProducer);
+      CHECK(reader.AtEnd());
+      ReportMemoryUsage();
+      return true;
+    }
+  }
+
   // data from file
   InputFileStream inFile(filePath);
 
@@ -52,8 +76,20 @@ bool RuleTableTrie::Load(const std::vector<FactorType> &input,
   {
     return false;
   }
+  loader->SetNumThreads(StaticData::Instance().ThreadCount());
   bool ret = loader->Load(input, output, inFile, weight, tableLimit,
                           languageModels, wpProducer, *this);
+
+  if (ret && snapshot) {
+    SnapshotWriter writer;
+    if (snapshot->Create(writer, "rule-table", filePath, settings.str())) {
+      Snapshot(writer);
+      snapshot->Commit(writer);
+    }
+  }
+  if (ret) {
+    ReportMemoryUsage();
+  }
   return ret;
 }
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "PhraseDictionary.h"
+#include "TargetPhraseCollection.h"
 #include "TypeDef.h"
 
 #include <string>
@@ -30,6 +31,8 @@ namespace Moses
 
 class LMList;
 class Phrase;
+class SnapshotReader;
+class SnapshotWriter;
 class TargetPhrase;
 class TargetPhraseCollection;
 class Word;
@@ -77,6 +80,17 @@ class RuleTableTrie : public PhraseDictionary
 
   virtual void SortAndPrune() = 0;
 
+  //! whether the trie can be written to and restored from a model image
+  virtual bool SupportsSnapshot() const { return false; }
+
+  virtual void Snapshot(SnapshotWriter &) const {}
+
+  virtual void Restore(SnapshotReader &, const std::vector<float> &,
+                       const LMList &, const WordPenaltyProducer *) {}
+
+  //! the nodes and target phrases of the loaded table, at verbosity 1
+  virtual void ReportMemoryUsage() const {}
+
   std::string m_filePath;
 };
 
@@ -1,11 +1,126 @@
+#include <cstdlib>
 #include "Manager.h"
+#include "MemoryArena.h"
 #include "Timer.h"
 #include "SearchNormal.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include "ThreadPool.h"
+#endif
+
 using namespace std;
 
 namespace Moses
 {
+
+namespace
+{
+// how many translation options ahead of the one being expanded are
+// announced to the stateful feature functions for prefetching
+const size_t PREFETCH_AHEAD = 2;
+const bool s_nopf = getenv("NOPF") != NULL, s_pfall = getenv("PFALL") != NULL;
+
+#ifdef WITH_THREADS
+// search workers of each decoding thread. They are kept for all stacks and
+// sentences, so thread local state of features, such as LM query caches and
+// connections to LM servers, is not thrown away after every stack
+boost::thread_specific_ptr<ThreadPool> s_searchWorkers;
+
+// the search a worker thread has set up its feature state for, if any
+void KeepSearch(SearchNormal *) {}
+boost::thread_specific_ptr<SearchNormal> s_workerSearch(KeepSearch);
+
+//! lets a thread wait until a number of tasks have finished
+class TaskLatch
+{
+public:
+  explicit TaskLatch(size_t count) : m_count(count) {}
+
+  void CountDown() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (--m_count == 0) m_done.notify_all();
+  }
+
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_count) m_done.wait(lock);
+  }
+
+private:
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+  size_t m_count;
+};
+
+ThreadPool &GetSearchWorkers()
+{
+  ThreadPool *workers = s_searchWorkers.get();
+  if (workers == NULL) {
+    // the decoding thread is the first search thread
+    workers = new ThreadPool(StaticData::Instance().SearchThreadCount() - 1);
+    s_searchWorkers.reset(workers);
+  }
+  return *workers;
+}
+#endif
+}
+
+#ifdef WITH_THREADS
+//! expands one shard of a stack in a search worker
+class SearchNormal::ShardTask : public Task
+{
+public:
+  ShardTask(SearchNormal &search, const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end
+            , Shard &shard, TaskLatch &done)
+    : m_search(search), m_hypos(hypos), m_begin(begin), m_end(end)
+    , m_shard(shard), m_done(done) {}
+
+  void Run() {
+    if (s_workerSearch.get() != &m_search) {
+      // first shard of this sentence in this worker
+      m_search.m_manager.GetTranslationSystem()->InitializeSearchThread(m_search.m_source);
+      s_workerSearch.reset(&m_search);
+    }
+    m_search.ProcessShard(m_hypos, m_begin, m_end, m_shard);
+    m_done.CountDown();
+  }
+
+private:
+  SearchNormal &m_search;
+  const std::vector<const Hypothesis*> &m_hypos;
+  size_t m_begin, m_end;
+  Shard &m_shard;
+  TaskLatch &m_done;
+};
+
+//! drops the feature state a search worker kept for the sentence.
+//! Each task holds its worker until all have run, so every worker runs one.
+class SearchNormal::CleanUpTask : public Task
+{
+public:
+  CleanUpTask(const SearchNormal &search, boost::barrier &allWorkers, TaskLatch &done)
+    : m_search(search), m_allWorkers(allWorkers), m_done(done) {}
+
+  void Run() {
+    if (s_workerSearch.get() == &m_search) {
+      m_search.m_manager.GetTranslationSystem()->CleanUpSearchThread();
+      s_workerSearch.reset(NULL);
+    }
+    m_allWorkers.wait();
+    m_done.CountDown();
+  }
+
+private:
+  const SearchNormal &m_search;
+  boost::barrier &m_allWorkers;
+  TaskLatch &m_done;
+};
+#endif
+
 /**
  * Organizing main function
  *
@@ -20,6 +135,7 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
   ,m_start(clock())
   ,interrupted_flag(0)
   ,m_transOptColl(transOptColl)
+  ,m_workersUsed(false)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
   const StaticData &staticData = StaticData::Instance();
@@ -44,11 +160,22 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
 
     m_hypoStackColl[ind] = sourceHypoColl;
   }
+
+  // intra-sentence parallel expansion; each thread needs its own arena.
+  // StaticData has checked that the features allow it
+  if (staticData.SearchThreadCount() > 1) {
+    for (size_t i = 0 ; i < staticData.SearchThreadCount() ; ++i) {
+      m_workerArenas.push_back(new MemoryArena());
+    }
+  }
 }
 
 SearchNormal::~SearchNormal()
 {
+  ReleaseWorkers();
   RemoveAllInColl(m_hypoStackColl);
+  // after the stacks: hypotheses built by worker threads live in these
+  RemoveAllInColl(m_workerArenas);
 }
 
 /**
@@ -90,10 +217,14 @@ void SearchNormal::ProcessSentence()
     }
 
     // go through each hypothesis on the stack and try to expand it
-    HypothesisStackNormal::const_iterator iterHypo;
-    for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
-      Hypothesis &hypothesis = **iterHypo;
-      ProcessOneHypothesis(hypothesis); // expand the hypothesis
+    if (m_workerArenas.size() > 1 && sourceHypoColl.size() >= m_workerArenas.size()) {
+      ProcessStackInParallel(sourceHypoColl);
+    } else {
+      HypothesisStackNormal::const_iterator iterHypo;
+      for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
+        Hypothesis &hypothesis = **iterHypo;
+        ProcessOneHypothesis(hypothesis); // expand the hypothesis
+      }
     }
     // some logging
     IFVERBOSE(2) {
@@ -116,8 +247,9 @@ void SearchNormal::ProcessSentence()
  * this is mostly a check for overlap with already covered words, and for
  * violation of reordering limits.
  * \param hypothesis hypothesis to be expanded upon
+ * \param shard if not NULL, build new hypotheses for this shard instead of adding them to the stacks
  */
-void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
+void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis, Shard *shard)
 {
   // since we check for reordering limits, its good to have that limit handy
   int maxDistortion = StaticData::Instance().GetMaxDistortion();
@@ -125,7 +257,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
   // no limit of reordering: only check for overlap
   if (maxDistortion < 0) {
-    const WordsBitmap hypoBitmap	= hypothesis.GetWordsBitmap();
+    const WordsBitmap &hypoBitmap	= hypothesis.GetWordsBitmap();
     const size_t hypoFirstGapPos	= hypoBitmap.GetFirstGapPos()
                                     , sourceSize			= m_source.GetSize();
 
@@ -146,7 +278,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
         }
 
         //TODO: does this method include incompatible WordLattice hypotheses?
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, shard);
       }
     }
 
@@ -155,7 +287,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
   // if there are reordering limits, make sure it is not violated
   // the coverage bitmap is handy here (and the position of the first gap)
-  const WordsBitmap hypoBitmap = hypothesis.GetWordsBitmap();
+  const WordsBitmap &hypoBitmap = hypothesis.GetWordsBitmap();
   const size_t	hypoFirstGapPos	= hypoBitmap.GetFirstGapPos()
                                   , sourceSize			= m_source.GetSize();
 
@@ -220,7 +352,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
       // any length extension is okay if starting at left-most edge
       if (leftMostEdge) {
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, shard);
       }
       // starting somewhere other than left-most edge, use caution
       else {
@@ -240,7 +372,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
         }
 
         // everything is fine, we're good to go
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, shard);
 
       }
     }
@@ -253,9 +385,10 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
  * \param hypothesis hypothesis to be expanded upon
  * \param startPos first word position of span covered
  * \param endPos last word position of span covered
+ * \param shard if not NULL, build new hypotheses for this shard instead of adding them to the stacks
  */
 
-void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos)
+void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos, Shard *shard)
 {
   // early discarding: check if hypothesis is too bad to build
   // this idea is explained in (Moore&Quirk, MT Summit 2007)
@@ -268,11 +401,27 @@ void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t star
     expectedScore += m_transOptColl.GetFutureScore().CalcFutureScore( hypothesis.GetWordsBitmap(), startPos, endPos );
   }
 
-  // loop through all translation options
+  // loop through all translation options, letting stateful features
+  // prefetch for the option PREFETCH_AHEAD places ahead of the one expanded.
+  // Options that the first early discarding check would drop are never
+  // scored, so nothing is prefetched for them. Search workers do not read
+  // the stacks and score every option
   const TranslationOptionList &transOptList = m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
-  TranslationOptionList::const_iterator iter;
-  for (iter = transOptList.begin() ; iter != transOptList.end() ; ++iter) {
-    ExpandHypothesis(hypothesis, **iter, expectedScore);
+  const std::vector<const StatefulFeatureFunction*> &ffs = m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
+  const bool discardBeforePrefetch = StaticData::Instance().UseEarlyDiscarding() && shard == NULL;
+  const size_t numOptions = transOptList.size();
+  for (size_t ind = 0; ind < numOptions + PREFETCH_AHEAD; ++ind) {
+    if (ind < numOptions && !s_nopf) {
+      const TranslationOption &transOpt = *transOptList.Get(ind);
+      if (!discardBeforePrefetch || s_pfall || expectedScore + transOpt.GetFutureScore() >= GetAllowedScore(hypothesis, transOpt)) {
+        for (size_t i = 0; i < ffs.size(); ++i) {
+          ffs[i]->Prefetch(hypothesis.GetFFState(i), transOpt.GetTargetPhrase());
+        }
+      }
+    }
+    if (ind >= PREFETCH_AHEAD) {
+      ExpandHypothesis(hypothesis, *transOptList.Get(ind - PREFETCH_AHEAD), expectedScore, shard);
+    }
   }
 }
 
@@ -284,9 +433,15 @@ void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t star
  *        that is applied to create the new hypothesis
  * \param expectedScore base score for early discarding
  *        (base hypothesis score plus future score estimation)
+ * \param shard if not NULL, build the new hypothesis for this shard instead of adding it to its stack
  */
-void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt, float expectedScore)
+void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt, float expectedScore, Shard *shard)
 {
+  if (shard) {
+    BuildExpansion(hypothesis, transOpt, expectedScore, *shard);
+    return;
+  }
+
   const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
   clock_t t=0; // used to track time for steps
@@ -307,14 +462,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
     // early discarding: check if hypothesis is too bad to build
   {
     // worst possible score may have changed -> recompute
-    size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
-    float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
-    if (staticData.GetMinHypoStackDiversity()) {
-      WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
-      float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
-      allowedScore = std::min( allowedScore, allowedScoreForBitmap );
-    }
-    allowedScore += staticData.GetEarlyDiscardingThreshold();
+    float allowedScore = GetAllowedScore(hypothesis, transOpt);
 
     // add expected score of translation option
     expectedScore += transOpt.GetFutureScore();
@@ -370,6 +518,157 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
   }
 }
 
+/**
+ * Lowest score a hypothesis built from hypothesis and transOpt may have
+ * to survive early discarding, given the stacks as they are now
+ */
+float SearchNormal::GetAllowedScore(const Hypothesis &hypothesis, const TranslationOption &transOpt) const
+{
+  const StaticData &staticData = StaticData::Instance();
+  size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
+  float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
+  if (staticData.GetMinHypoStackDiversity()) {
+    WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
+    float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
+    allowedScore = std::min( allowedScore, allowedScoreForBitmap );
+  }
+  return allowedScore + staticData.GetEarlyDiscardingThreshold();
+}
+
+/**
+ * Expand all hypotheses of a stack with several threads (-search-threads).
+ * The stack is cut into one contiguous shard per thread. Each thread builds
+ * and scores the new hypotheses of its shard in its own arena, without
+ * touching the stacks. The results are then added to the stacks in the order
+ * the serial search would have built them, applying early discarding
+ * against the stacks as they fill up, so the search space is identical.
+ */
+void SearchNormal::ProcessStackInParallel(const HypothesisStackNormal &sourceHypoColl)
+{
+#ifdef WITH_THREADS
+  const std::vector<const Hypothesis*> hypos(sourceHypoColl.begin(), sourceHypoColl.end());
+  const size_t numShards = m_workerArenas.size();
+  std::vector<Shard> shards(numShards);
+  for (size_t shard = 0 ; shard < numShards ; ++shard) {
+    shards[shard].arena = m_workerArenas[shard];
+  }
+
+  ThreadPool &workers = GetSearchWorkers();
+  TaskLatch done(numShards - 1);
+  m_workersUsed = true;
+  for (size_t shard = 1 ; shard < numShards ; ++shard) {
+    workers.Submit(new ShardTask(*this, hypos
+                                 , hypos.size() * shard / numShards
+                                 , hypos.size() * (shard + 1) / numShards
+                                 , shards[shard], done));
+  }
+  // the decoding thread takes the first shard itself
+  ProcessShard(hypos, 0, hypos.size() / numShards, shards[0]);
+  done.Wait();
+
+  for (size_t shard = 0 ; shard < numShards ; ++shard) {
+    const ExpansionList &expansions = shards[shard].expansions;
+    for (ExpansionList::const_iterator iter = expansions.begin() ; iter != expansions.end() ; ++iter) {
+      AddExpansion(*iter);
+    }
+  }
+#else
+  CHECK(!"parallel search requires thread support");
+#endif
+}
+
+/**
+ * Expand hypos[begin, end) as a search worker, collecting new hypotheses in the shard
+ */
+void SearchNormal::ProcessShard(const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end, Shard &shard)
+{
+  for (size_t i = begin ; i < end ; ++i) {
+    ProcessOneHypothesis(*hypos[i], &shard);
+  }
+}
+
+/**
+ * Let the search workers drop what they kept for this sentence, before the
+ * sentence stats and the hypotheses go away
+ */
+void SearchNormal::ReleaseWorkers()
+{
+#ifdef WITH_THREADS
+  if (!m_workersUsed) return;
+  const size_t numWorkers = StaticData::Instance().SearchThreadCount() - 1;
+  boost::barrier allWorkers(numWorkers);
+  TaskLatch done(numWorkers);
+  ThreadPool &workers = GetSearchWorkers();
+  for (size_t i = 0 ; i < numWorkers ; ++i) {
+    workers.Submit(new CleanUpTask(*this, allWorkers, done));
+  }
+  done.Wait();
+  m_workersUsed = false;
+#endif
+}
+
+/**
+ * Build and score one hypothesis in a search worker. Early discarding
+ * depends on how the stacks have been filled by hypotheses expanded earlier,
+ * so it is decided by AddExpansion(); here we only record the estimates.
+ */
+void SearchNormal::BuildExpansion(const Hypothesis &hypothesis, const TranslationOption &transOpt, float expectedScore, Shard &shard)
+{
+  Expansion expansion;
+  expansion.hypo = hypothesis.CreateNext(transOpt, m_constraint, shard.arena);
+  if (expansion.hypo == NULL) return;
+
+  if (! StaticData::Instance().UseEarlyDiscarding()) {
+    expansion.hypo->CalcScore(m_transOptColl.GetFutureScore());
+    expansion.optionExpectedScore = expansion.builtExpectedScore = 0.0f;
+  } else {
+    expansion.optionExpectedScore = expectedScore + transOpt.GetFutureScore();
+    expansion.builtExpectedScore = expansion.hypo->CalcExpectedScore( m_transOptColl.GetFutureScore() );
+    expansion.hypo->CalcRemainingScore();
+  }
+  shard.expansions.push_back(expansion);
+}
+
+/**
+ * Add a hypothesis built by a search worker to its stack, doing the early
+ * discarding checks of ExpandHypothesis() against the current stacks
+ */
+void SearchNormal::AddExpansion(const Expansion &expansion)
+{
+  Hypothesis *newHypo = expansion.hypo;
+  SentenceStats &stats = m_manager.GetSentenceStats();
+
+  if (StaticData::Instance().UseEarlyDiscarding()) {
+    float allowedScore = GetAllowedScore(*newHypo->GetPrevHypo(), newHypo->GetTranslationOption());
+    if (expansion.optionExpectedScore < allowedScore) {
+      // the serial search would not have built this hypothesis at all
+      IFVERBOSE(2) {
+        stats.AddNotBuilt();
+      }
+      FREEHYPO( newHypo );
+      return;
+    }
+    newHypo->Register();
+    if (expansion.builtExpectedScore < allowedScore) {
+      IFVERBOSE(2) {
+        stats.AddEarlyDiscarded();
+      }
+      FREEHYPO( newHypo );
+      return;
+    }
+  } else {
+    newHypo->Register();
+  }
+
+  // logging for the curious
+  IFVERBOSE(3) {
+    newHypo->PrintHypothesis();
+  }
+
+  size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
+  m_hypoStackColl[wordsTranslated]->AddPrune(newHypo);
+}
+
 const std::vector < HypothesisStack* >& SearchNormal::GetHypothesisStacks() const
 {
   return m_hypoStackColl;
@@ -12,6 +12,7 @@ namespace Moses
 
 class Manager;
 class InputType;
+class MemoryArena;
 class TranslationOptionCollection;
 
 class SearchNormal: public Search
@@ -26,10 +27,38 @@ protected:
   HypothesisStackNormal* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
 
+  /** hypothesis built by a search worker thread. It is added to its stack
+   * afterwards, in the order the serial search would have built it */
+  struct Expansion {
+    Hypothesis *hypo;
+    float optionExpectedScore; /**< early discarding estimate before building the hypothesis */
+    float builtExpectedScore; /**< early discarding estimate of the built hypothesis (all but LM) */
+  };
+  typedef std::vector<Expansion> ExpansionList;
+
+  //! the part of a stack one search thread expands
+  struct Shard {
+    MemoryArena *arena; /**< holds the hypotheses built for the shard and their states */
+    ExpansionList expansions; /**< the new hypotheses, in the order they were built */
+  };
+
+  std::vector<MemoryArena*> m_workerArenas; /**< one per search thread, see -search-threads */
+  bool m_workersUsed; /**< whether worker threads have expanded hypotheses of this sentence */
+
   // functions for creating hypotheses
-  void ProcessOneHypothesis(const Hypothesis &hypothesis);
-  void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
-  void ExpandHypothesis(const Hypothesis &hypothesis,const TranslationOption &transOpt, float expectedScore);
+  void ProcessOneHypothesis(const Hypothesis &hypothesis, Shard *shard = NULL);
+  void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos, Shard *shard);
+  void ExpandHypothesis(const Hypothesis &hypothesis,const TranslationOption &transOpt, float expectedScore, Shard *shard);
+  float GetAllowedScore(const Hypothesis &hypothesis, const TranslationOption &transOpt) const;
+
+  // expansion of one stack by several threads
+  void ProcessStackInParallel(const HypothesisStackNormal &sourceHypoColl);
+  void ProcessShard(const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end, Shard &shard);
+  void ReleaseWorkers();
+  class ShardTask;
+  class CleanUpTask;
+  void BuildExpansion(const Hypothesis &hypothesis, const TranslationOption &transOpt, float expectedScore, Shard &shard);
+  void AddExpansion(const Expansion &expansion);
 
 public:
   SearchNormal(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl);
@@ -32,6 +32,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputType.h"
 #include "Util.h" //Join()
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -63,6 +67,8 @@ public:
     m_numHyposDiscarded = 0;
     m_numHyposEarlyDiscarded = 0;
     m_numHyposNotBuilt = 0;
+    m_numLMCacheHits = 0;
+    m_numLMCacheLookups = 0;
     m_timeCollectOpts = 0;
     m_timeBuildHyp = 0;
     m_timeEstimateScore = 0;
@@ -98,6 +104,12 @@ public:
   unsigned int GetNumHyposNotBuilt() const {
     return m_numHyposNotBuilt;
   }
+  size_t GetNumLMCacheHits() const {
+    return m_numLMCacheHits;
+  }
+  size_t GetNumLMCacheLookups() const {
+    return m_numLMCacheLookups;
+  }
   float GetTimeCollectOpts() const {
     return m_timeCollectOpts/(float)CLOCKS_PER_SEC;
   }
@@ -154,6 +166,14 @@ public:
   void AddDiscarded() {
     m_numHyposDiscarded++;
   }
+  //! called by the LM query caches of all search threads
+  void AddLMCacheLookups(size_t hits, size_t lookups) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_lmCacheMutex);
+#endif
+    m_numLMCacheHits += hits;
+    m_numLMCacheLookups += lookups;
+  }
 
   void AddTimeCollectOpts( clock_t t ) {
     m_timeCollectOpts += t;
@@ -191,6 +211,11 @@ protected:
   unsigned int m_numHyposDiscarded;
   unsigned int m_numHyposEarlyDiscarded;
   unsigned int m_numHyposNotBuilt;
+  size_t m_numLMCacheHits;
+  size_t m_numLMCacheLookups;
+#ifdef WITH_THREADS
+  boost::mutex m_lmCacheMutex;
+#endif
   clock_t m_timeCollectOpts;
   clock_t m_timeBuildHyp;
   clock_t m_timeEstimateScore;
@@ -21,6 +21,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <string>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include "util/check.hh"
 #include "PhraseDictionaryMemory.h"
 #include "DecodeStepTranslation.h"
@@ -28,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "GenerationDictionary.h"
 #include "DummyScoreProducers.h"
 #include "StaticData.h"
+#include "InputFilter.h"
+#include "ModelSnapshot.h"
 #include "Util.h"
 #include "FactorCollection.h"
 #include "Timer.h"
@@ -83,6 +88,8 @@ StaticData::StaticData()
   ,m_onlyDistinctNBest(false)
   ,m_factorDelimiter("|") // default delimiter between factors
   ,m_lmEnableOOVFeature(false)
+  ,m_inputFilter(NULL)
+  ,m_modelSnapshot(NULL)
   ,m_isAlwaysCreateDirectTranslationOption(false)
 {
   m_maxFactorIdx[0] = 0;  // source side
@@ -251,12 +258,23 @@ bool StaticData::LoadData(Parameter *parameter)
   //
   if (m_inputType == SentenceInput) {
     SetBooleanParameter( &m_useTransOptCache, "use-persistent-cache", true );
-    m_transOptCacheMaxSize = (m_parameter->GetParam("persistent-cache-size").size() > 0)
-                             ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE;
+    // bounded by memory, and by number of input phrases if asked for
+    const size_t maxMemory = (m_parameter->GetParam("persistent-cache-memory").size() > 0)
+                             ? Scan<size_t>(m_parameter->GetParam("persistent-cache-memory")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_MEMORY;
+    const size_t maxEntries = (m_parameter->GetParam("persistent-cache-size").size() > 0)
+                              ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : std::numeric_limits<size_t>::max();
+    m_transOptCache.SetMaxSize(maxMemory * 1024 * 1024, maxEntries);
   } else {
     m_useTransOptCache = false;
   }
 
+  // on-disk rule tables
+  SetBooleanParameter( &m_onDiskMMap, "ondisk-mmap", false );
+  m_onDiskNodeCacheSize = (m_parameter->GetParam("ondisk-node-cache").size() > 0)
+                          ? Scan<size_t>(m_parameter->GetParam("ondisk-node-cache")[0]) : DEFAULT_ONDISK_NODE_CACHE_SIZE;
+  m_prefetchBatchSize = (m_parameter->GetParam("prefetch-batch").size() > 0)
+                        ? Scan<size_t>(m_parameter->GetParam("prefetch-batch")[0]) : 0;
+
 
   //input factors
   const vector<string> &inputFactorVector = m_parameter->GetParam("input-factors");
@@ -407,6 +425,8 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_lmcache_cleanup_threshold = (m_parameter->GetParam("clean-lm-cache").size() > 0) ?
                                 Scan<size_t>(m_parameter->GetParam("clean-lm-cache")[0]) : 1;
+  m_lmQueryCacheSize = (m_parameter->GetParam("lm-query-cache").size() > 0) ?
+                       Scan<size_t>(m_parameter->GetParam("lm-query-cache")[0]) : 0;
 
   m_threadCount = 1;
   const std::vector<std::string> &threadInfo = m_parameter->GetParam("threads");
@@ -437,6 +457,23 @@ bool StaticData::LoadData(Parameter *parameter)
     }
   }
 
+  m_threadQueueSize = (m_parameter->GetParam("thread-queue-size").size() > 0) ?
+                      Scan<size_t>(m_parameter->GetParam("thread-queue-size")[0]) : 10 * m_threadCount;
+  SetBooleanParameter( &m_pinThreads, "pin-threads", false );
+
+  m_searchThreadCount = (m_parameter->GetParam("search-threads").size() > 0) ?
+                        Scan<size_t>(m_parameter->GetParam("search-threads")[0]) : 1;
+  if (m_searchThreadCount < 1) {
+    UserMessage::Add("Specify at least one search thread.");
+    return false;
+  }
+#ifndef WITH_THREADS
+  if (m_searchThreadCount > 1) {
+    UserMessage::Add("Error: -search-threads specified but moses not built with thread support");
+    return false;
+  }
+#endif
+
   m_startTranslationId = (m_parameter->GetParam("start-translation-id").size() > 0) ?
           Scan<long>(m_parameter->GetParam("start-translation-id")[0]) : 0;
 
@@ -502,6 +539,14 @@ bool StaticData::LoadData(Parameter *parameter)
 	}
 #endif
 	
+  // index the input to filter the text models by
+  if (m_parameter->isParamSpecified("filter-by-input")) {
+    if (!LoadInputFilter()) return false;
+  }
+  if (m_parameter->GetParam("model-snapshot").size() > 0) {
+    if (!LoadModelSnapshot()) return false;
+  }
+
   if (!LoadLexicalReorderingModel()) return false;
   if (!LoadLanguageModels()) return false;
   if (!LoadGenerationTables()) return false;
@@ -600,6 +645,35 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_scoreIndexManager.InitFeatureNames();
 
+  // stacks are only expanded in parallel if all features evaluated during search allow it
+  if (m_searchThreadCount > 1 && m_verboseLevel >= 2) {
+    TRACE_ERR("WARNING: -search-threads is ignored with -v 2 and up, the search statistics are not thread safe" << endl);
+    m_searchThreadCount = 1;
+  }
+  for (map<string, TranslationSystem>::const_iterator iterSystem = m_translationSystems.begin();
+       m_searchThreadCount > 1 && iterSystem != m_translationSystems.end(); ++iterSystem) {
+    const FeatureFunction *unsafe = iterSystem->second.GetSearchThreadUnsafeFeature();
+    if (unsafe) {
+      TRACE_ERR("WARNING: -search-threads is ignored, " << unsafe->GetScoreProducerDescription()
+                << " can not be evaluated by several threads at once" << endl);
+      m_searchThreadCount = 1;
+    }
+  }
+
+  // all text models are loaded now
+  if (m_inputFilter) {
+    VERBOSE(1, "Filtering by input kept " << m_inputFilter->GetKept() << " and skipped "
+            << m_inputFilter->GetSkipped() << " source phrases" << endl);
+    delete m_inputFilter;
+    m_inputFilter = NULL;
+  }
+  if (m_modelSnapshot) {
+    VERBOSE(1, "Restored " << m_modelSnapshot->GetRestored() << " models from and wrote "
+            << m_modelSnapshot->GetWritten() << " model images to " << m_modelSnapshot->GetDirectory() << endl);
+    delete m_modelSnapshot;
+    m_modelSnapshot = NULL;
+  }
+
   return true;
 }
 
@@ -645,6 +719,9 @@ StaticData::~StaticData()
   // small score producers
   delete m_unknownWordPenaltyProducer;
 
+  delete m_inputFilter;
+  delete m_modelSnapshot;
+
   //delete m_parameter;
 
   // memory pools
@@ -707,6 +784,43 @@ StaticData::~StaticData()
   }
 #endif
 
+bool StaticData::LoadInputFilter()
+{
+  const vector<string> &filterFile = m_parameter->GetParam("filter-by-input");
+  string filePath;
+  if (filterFile.size() > 0) {
+    filePath = filterFile[0];
+  } else if (m_parameter->GetParam("input-file").size() > 0) {
+    filePath = m_parameter->GetParam("input-file")[0];
+  } else {
+    UserMessage::Add("filter-by-input needs a file, or the input to be read with input-file");
+    return false;
+  }
+  if (m_inputType != SentenceInput) {
+    TRACE_ERR("WARNING: filter-by-input only works with sentence input, the models are not filtered" << endl);
+    return true;
+  }
+
+  m_inputFilter = new InputFilter(m_inputFactorOrder, m_maxPhraseLength);
+  if (!m_inputFilter->Load(filePath))
+    return false;
+  VERBOSE(1, "Filtering the models by the " << m_inputFilter->GetNumSentences()
+          << " sentences of " << filePath << endl);
+  return true;
+}
+
+bool StaticData::LoadModelSnapshot()
+{
+  const string &dir = m_parameter->GetParam("model-snapshot")[0];
+  if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+    UserMessage::Add("Cannot create the model image directory " + dir);
+    return false;
+  }
+  m_modelSnapshot = new ModelSnapshot(dir);
+  VERBOSE(1, "Restoring the text models from and writing their images to " << dir << endl);
+  return true;
+}
+
 bool StaticData::LoadLexicalReorderingModel()
 {
   VERBOSE(1, "Loading lexical distortion models...");
@@ -1000,6 +1114,13 @@ bool StaticData::LoadPhraseTables()
       m_maxNumFactors = std::max(m_maxFactorIdx[0], m_maxFactorIdx[1]) + 1;
       size_t numScoreComponent = Scan<size_t>(token[3]);
       string filePath= token[4];
+      if (m_maxNumFactors > MAX_NUM_FACTORS) {
+        stringstream strme;
+        strme << "Phrase table " << filePath << " uses factor " << (m_maxNumFactors - 1)
+              << ", but this build only supports " << MAX_NUM_FACTORS << " factors (see --max-factors)";
+        UserMessage::Add(strme.str());
+        return false;
+      }
 
       CHECK(weightAll.size() >= weightAllOffset + numScoreComponent);
 
@@ -1276,66 +1397,19 @@ void StaticData::SetWeightsForScoreProducer(const ScoreProducer* sp, const std::
     m_allWeights[i] = *weightIter++;
 }
 
-const TranslationOptionList* StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
+TranslationOptionCache::ListPtr StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
 {
-  std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter
-  = m_transOptCache.find(key);
-  if (iter == m_transOptCache.end())
-    return NULL;
-  iter->second.second = clock(); // update last used time
-  return iter->second.first;
+  return m_transOptCache.Find(decodeGraph.GetPosition(), sourcePhrase);
 }
 
-void StaticData::ReduceTransOptCache() const
+void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
 {
-  if (m_transOptCache.size() <= m_transOptCacheMaxSize) return; // not full
-  clock_t t = clock();
-
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter;
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
-  }
-  for( size_t i=0; i < lastUsedTimes.size()-m_transOptCacheMaxSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
-
-  // remove all old entries
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    if (iter->second.second < cutoffLastUsedTime) {
-      std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iterRemove = iter++;
-      delete iterRemove->second.first;
-      m_transOptCache.erase(iterRemove);
-    } else iter++;
-  }
-  VERBOSE(2,"Reduced persistent translation option cache in " << ((clock()-t)/(float)CLOCKS_PER_SEC) << " seconds." << std::endl);
+  m_transOptCache.Add(decodeGraph.GetPosition(), sourcePhrase, transOptList);
 }
 
-void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
+void StaticData::ClearTransOptionCache() const
 {
-  if (m_transOptCacheMaxSize == 0) return;
-  std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-  TranslationOptionList* storedTransOptList = new TranslationOptionList(transOptList);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  m_transOptCache[key] = make_pair( storedTransOptList, clock() );
-  ReduceTransOptCache();
-}
-void StaticData::ClearTransOptionCache() const {
-  map<std::pair<size_t, Phrase>, std::pair< TranslationOptionList*, clock_t > >::iterator iterCache;
-  for (iterCache = m_transOptCache.begin() ; iterCache != m_transOptCache.end() ; ++iterCache) {
-    TranslationOptionList *transOptList = iterCache->second.first;
-    delete transOptList;
-  }
+  m_transOptCache.Clear();
 }
 
 }
@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "SentenceStats.h"
 #include "DecodeGraph.h"
 #include "TranslationOptionList.h"
+#include "TranslationOptionCache.h"
 #include "TranslationSystem.h"
 
 namespace Moses
@@ -58,6 +59,8 @@ class GenerationDictionary;
 class DistortionScoreProducer;
 class DecodeStep;
 class UnknownWordPenaltyProducer;
+class InputFilter;
+class ModelSnapshot;
 #ifdef HAVE_SYNLM
 class SyntacticLanguageModel;
 #endif
@@ -169,19 +172,19 @@ protected:
   float m_lmbrMapWeight; //! Weight given to the map solution. See Kumar et al 09 for details
 
   size_t m_lmcache_cleanup_threshold; //! number of translations after which LM claenup is performed (0=never, N=after N translations; default is 1)
+  size_t m_lmQueryCacheSize; //! LM evaluations memoized per sentence and search thread, 0 for none
   bool m_lmEnableOOVFeature;
 
   bool m_timeout; //! use timeout
   size_t m_timeout_threshold; //! seconds after which time out is activated
 
   bool m_useTransOptCache; //! flag indicating, if the persistent translation option cache should be used
-  mutable std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> > m_transOptCache; //! persistent translation option cache
-  size_t m_transOptCacheMaxSize; //! maximum size for persistent translation option cache
-  //FIXME: Single lock for cache not most efficient. However using a
-  //reader-writer for LRU cache is tricky - how to record last used time?
-#ifdef WITH_THREADS
-  mutable boost::mutex m_transOptCacheMutex;
-#endif
+  mutable TranslationOptionCache m_transOptCache; //! persistent translation option cache
+  bool m_onDiskMMap; //! memory map on-disk rule tables
+  size_t m_onDiskNodeCacheSize; //! nodes of an on-disk rule table cached across sentences
+  size_t m_prefetchBatchSize; //! sentences whose phrases are looked up together in binary phrase tables
+  InputFilter *m_inputFilter; //! source n-grams of the input, if the text models are filtered by it
+  ModelSnapshot *m_modelSnapshot; //! images of the text models, if they are restored from and written to them
   bool m_isAlwaysCreateDirectTranslationOption;
   //! constructor. only the 1 static variable can be created
 
@@ -207,6 +210,9 @@ protected:
   WordAlignmentSort m_wordAlignmentSort;
 
   int m_threadCount;
+  size_t m_threadQueueSize; //! bound on sentences submitted to the thread pool but not yet translated
+  bool m_pinThreads;
+  size_t m_searchThreadCount; //! threads sharing the expansion of one stack within a sentence
   long m_startTranslationId;
   
   StaticData();
@@ -229,9 +235,10 @@ protected:
   bool LoadGenerationTables();
   //! load decoding steps
   bool LoadDecodeGraphs();
+  bool LoadInputFilter();
+  bool LoadModelSnapshot();
   bool LoadLexicalReorderingModel();
   bool LoadGlobalLexicalModel();
-  void ReduceTransOptCache() const;
   bool m_continuePartialTranslation;
 
 public:
@@ -533,6 +540,9 @@ public:
   size_t GetLMCacheCleanupThreshold() const {
     return m_lmcache_cleanup_threshold;
   }
+  size_t GetLMQueryCacheSize() const {
+    return m_lmQueryCacheSize;
+  }
 
   bool GetLMEnableOOVFeature() const {
     return m_lmEnableOOVFeature;
@@ -573,7 +583,11 @@ public:
   void ClearTransOptionCache() const;
 
 
-  const TranslationOptionList* FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+  TranslationOptionCache::ListPtr FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+
+  TranslationOptionCache::Statistics GetTransOptCacheStatistics() const {
+    return m_transOptCache.GetStatistics();
+  }
 
   bool PrintAllDerivations() const {
     return m_printAllDerivations;
@@ -615,6 +629,32 @@ public:
   int ThreadCount() const {
     return m_threadCount;
   }
+  size_t ThreadQueueSize() const {
+    return m_threadQueueSize;
+  }
+  bool PinThreads() const {
+    return m_pinThreads;
+  }
+  size_t SearchThreadCount() const {
+    return m_searchThreadCount;
+  }
+  bool GetOnDiskMMap() const {
+    return m_onDiskMMap;
+  }
+  size_t GetOnDiskNodeCacheSize() const {
+    return m_onDiskNodeCacheSize;
+  }
+  size_t GetPrefetchBatchSize() const {
+    return m_prefetchBatchSize;
+  }
+  //! the input the text models are filtered by while loading, NULL if they are not
+  const InputFilter *GetInputFilter() const {
+    return m_inputFilter;
+  }
+  //! the images the text models are restored from and written to while loading, NULL if none
+  ModelSnapshot *GetModelSnapshot() const {
+    return m_modelSnapshot;
+  }
   
   long GetStartTranslationId() const
   { return m_startTranslationId; }
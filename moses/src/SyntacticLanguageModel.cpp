@@ -2,6 +2,7 @@
 
 #include "StaticData.h"
 #include "SyntacticLanguageModel.h"
+#include "Manager.h"
 #include "HHMMLangModel-gf.h"
 #include "TextObsModel.h"
 #include "SyntacticLanguageModelFiles.h"
@@ -103,10 +104,10 @@ namespace Moses
       const std::string& string = factor->GetString();
       
       if (i==0) {
-	nextState = new SyntacticLanguageModelState<YModel,XModel,S,R>(&prev, string);
+	nextState = new (cur_hypo.GetArena()) SyntacticLanguageModelState<YModel,XModel,S,R>(&prev, string);
       } else {
 	currentState = nextState;
-	nextState = new SyntacticLanguageModelState<YModel,XModel,S,R>(currentState, string);
+	nextState = new (cur_hypo.GetArena()) SyntacticLanguageModelState<YModel,XModel,S,R>(currentState, string);
       }
       
       double score = nextState->getScore();
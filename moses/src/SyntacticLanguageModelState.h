@@ -32,6 +32,14 @@ template <class MY, class MX, class YS=typename MY::RandVarType, class B=NullBac
 
  virtual int Compare(const FFState& other) const;
 
+ // all states compare equal, see Compare()
+ virtual size_t Hash() const {
+   return 0;
+ }
+ virtual bool Equal(const FFState& other) const {
+   return true;
+ }
+
   // Get the LM score from this LM state
   double getScore() const;
 
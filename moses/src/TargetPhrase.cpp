@@ -73,6 +73,13 @@ TargetPhrase::~TargetPhrase()
 {
 }
 
+size_t TargetPhrase::GetMemoryUsage() const
+{
+  return sizeof(TargetPhrase)
+         + GetSize() * sizeof(Word)
+         + m_scoreBreakdown.size() * sizeof(float);
+}
+
 void TargetPhrase::SetScore(const TranslationSystem* system)
 {
   // used when creating translations of unknown words:
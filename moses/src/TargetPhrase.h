@@ -63,6 +63,9 @@ public:
   TargetPhrase(const Phrase &);
   ~TargetPhrase();
 
+  //! bytes taken by the phrase, its words and its scores
+  size_t GetMemoryUsage() const;
+
   //! used by the unknown word handler- these targets
   //! don't have a translation score, so wp is the only thing used
   void SetScore(const TranslationSystem* system);
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <algorithm>
 #include "TargetPhraseCollection.h"
+#include "StaticData.h"
 
 using namespace std;
 
@@ -74,6 +75,21 @@ void TargetPhraseCollection::Sort(bool adhereTableLimit, size_t tableLimit)
   }
 }
 
+void TableMemoryUsage::AddCollection(const TargetPhraseCollection &coll)
+{
+  ++m_numSources;
+  m_numTargets += coll.GetSize();
+  m_targetBytes += sizeof(TargetPhraseCollection) + coll.GetCollection().capacity() * sizeof(TargetPhrase*);
+  for (TargetPhraseCollection::const_iterator iter = coll.begin(); iter != coll.end(); ++iter) {
+    m_targetBytes += (*iter)->GetMemoryUsage();
+  }
 }
 
+void TableMemoryUsage::Report(const std::string &filePath) const
+{
+  VERBOSE(1, filePath << ": " << m_numNodes << " nodes (" << m_nodeBytes / (1024 * 1024) << " MB), "
+          << m_numSources << " source phrases with " << m_numTargets << " target phrases ("
+          << m_targetBytes / (1024 * 1024) << " MB)" << endl);
+}
 
+}
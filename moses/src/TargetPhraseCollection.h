@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_TargetPhraseCollection_h
 #define moses_TargetPhraseCollection_h
 
+#include <string>
 #include <vector>
 #include "TargetPhrase.h"
 #include "Util.h"
@@ -80,6 +81,31 @@ public:
 
 };
 
+/** Memory taken by an in-memory table, added up node by node and reported
+ * once the table is loaded
+ */
+class TableMemoryUsage
+{
+public:
+  TableMemoryUsage()
+    : m_numNodes(0), m_nodeBytes(0), m_numSources(0), m_numTargets(0)
+    , m_targetBytes(0) {}
+
+  //! a trie node taking bytes, not counting its target phrases
+  void AddNode(size_t bytes) {
+    ++m_numNodes;
+    m_nodeBytes += bytes;
+  }
+  void AddCollection(const TargetPhraseCollection &coll);
+
+  //! one line about the table in filePath, at verbosity 1
+  void Report(const std::string &filePath) const;
+
+private:
+  size_t m_numNodes, m_nodeBytes;
+  size_t m_numSources, m_numTargets, m_targetBytes;
+};
+
 }
 
 #endif
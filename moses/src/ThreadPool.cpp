@@ -30,49 +30,145 @@ using namespace Moses;
 namespace Moses
 {
 
-ThreadPool::ThreadPool( size_t numThreads )
-  : m_stopped(false), m_stopping(false)
+std::ostream &operator<<(std::ostream &out, const ThreadPoolStatistics &stats)
 {
+  out << "submitted=" << stats.submitted
+      << " executed=" << stats.executed
+      << " steals=" << stats.steals
+      << " blocked-submits=" << stats.blockedSubmits
+      << " max-queue-depth=" << stats.maxQueueDepth
+      << " avg-wait=" << (stats.executed ? stats.totalWait / stats.executed : 0.0) << "s"
+      << " max-wait=" << stats.maxWait << "s";
+  return out;
+}
+
+ThreadPool::ThreadPool(size_t numThreads, size_t maxInFlight, bool pinThreads)
+  : m_queued(0), m_inFlight(0), m_maxInFlight(maxInFlight), m_nextWorker(0)
+  , m_pinThreads(pinThreads), m_stopped(false), m_stopping(false)
+{
+  // there is always at least one queue, so tasks submitted to an empty pool
+  // are kept rather than lost
+  m_workers.resize(numThreads ? numThreads : 1);
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    m_workers[i] = new Worker();
+  }
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute, this, i));
   }
 }
 
-void ThreadPool::Execute()
+ThreadPool::~ThreadPool()
 {
-  do {
-    Task* task = NULL;
-    {
-      // Find a job to perform
+  Stop();
+  // a Submit() racing with Stop() may have queued a task after the drop
+  DropQueued();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
+  }
+}
+
+void ThreadPool::Execute(size_t id)
+{
+  if (m_pinThreads) {
+    PinToCpu(id);
+  }
+  Worker &self = *m_workers[id];
+  QueuedTask next;
+  while (true) {
+    if (!Take(id, next)) {
+      // nothing to do, sleep until a task is submitted
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
+      while (m_queued == 0 && !m_stopped) {
         m_threadNeeded.wait(lock);
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
-      }
+      if (m_stopped) return;
+      continue;
     }
+
+    const double wait = (boost::posix_time::microsec_clock::universal_time() - next.submitted).total_microseconds() / 1000000.0;
+    {
+      boost::mutex::scoped_lock lock(self.mutex);
+      ++self.executed;
+      self.totalWait += wait;
+      if (wait > self.maxWait) self.maxWait = wait;
+    }
+
     //Execute job
-    if (task) {
-      task->Run();
-      if (task->DeleteAfterExecution()) {
-        delete task;
-      }
+    next.task->Run();
+    if (next.task->DeleteAfterExecution()) {
+      delete next.task;
     }
-    m_threadAvailable.notify_all();
-  } while (!m_stopped);
+    if (Finished()) return;
+  }
 }
 
-void ThreadPool::Submit( Task* task )
+bool ThreadPool::Take(size_t id, QueuedTask &out)
+{
+  // own queue first, then the others in turn. Thieves also take the oldest
+  // task, which keeps completion close to submission order and the output
+  // collectors from buffering many finished sentences.
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    Worker &worker = *m_workers[(id + i) % m_workers.size()];
+    boost::mutex::scoped_lock lock(worker.mutex);
+    if (worker.tasks.empty()) continue;
+    out = worker.tasks.front();
+    worker.tasks.pop_front();
+    lock.unlock();
+    --m_queued;
+    if (i != 0) {
+      boost::mutex::scoped_lock selfLock(m_workers[id]->mutex);
+      ++m_workers[id]->steals;
+    }
+    return true;
+  }
+  return false;
+}
+
+bool ThreadPool::Finished()
 {
   boost::mutex::scoped_lock lock(m_mutex);
-  if (m_stopping) {
-    throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+  --m_inFlight;
+  m_threadAvailable.notify_all();
+  return m_stopped;
+}
+
+void ThreadPool::Submit( Task* task )
+{
+  Worker *worker;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_stopping) {
+      throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+    }
+    ++m_stats.submitted;
+    if (m_maxInFlight && m_inFlight >= m_maxInFlight) {
+      // back-pressure: do not run ahead of the workers
+      ++m_stats.blockedSubmits;
+      while (m_inFlight >= m_maxInFlight && !m_stopping) {
+        m_threadAvailable.wait(lock);
+      }
+      if (m_stopping) {
+        --m_stats.submitted;
+        throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+      }
+    }
+    ++m_inFlight;
+    worker = m_workers[m_nextWorker];
+    m_nextWorker = (m_nextWorker + 1) % m_workers.size();
   }
-  m_tasks.push(task);
-  m_threadNeeded.notify_all();
 
+  {
+    boost::mutex::scoped_lock lock(worker->mutex);
+    worker->tasks.push_back(QueuedTask(task));
+  }
+  // counted after the push so that a worker seeing m_queued > 0 will find
+  // the task; incremented before locking m_mutex so that a worker about to
+  // sleep either sees it or is already waiting for the notification
+  const size_t depth = ++m_queued;
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (depth > m_stats.maxQueueDepth) m_stats.maxQueueDepth = depth;
+  m_threadNeeded.notify_one();
 }
 
 void ThreadPool::Stop(bool processRemainingJobs)
@@ -83,10 +179,12 @@ void ThreadPool::Stop(bool processRemainingJobs)
     if (m_stopped) return;
     m_stopping = true;
   }
+  // wake up submitters blocked on the in-flight bound
+  m_threadAvailable.notify_all();
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
     //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    while (m_inFlight > 0 && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
   }
@@ -99,8 +197,61 @@ void ThreadPool::Stop(bool processRemainingJobs)
 
 
   m_threads.join_all();
+  DropQueued();
+}
+
+void ThreadPool::DropQueued()
+{
+  size_t dropped = 0;
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    std::deque<QueuedTask> &tasks = m_workers[i]->tasks;
+    for (size_t j = 0; j < tasks.size(); ++j) {
+      if (tasks[j].task->DeleteAfterExecution()) {
+        delete tasks[j].task;
+      }
+    }
+    dropped += tasks.size();
+    tasks.clear();
+  }
+  for (size_t i = 0; i < dropped; ++i) --m_queued;
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_inFlight -= dropped;
+  m_threadAvailable.notify_all();
+}
+
+ThreadPoolStatistics ThreadPool::GetStatistics() const
+{
+  ThreadPoolStatistics ret;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    ret = m_stats;
+  }
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    const Worker &worker = *m_workers[i];
+    boost::mutex::scoped_lock lock(worker.mutex);
+    ret.executed += worker.executed;
+    ret.steals += worker.steals;
+    ret.totalWait += worker.totalWait;
+    if (worker.maxWait > ret.maxWait) ret.maxWait = worker.maxWait;
+  }
+  return ret;
 }
 
+void ThreadPool::PinToCpu(size_t id) const
+{
+#if defined(__linux__) && defined(BOOST_HAS_PTHREADS)
+  const size_t cpus = boost::thread::hardware_concurrency();
+  if (!cpus) return;
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(id % cpus, &cpuSet);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet)) {
+    cerr << "Warning: unable to pin thread " << id << " to cpu " << (id % cpus) << endl;
+  }
+#else
+  cerr << "Warning: pinning threads to cpus is not supported on this platform" << endl;
+#endif
 }
-#endif //WITH_THREADS
 
+}
+#endif //WITH_THREADS
@@ -22,12 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_ThreadPool_h
 #define moses_ThreadPool_h
 
+#include <deque>
 #include <iostream>
-#include <queue>
 #include <vector>
 
 #ifdef WITH_THREADS
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/detail/atomic_count.hpp>
 #include <boost/thread.hpp>
 #endif
 
@@ -58,17 +60,44 @@ public:
 
 #ifdef WITH_THREADS
 
+/**
+ * Counters describing how a ThreadPool has been used. Times are in seconds.
+ **/
+struct ThreadPoolStatistics {
+  ThreadPoolStatistics()
+    : submitted(0), executed(0), steals(0), blockedSubmits(0)
+    , maxQueueDepth(0), totalWait(0), maxWait(0) {}
+
+  size_t submitted; //! tasks handed to Submit()
+  size_t executed; //! tasks run to completion
+  size_t steals; //! tasks taken from the queue of another thread
+  size_t blockedSubmits; //! calls to Submit() that waited for the in-flight bound
+  size_t maxQueueDepth; //! largest number of queued, not yet started tasks
+  double totalWait; //! summed time between submission and start of the tasks
+  double maxWait; //! longest time a task waited to be started
+};
+
+std::ostream &operator<<(std::ostream &out, const ThreadPoolStatistics &stats);
+
+/**
+ * Fixed size pool of worker threads. Each worker has its own task queue;
+ * submitted tasks are dealt out round robin and a worker whose queue has run
+ * dry steals the oldest task of another, so workers do not all contend
+ * for a single lock. Optionally the number of submitted but unfinished tasks
+ * is bounded, in which case Submit() blocks until a task has completed.
+ **/
 class ThreadPool
 {
  public:
   /**
    * Construct a thread pool of a fixed size.
+   * @param maxInFlight if non-zero, Submit() blocks while this many tasks are
+   *   queued or running
+   * @param pinThreads bind worker i to cpu i (modulo the number of cpus)
    **/
-  explicit ThreadPool(size_t numThreads);
+  explicit ThreadPool(size_t numThreads, size_t maxInFlight = 0, bool pinThreads = false);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
   /**
    * Add a job to the threadpool.
@@ -76,24 +105,62 @@ class ThreadPool
   void Submit(Task* task);
 
   /**
-   * Wait until all queued jobs have completed, and shut down
-   * the ThreadPool.
+   * Shut down the ThreadPool. Waits for the queued jobs to complete if
+   * processRemainingJobs, otherwise those not yet started are discarded.
+   * A Submit() blocked on the in-flight bound throws.
    **/
   void Stop(bool processRemainingJobs = false);
 
+  //! snapshot of the queue statistics
+  ThreadPoolStatistics GetStatistics() const;
+
 private:
+  struct QueuedTask {
+    QueuedTask() : task(NULL) {}
+    QueuedTask(Task *t) : task(t), submitted(boost::posix_time::microsec_clock::universal_time()) {}
+    Task *task;
+    boost::posix_time::ptime submitted;
+  };
+
+  //! task queue of one worker, with the counters only that worker updates
+  struct Worker {
+    Worker() : executed(0), steals(0), totalWait(0), maxWait(0) {}
+    mutable boost::mutex mutex;
+    std::deque<QueuedTask> tasks;
+    size_t executed, steals;
+    double totalWait, maxWait;
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t id);
+
+  //! next task for worker id, from its own queue or stolen from another
+  bool Take(size_t id, QueuedTask &out);
+
+  //! account for a finished task, wake up a blocked Submit() or Stop().
+  //! Returns true if the worker should exit.
+  bool Finished();
+
+  //! delete the tasks no worker has started, after the workers have exited
+  void DropQueued();
+
+  void PinToCpu(size_t id) const;
 
-  std::queue<Task*> m_tasks;
+  std::vector<Worker*> m_workers;
   boost::thread_group m_threads;
-  boost::mutex m_mutex;
+  mutable boost::mutex m_mutex; //! guards the fields below and sleeping workers
   boost::condition_variable m_threadNeeded;
   boost::condition_variable m_threadAvailable;
+  boost::detail::atomic_count m_queued; //! tasks sitting in worker queues
+  size_t m_inFlight; //! tasks submitted but not finished
+  size_t m_maxInFlight;
+  size_t m_nextWorker;
+  bool m_pinThreads;
   bool m_stopped;
   bool m_stopping;
+  ThreadPoolStatistics m_stats; //! submission side counters
 };
 
 class TestTask : public Task
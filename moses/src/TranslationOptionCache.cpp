@@ -0,0 +1,164 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/functional/hash.hpp>
+#include "TranslationOptionCache.h"
+#include "TranslationOption.h"
+
+namespace Moses
+{
+
+#ifdef WITH_THREADS
+#define LOCK_SHARD(shard) boost::mutex::scoped_lock lock((shard).mutex)
+#else
+#define LOCK_SHARD(shard)
+#endif
+
+TranslationOptionCache::TranslationOptionCache(size_t maxBytes, size_t maxEntries)
+{
+  SetMaxSize(maxBytes, maxEntries);
+}
+
+void TranslationOptionCache::SetMaxSize(size_t maxBytes, size_t maxEntries)
+{
+  // round up, so that a small but non-zero bound still allows some entries.
+  // Not by adding NUM_SHARDS - 1 first: that overflows for an unbounded size
+  m_maxShardBytes = maxBytes / NUM_SHARDS + (maxBytes % NUM_SHARDS != 0);
+  m_maxShardEntries = maxEntries / NUM_SHARDS + (maxEntries % NUM_SHARDS != 0);
+}
+
+TranslationOptionCache::Shard &TranslationOptionCache::GetShard(const Key &key) const
+{
+  // the top bits, as the unordered_map of the shard uses the bottom ones
+  const size_t hash = boost::hash<Key>()(key);
+  return m_shards[(hash >> (sizeof(size_t) * 8 - 4)) % NUM_SHARDS];
+}
+
+TranslationOptionCache::ListPtr TranslationOptionCache::Find(size_t decodeGraph, const Phrase &sourcePhrase) const
+{
+  const Key key(decodeGraph, sourcePhrase);
+  Shard &shard = GetShard(key);
+  LOCK_SHARD(shard);
+  boost::unordered_map<Key, Clock::iterator>::const_iterator iter = shard.index.find(key);
+  if (iter == shard.index.end()) {
+    ++shard.misses;
+    return ListPtr();
+  }
+  ++shard.hits;
+  iter->second->referenced = true;
+  return iter->second->list;
+}
+
+void TranslationOptionCache::Add(size_t decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList)
+{
+  if (m_maxShardBytes == 0 || m_maxShardEntries == 0) return;
+
+  const Key key(decodeGraph, sourcePhrase);
+  // copy outside of the lock
+  ListPtr list(new TranslationOptionList(transOptList));
+  const size_t bytes = EstimateSize(sourcePhrase, transOptList);
+
+  Shard &shard = GetShard(key);
+  LOCK_SHARD(shard);
+  if (shard.index.find(key) != shard.index.end()) {
+    // another thread got there first
+    return;
+  }
+  // just behind the hand, to be considered for eviction last
+  Clock::iterator entry = shard.clock.insert(shard.hand, Entry(key, list, bytes));
+  shard.index[key] = entry;
+  shard.bytes += bytes;
+  ++shard.insertions;
+  Reduce(shard);
+}
+
+void TranslationOptionCache::Reduce(Shard &shard)
+{
+  while (!shard.clock.empty()
+         && (shard.bytes > m_maxShardBytes || shard.clock.size() > m_maxShardEntries)) {
+    if (shard.hand == shard.clock.end())
+      shard.hand = shard.clock.begin();
+    if (shard.hand->referenced) {
+      shard.hand->referenced = false;
+      ++shard.hand;
+    } else {
+      shard.index.erase(shard.hand->key);
+      shard.bytes -= shard.hand->bytes;
+      shard.hand = shard.clock.erase(shard.hand);
+      ++shard.evictions;
+    }
+  }
+}
+
+void TranslationOptionCache::Clear()
+{
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    Shard &shard = m_shards[i];
+    LOCK_SHARD(shard);
+    shard.index.clear();
+    shard.clock.clear();
+    shard.hand = shard.clock.end();
+    shard.bytes = 0;
+  }
+}
+
+TranslationOptionCache::Statistics TranslationOptionCache::GetStatistics() const
+{
+  Statistics ret;
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    Shard &shard = m_shards[i];
+    LOCK_SHARD(shard);
+    ret.hits += shard.hits;
+    ret.misses += shard.misses;
+    ret.insertions += shard.insertions;
+    ret.evictions += shard.evictions;
+    ret.entries += shard.clock.size();
+    ret.bytes += shard.bytes;
+  }
+  return ret;
+}
+
+size_t TranslationOptionCache::EstimateSize(const Phrase &sourcePhrase, const TranslationOptionList &transOptList)
+{
+  size_t ret = sizeof(Entry) + sourcePhrase.GetSize() * sizeof(Word)
+               + sizeof(TranslationOptionList) + transOptList.size() * sizeof(TranslationOption*);
+  TranslationOptionList::const_iterator iter;
+  for (iter = transOptList.begin(); iter != transOptList.end(); ++iter) {
+    const TranslationOption &transOpt = **iter;
+    ret += sizeof(TranslationOption)
+           + transOpt.GetTargetPhrase().GetSize() * sizeof(Word)
+           + (transOpt.GetScoreBreakdown().size() + transOpt.GetTargetPhrase().GetScoreBreakdown().size()) * sizeof(float);
+    if (transOpt.GetSourcePhrase())
+      ret += sizeof(Phrase) + transOpt.GetSourcePhrase()->GetSize() * sizeof(Word);
+  }
+  return ret;
+}
+
+std::ostream &operator<<(std::ostream &out, const TranslationOptionCache::Statistics &stats)
+{
+  out << "hits=" << stats.hits
+      << " misses=" << stats.misses
+      << " insertions=" << stats.insertions
+      << " evictions=" << stats.evictions
+      << " entries=" << stats.entries
+      << " bytes=" << stats.bytes;
+  return out;
+}
+
+}
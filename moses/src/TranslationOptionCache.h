@@ -0,0 +1,125 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TranslationOptionCache_h
+#define moses_TranslationOptionCache_h
+
+#include <iostream>
+#include <list>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "Phrase.h"
+#include "TranslationOptionList.h"
+
+namespace Moses
+{
+
+/** Persistent (cross-sentence) cache of the translation options of source
+ * phrases, shared by all decoding threads.
+ * Entries are spread over shards with a lock each. A lookup holds the lock of
+ * one shard just long enough to find the entry; the list itself is immutable
+ * and reference counted, so it is read without any lock and stays valid even
+ * if it is evicted meanwhile.
+ * Each shard evicts with the CLOCK algorithm: a hit only sets a flag on the
+ * entry and the clock hand gives flagged entries a second chance, which
+ * approximates LRU at constant cost per operation.
+ */
+class TranslationOptionCache
+{
+public:
+  typedef boost::shared_ptr<const TranslationOptionList> ListPtr;
+
+  struct Statistics {
+    Statistics() : hits(0), misses(0), insertions(0), evictions(0), entries(0), bytes(0) {}
+    size_t hits, misses, insertions, evictions;
+    size_t entries; //! entries currently stored
+    size_t bytes; //! estimated memory used by the stored entries
+  };
+
+  /** \param maxBytes bound on the estimated memory of all entries
+   *  \param maxEntries bound on the number of entries */
+  TranslationOptionCache(size_t maxBytes = 0, size_t maxEntries = 0);
+
+  //! change the bounds. 0 for either disables the cache
+  void SetMaxSize(size_t maxBytes, size_t maxEntries);
+
+  //! translation options of sourcePhrase in decoding graph decodeGraph, NULL if not cached
+  ListPtr Find(size_t decodeGraph, const Phrase &sourcePhrase) const;
+
+  //! store a copy of transOptList, unless the phrase is already cached
+  void Add(size_t decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList);
+
+  void Clear();
+
+  Statistics GetStatistics() const;
+
+  //! approximate number of bytes an entry takes up
+  static size_t EstimateSize(const Phrase &sourcePhrase, const TranslationOptionList &transOptList);
+
+private:
+  static const size_t NUM_SHARDS = 16;
+
+  typedef std::pair<size_t, Phrase> Key;
+
+  struct Entry {
+    Entry(const Key &k, const ListPtr &l, size_t b) : key(k), list(l), bytes(b), referenced(false) {}
+    Key key;
+    ListPtr list;
+    size_t bytes;
+    bool referenced; //! used since the clock hand last passed
+  };
+  typedef std::list<Entry> Clock;
+
+  struct Shard {
+    Shard() : bytes(0), hits(0), misses(0), insertions(0), evictions(0) {
+      hand = clock.end();
+    }
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+#endif
+    Clock clock; //! entries in insertion order, cyclically
+    Clock::iterator hand; //! next eviction candidate
+    boost::unordered_map<Key, Clock::iterator> index;
+    size_t bytes;
+    size_t hits, misses, insertions, evictions;
+  };
+
+  TranslationOptionCache(const TranslationOptionCache &); // not implemented
+  TranslationOptionCache &operator=(const TranslationOptionCache &); // not implemented
+
+  Shard &GetShard(const Key &key) const;
+
+  //! evict until the shard is within its bounds. Caller holds the lock.
+  void Reduce(Shard &shard);
+
+  mutable Shard m_shards[NUM_SHARDS];
+  size_t m_maxShardBytes, m_maxShardEntries;
+};
+
+std::ostream &operator<<(std::ostream &out, const TranslationOptionCache::Statistics &stats);
+
+}
+
+#endif
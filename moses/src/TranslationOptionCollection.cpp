@@ -452,9 +452,9 @@ void TranslationOptionCollection::CreateTranslationOptionsForRange(
       const WordsRange wordsRange(startPos, endPos);
       sourcePhrase = new Phrase(m_source.GetSubString(wordsRange));
 
-      const TranslationOptionList *transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
+      TranslationOptionCache::ListPtr transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
       // is phrase in cache?
-      if (transOptList != NULL) {
+      if (transOptList) {
         skipTransOptCreation = true;
         TranslationOptionList::const_iterator iterTransOpt;
         for (iterTransOpt = transOptList->begin() ; iterTransOpt != transOptList->end() ; ++iterTransOpt) {
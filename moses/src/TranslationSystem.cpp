@@ -135,6 +135,36 @@ void TranslationSystem::InitializeBeforeSentenceProcessing(const InputType& sour
   }
 }
 
+void TranslationSystem::InitializeSearchThread(const InputType& source) const
+{
+  // only features evaluated during search keep thread local state;
+  // translation options are collected before the search starts
+  for(size_t i=0; i<m_globalLexicalModels.size(); ++i) {
+    m_globalLexicalModels[i]->InitializeForInput((Sentence const&)source);
+  }
+}
+
+void TranslationSystem::CleanUpSearchThread() const
+{
+  // LM query caches report to the stats of the sentence when dropped
+  LMList::const_iterator iterLM;
+  for (iterLM = m_languageModels.begin() ; iterLM != m_languageModels.end() ; ++iterLM) {
+    LanguageModel &languageModel = **iterLM;
+    languageModel.CleanUpSearchThread();
+  }
+}
+
+const FeatureFunction *TranslationSystem::GetSearchThreadUnsafeFeature() const
+{
+  for (size_t i = 0; i < m_statelessFFs.size(); ++i) {
+    if (!m_statelessFFs[i]->IsSearchThreadSafe()) return m_statelessFFs[i];
+  }
+  for (size_t i = 0; i < m_statefulFFs.size(); ++i) {
+    if (!m_statefulFFs[i]->IsSearchThreadSafe()) return m_statefulFFs[i];
+  }
+  return NULL;
+}
+
 void TranslationSystem::CleanUpAfterSentenceProcessing() const
 {
 
@@ -115,6 +115,12 @@ public:
   //sentence (and thread) specific initialisationn and cleanup
   void InitializeBeforeSentenceProcessing(const InputType& source) const;
   void CleanUpAfterSentenceProcessing() const;
+  //thread specific initialisation for a thread helping to search a sentence
+  void InitializeSearchThread(const InputType& source) const;
+  //! called in the same thread once the sentence is done
+  void CleanUpSearchThread() const;
+  //! a feature evaluated during search that several search threads may not share, or NULL
+  const FeatureFunction *GetSearchThreadUnsafeFeature() const;
 
 
 
@@ -20,8 +20,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include "TrellisPath.h"
-#include "TrellisPathList.h"
-#include "TrellisPathCollection.h"
 #include "StaticData.h"
 
 using namespace std;
@@ -29,7 +27,6 @@ using namespace std;
 namespace Moses
 {
 TrellisPath::TrellisPath(const Hypothesis *hypo)
-  :	m_prevEdgeChanged(NOT_FOUND)
 {
   m_scoreBreakdown					= hypo->GetScoreBreakdown();
   m_totalScore = hypo->GetTotalScore();
@@ -60,30 +57,7 @@ void TrellisPath::InitScore() {
 
 }
 
-TrellisPath::TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypothesis *arc)
-  :m_prevEdgeChanged(edgeIndex)
-{
-  m_path.reserve(copy.m_path.size());
-  for (size_t currEdge = 0 ; currEdge < edgeIndex ; currEdge++) {
-    // copy path from parent
-    m_path.push_back(copy.m_path[currEdge]);
-  }
-
-  // 1 deviation
-  m_path.push_back(arc);
-
-  // rest of path comes from following best path backwards
-  const Hypothesis *prevHypo = arc->GetPrevHypo();
-  while (prevHypo != NULL) {
-    m_path.push_back(prevHypo);
-    prevHypo = prevHypo->GetPrevHypo();
-  }
-
-  InitScore();
-}
-
-TrellisPath::TrellisPath(const vector<const Hypothesis*> edges) 
-:m_prevEdgeChanged(NOT_FOUND)
+TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
 {
   m_path.resize(edges.size());
   copy(edges.rbegin(),edges.rend(),m_path.begin());
@@ -93,84 +67,6 @@ TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
 }
 
 
-void TrellisPath::CreateDeviantPaths(TrellisPathCollection &pathColl) const
-{
-  const size_t sizePath = m_path.size();
-
-  if (m_prevEdgeChanged == NOT_FOUND) {
-    // initial enumration from a pure hypo
-    for (size_t currEdge = 0 ; currEdge < sizePath ; currEdge++) {
-      const Hypothesis	*hypo		= static_cast<const Hypothesis*>(m_path[currEdge]);
-      const ArcList *pAL = hypo->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-
-      // every possible Arc to replace this edge
-      ArcList::const_iterator iterArc;
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        const Hypothesis *arc = *iterArc;
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arc);
-        pathColl.Add(deviantPath);
-      }
-    }
-  } else {
-    // wiggle 1 of the edges only
-    for (size_t currEdge = m_prevEdgeChanged + 1 ; currEdge < sizePath ; currEdge++) {
-      const ArcList *pAL = m_path[currEdge]->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-      ArcList::const_iterator iterArc;
-
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        // copy this Path & change 1 edge
-        const Hypothesis *arcReplace = *iterArc;
-
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arcReplace);
-        pathColl.Add(deviantPath);
-      } // for (iterArc...
-    } // for (currEdge = 0 ...
-  }
-}
-
-void TrellisPath::CreateDeviantPaths(TrellisPathList &pathColl) const
-{
-  const size_t sizePath = m_path.size();
-
-  if (m_prevEdgeChanged == NOT_FOUND) {
-    // initial enumration from a pure hypo
-    for (size_t currEdge = 0 ; currEdge < sizePath ; currEdge++) {
-      const Hypothesis	*hypo		= static_cast<const Hypothesis*>(m_path[currEdge]);
-      const ArcList *pAL = hypo->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-
-      // every possible Arc to replace this edge
-      ArcList::const_iterator iterArc;
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        const Hypothesis *arc = *iterArc;
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arc);
-        pathColl.Add(deviantPath);
-      }
-    }
-  } else {
-    // wiggle 1 of the edges only
-    for (size_t currEdge = m_prevEdgeChanged + 1 ; currEdge < sizePath ; currEdge++) {
-      const ArcList *pAL = m_path[currEdge]->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-      ArcList::const_iterator iterArc;
-
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        // copy this Path & change 1 edge
-        const Hypothesis *arcReplace = *iterArc;
-
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arcReplace);
-        pathColl.Add(deviantPath);
-      } // for (iterArc...
-    } // for (currEdge = 0 ...
-  }
-}
-
 Phrase TrellisPath::GetTargetPhrase() const
 {
   Phrase targetPhrase(ARRAY_SIZE_INCR);
@@ -31,9 +31,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 namespace Moses
 {
 
-class TrellisPathCollection;
-class TrellisPathList;
-
 /** Encapsulate the set of hypotheses/arcs that goes from decoding 1 phrase to all the source phrases
  *	to reach a final translation. For the best translation, this consist of all hypotheses, for the other
  *	n-best paths, the node on the path can consist of hypotheses or arcs
@@ -42,12 +39,10 @@ class TrellisPath
 {
   friend std::ostream& operator<<(std::ostream&, const TrellisPath&);
   friend class Manager;
+  friend class NBestExtractor;
 
 protected:
   std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
-  size_t		m_prevEdgeChanged; /**< the last node that was wiggled to create this path
-																	, or NOT_FOUND if this path is the best trans so consist of only hypos
-															 */
 
   ScoreComponentCollection	m_scoreBreakdown;
   float m_totalScore;
@@ -64,11 +59,6 @@ public:
   //! create path OF pure hypo
   TrellisPath(const Hypothesis *hypo);
 
-  /** create path from another path, deviate at edgeIndex by using arc instead,
-  	* which may change other hypo back from there
-  	*/
-  TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypothesis *arc);
-
   //! get score for this path throught trellis
   inline float GetTotalScore() const {
     return m_totalScore;
@@ -81,12 +71,6 @@ public:
     return m_path;
   }
 
-  //! create a set of next best paths by wiggling 1 of the node at a time.
-  void CreateDeviantPaths(TrellisPathCollection &pathColl) const;
-
-  //! create a list of next best paths by wiggling 1 of the node at a time.
-  void CreateDeviantPaths(TrellisPathList &pathColl) const;
-
   inline const ScoreComponentCollection &GetScoreBreakdown() const {
     return m_scoreBreakdown;
   }
@@ -54,7 +54,8 @@ namespace Moses
 const size_t DEFAULT_CUBE_PRUNING_POP_LIMIT = 1000;
 const size_t DEFAULT_CUBE_PRUNING_DIVERSITY = 0;
 const size_t DEFAULT_MAX_HYPOSTACK_SIZE = 200;
-const size_t DEFAULT_MAX_TRANS_OPT_CACHE_SIZE = 10000;
+const size_t DEFAULT_MAX_TRANS_OPT_CACHE_MEMORY = 256; // megabytes
+const size_t DEFAULT_ONDISK_NODE_CACHE_SIZE = 10000;
 const size_t DEFAULT_MAX_TRANS_OPT_SIZE	= 5000;
 const size_t DEFAULT_MAX_PART_TRANS_OPT_SIZE = 10000;
 const size_t DEFAULT_MAX_PHRASE_LENGTH = 20;
@@ -72,7 +73,11 @@ const size_t DEFAULT_VERBOSE_LEVEL = 1;
 // can only be 2 at the moment
 const int NUM_LANGUAGES = 2;
 
-const size_t MAX_NUM_FACTORS = 4;
+// set with --max-factors when building
+#ifndef MAX_NUM_FACTORS_DEFAULT
+#define MAX_NUM_FACTORS_DEFAULT 4
+#endif
+const size_t MAX_NUM_FACTORS = MAX_NUM_FACTORS_DEFAULT;
 
 enum FactorDirection {
   Input,			//! Source factors
@@ -135,6 +140,8 @@ enum PhraseTableImplementation {
   ,SuffixArray	= 8
   ,Hiero        = 9
   ,ALSuffixArray = 10
+  ,MMap         = 11
+  ,Compact      = 12
 };
 
 enum InputTypeEnum {
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <sstream>
+#include <boost/functional/hash.hpp>
 #include "memory.h"
 #include "Word.h"
 #include "TypeDef.h"
@@ -39,15 +40,15 @@ int Word::Compare(const Word &targetWord, const Word &sourceWord)
   }
 
   for (size_t factorType = 0 ; factorType < MAX_NUM_FACTORS ; factorType++) {
-    const Factor *targetFactor		= targetWord[factorType]
-                                    ,*sourceFactor	= sourceWord[factorType];
+    const UINT32 targetId = targetWord.m_factorIds[factorType]
+                           ,sourceId = sourceWord.m_factorIds[factorType];
 
-    if (targetFactor == NULL || sourceFactor == NULL)
+    if (targetId == 0 || sourceId == 0)
       continue;
-    if (targetFactor == sourceFactor)
+    if (targetId == sourceId)
       continue;
 
-    return (targetFactor<sourceFactor) ? -1 : +1;
+    return (targetId < sourceId) ? -1 : +1;
   }
   return 0;
 
@@ -56,10 +57,8 @@ int Word::Compare(const Word &targetWord, const Word &sourceWord)
 void Word::Merge(const Word &sourceWord)
 {
   for (unsigned int currFactor = 0 ; currFactor < MAX_NUM_FACTORS ; currFactor++) {
-    const Factor *sourcefactor		= sourceWord.m_factorArray[currFactor]
-                                    ,*targetFactor		= this     ->m_factorArray[currFactor];
-    if (targetFactor == NULL && sourcefactor != NULL) {
-      m_factorArray[currFactor] = sourcefactor;
+    if (m_factorIds[currFactor] == 0) {
+      m_factorIds[currFactor] = sourceWord.m_factorIds[currFactor];
     }
   }
 }
@@ -71,7 +70,7 @@ std::string Word::GetString(const vector<FactorType> factorType,bool endWithBlan
   const std::string& factorDelimiter = StaticData::Instance().GetFactorDelimiter();
   bool firstPass = true;
   for (unsigned int i = 0 ; i < factorType.size() ; i++) {
-    const Factor *factor = m_factorArray[factorType[i]];
+    const Factor *factor = GetFactor(factorType[i]);
     if (factor != NULL) {
       if (firstPass) {
         firstPass = false;
@@ -100,7 +99,7 @@ void Word::CreateFromString(FactorDirection direction
   for (size_t ind = 0; ind < wordVec.size(); ++ind) {
     FactorType factorType = factorOrder[ind];
     factor = factorCollection.AddFactor(direction, factorType, wordVec[ind]);
-    m_factorArray[factorType] = factor;
+    SetFactor(factorType, factor);
   }
 
   // assume term/non-term same for all factors
@@ -148,5 +147,13 @@ ostream& operator<<(ostream& out, const Word& word)
   return out;
 }
 
+size_t hash_value(const Word &word)
+{
+  // Compare() skips a factor that either word lacks, so only the surface
+  // factor, which the words put in hashed containers carry, is hashed
+  size_t seed = word.IsNonTerminal();
+  boost::hash_combine(seed, word.m_factorIds[0]);
+  return seed;
 }
 
+}
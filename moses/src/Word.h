@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <list>
 #include "TypeDef.h"
 #include "Factor.h"
+#include "FactorCollection.h"
 #include "Util.h"
 
 namespace Moses
@@ -37,52 +38,89 @@ class Phrase;
 
 /***
  * hold a set of factors for a single word
+ *
+ * The factors are stored by their id in the FactorCollection, 32 bits each,
+ * rather than by pointer. A word has no padding, so words and the contiguous
+ * words of a Phrase can be compared and hashed as raw memory.
  */
 class Word
 {
   friend std::ostream& operator<<(std::ostream&, const Word&);
+  friend size_t hash_value(const Word &word);
 
 protected:
 
-  typedef const Factor * FactorArray[MAX_NUM_FACTORS];
+  /** id + 1 of each factor, 0 if the factor is not set, so that a zeroed
+   * array is an empty word */
+  typedef UINT32 FactorIdArray[MAX_NUM_FACTORS];
 
-  FactorArray m_factorArray; /**< set of factors */
-  bool m_isNonTerminal;
+  FactorIdArray m_factorIds; /**< set of factors */
+  UINT32 m_isNonTerminal;
+
+  static const Factor *ToFactor(UINT32 id) {
+    return id ? FactorCollection::Instance().GetFactor(id - 1) : NULL;
+  }
+  static UINT32 FromFactor(const Factor *factor) {
+    return factor ? static_cast<UINT32>(factor->GetId() + 1) : 0;
+  }
 
 public:
+  /** a factor of a word that can be assigned to */
+  class FactorRef
+  {
+  public:
+    explicit FactorRef(UINT32 &id) : m_id(id) {}
+    operator const Factor*() const {
+      return ToFactor(m_id);
+    }
+    const Factor *operator->() const {
+      return ToFactor(m_id);
+    }
+    FactorRef &operator=(const Factor *factor) {
+      m_id = FromFactor(factor);
+      return *this;
+    }
+    FactorRef &operator=(const FactorRef &other) {
+      m_id = other.m_id;
+      return *this;
+    }
+  private:
+    UINT32 &m_id;
+  };
+
   /** deep copy */
   Word(const Word &copy)
     :m_isNonTerminal(copy.m_isNonTerminal) {
-    std::memcpy(m_factorArray, copy.m_factorArray, sizeof(FactorArray));
+    std::memcpy(m_factorIds, copy.m_factorIds, sizeof(FactorIdArray));
   }
 
   /** empty word */
   explicit Word(bool isNonTerminal = false) {
-    std::memset(m_factorArray, 0, sizeof(FactorArray));
+    std::memset(m_factorIds, 0, sizeof(FactorIdArray));
     m_isNonTerminal = isNonTerminal;
   }
 
   ~Word() {}
 
   //! returns Factor pointer for particular FactorType
-  const Factor*& operator[](FactorType index) {
-    return m_factorArray[index];
+  FactorRef operator[](FactorType index) {
+    return FactorRef(m_factorIds[index]);
   }
 
-  const Factor * const & operator[](FactorType index) const {
-    return m_factorArray[index];
+  const Factor *operator[](FactorType index) const {
+    return ToFactor(m_factorIds[index]);
   }
 
   //! Deprecated. should use operator[]
   inline const Factor* GetFactor(FactorType factorType) const {
-    return m_factorArray[factorType];
+    return ToFactor(m_factorIds[factorType]);
   }
   inline void SetFactor(FactorType factorType, const Factor *factor) {
-    m_factorArray[factorType] = factor;
+    m_factorIds[factorType] = FromFactor(factor);
   }
 
   inline bool IsNonTerminal() const {
-    return m_isNonTerminal;
+    return m_isNonTerminal != 0;
   }
   inline void SetIsNonTerminal(bool val) {
     m_isNonTerminal = val;
@@ -143,6 +181,12 @@ struct WordComparer {
   }
 };
 
+/** hash of the non-terminal flag and the surface factor (factor 0), the only
+ * parts of a word that Word::Compare() always looks at if the words have a
+ * surface factor. Words hashed into one container must all have it or all
+ * lack it. */
+size_t hash_value(const Word &word);
+
 }
 
 #endif
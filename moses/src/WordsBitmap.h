@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_WordsBitmap_h
 #define moses_WordsBitmap_h
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 #include <iostream>
@@ -35,73 +36,138 @@ namespace Moses
 {
 typedef unsigned long WordsBitmapID;
 
-/** vector of boolean used to represent whether a word has been translated or not
+/** vector of boolean used to represent whether a word has been translated or not.
+ * Coverage is packed into 64 bit blocks, stored inline for sentences of up to
+ * 128 words so that copying a hypothesis' coverage does not hit the heap.
+ * A hash of the bitmap is kept up to date as positions are set.
 */
 class WordsBitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap);
 protected:
+  typedef uint64_t Block;
+  static const size_t BLOCK_BITS = 64;
+  static const size_t INLINE_BLOCKS = 2;
+
   const size_t m_size; /**< number of words in sentence */
-  bool	*m_bitmap;	/**< ticks of words that have been done */
+  const size_t m_numBlocks; /**< number of 64 bit blocks used */
+  Block m_inline[INLINE_BLOCKS]; /**< storage for short sentences */
+  Block *m_bitmap;	/**< ticks of words that have been done, bit (pos % 64) of block (pos / 64) */
+  size_t m_hash; /**< sum of per-block hashes, updated on every change */
 
   WordsBitmap(); // not implemented
+  WordsBitmap &operator=(const WordsBitmap &); // not implemented
+
+  static size_t NumBlocks(size_t size) {
+    return (size + BLOCK_BITS - 1) / BLOCK_BITS;
+  }
+
+  //! bits lo..hi (inclusive) of a block set
+  static Block RangeMask(size_t lo, size_t hi) {
+    return (~Block(0) >> (BLOCK_BITS - 1 - hi)) & (~Block(0) << lo);
+  }
+
+  static size_t CountTrailingZeros(Block block) {
+    return __builtin_ctzll(block);
+  }
+  static size_t HighestBit(Block block) {
+    return BLOCK_BITS - 1 - __builtin_clzll(block);
+  }
+
+  //! mask of the positions of block b that are inside the sentence
+  Block ValidMask(size_t b) const {
+    size_t rest = m_size - b * BLOCK_BITS;
+    return rest >= BLOCK_BITS ? ~Block(0) : RangeMask(0, rest - 1);
+  }
+
+  static size_t HashBlock(size_t b, Block block) {
+    // splitmix64 finaliser, salted with the block index
+    uint64_t x = block + 0x9e3779b97f4a7c15ULL * (b + 1);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (size_t) (x ^ (x >> 31));
+  }
+
+  void SetBlock(size_t b, Block block) {
+    m_hash += HashBlock(b, block) - HashBlock(b, m_bitmap[b]);
+    m_bitmap[b] = block;
+  }
+
+  void Allocate() {
+    m_bitmap = (m_numBlocks <= INLINE_BLOCKS) ? m_inline : (Block*) malloc(sizeof(Block) * m_numBlocks);
+  }
 
   //! set all elements to false
   void Initialize() {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      m_bitmap[pos] = false;
+    m_hash = m_size;
+    for (size_t b = 0 ; b < m_numBlocks ; b++) {
+      m_bitmap[b] = 0;
+      m_hash += HashBlock(b, 0);
     }
   }
 
   //sets elements by vector
-  void Initialize(std::vector<bool> vector) {
-    size_t vector_size = vector.size();
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (pos < vector_size && vector[pos] == true) m_bitmap[pos] = true;
-      else m_bitmap[pos] = false;
+  void Initialize(const std::vector<bool> &vector) {
+    Initialize();
+    size_t vector_size = std::min(vector.size(), m_size);
+    for (size_t pos = 0 ; pos < vector_size ; pos++) {
+      if (vector[pos])
+        SetValue(pos, true);
     }
   }
 
+  //! the len (<= 64) bits starting at pos, with pos in the lowest bit
+  Block GetBits(size_t pos, size_t len) const {
+    if (len == 0) return 0;
+    size_t b = pos / BLOCK_BITS, offset = pos % BLOCK_BITS;
+    Block bits = m_bitmap[b] >> offset;
+    if (offset + len > BLOCK_BITS)
+      bits |= m_bitmap[b + 1] << (BLOCK_BITS - offset);
+    return len == BLOCK_BITS ? bits : bits & RangeMask(0, len - 1);
+  }
 
 public:
   //! create WordsBitmap of length size and initialise with vector
-  WordsBitmap(size_t size, std::vector<bool> initialize_vector)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+  WordsBitmap(size_t size, const std::vector<bool> &initialize_vector)
+    :m_size	(size)
+    ,m_numBlocks(NumBlocks(size)) {
+    Allocate();
     Initialize(initialize_vector);
   }
   //! create WordsBitmap of length size and initialise
   WordsBitmap(size_t size)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+    :m_size	(size)
+    ,m_numBlocks(NumBlocks(size)) {
+    Allocate();
     Initialize();
   }
   //! deep copy
   WordsBitmap(const WordsBitmap &copy)
-    :m_size	(copy.m_size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * m_size);
-    for (size_t pos = 0 ; pos < copy.m_size ; pos++) {
-      m_bitmap[pos] = copy.GetValue(pos);
-    }
+    :m_size	(copy.m_size)
+    ,m_numBlocks(copy.m_numBlocks)
+    ,m_hash(copy.m_hash) {
+    Allocate();
+    std::memcpy(m_bitmap, copy.m_bitmap, sizeof(Block) * m_numBlocks);
   }
   ~WordsBitmap() {
-    free(m_bitmap);
+    if (m_bitmap != m_inline)
+      free(m_bitmap);
   }
   //! count of words translated
   size_t GetNumWordsCovered() const {
     size_t count = 0;
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (m_bitmap[pos])
-        count++;
+    for (size_t b = 0 ; b < m_numBlocks ; b++) {
+      count += __builtin_popcountll(m_bitmap[b]);
     }
     return count;
   }
 
   //! position of 1st word not yet translated, or NOT_FOUND if everything already translated
   size_t GetFirstGapPos() const {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t b = 0 ; b < m_numBlocks ; b++) {
+      Block gaps = ~m_bitmap[b] & ValidMask(b);
+      if (gaps) {
+        return b * BLOCK_BITS + CountTrailingZeros(gaps);
       }
     }
     // no starting pos
@@ -111,9 +177,10 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t b = m_numBlocks ; b > 0 ; b--) {
+      Block gaps = ~m_bitmap[b - 1] & ValidMask(b - 1);
+      if (gaps) {
+        return (b - 1) * BLOCK_BITS + HighestBit(gaps);
       }
     }
     // no starting pos
@@ -123,9 +190,9 @@ public:
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
+    for (size_t b = m_numBlocks ; b > 0 ; b--) {
+      if (m_bitmap[b - 1]) {
+        return (b - 1) * BLOCK_BITS + HighestBit(m_bitmap[b - 1]);
       }
     }
     // no starting pos
@@ -134,26 +201,36 @@ public:
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return m_bitmap[pos];
+    return (m_bitmap[pos / BLOCK_BITS] >> (pos % BLOCK_BITS)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    m_bitmap[pos] = value;
+    SetValue(pos, pos, value);
   }
   //! set value between 2 positions, inclusive
   void SetValue( size_t startPos, size_t endPos, bool value ) {
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = value;
+    if (startPos > endPos) return;
+    size_t startBlock = startPos / BLOCK_BITS, endBlock = endPos / BLOCK_BITS;
+    for (size_t b = startBlock ; b <= endBlock ; b++) {
+      size_t lo = (b == startBlock) ? startPos % BLOCK_BITS : 0;
+      size_t hi = (b == endBlock) ? endPos % BLOCK_BITS : BLOCK_BITS - 1;
+      Block mask = RangeMask(lo, hi);
+      SetBlock(b, value ? (m_bitmap[b] | mask) : (m_bitmap[b] & ~mask));
     }
   }
   //! whether every word has been translated
   bool IsComplete() const {
-    return GetSize() == GetNumWordsCovered();
+    return GetFirstGapPos() == NOT_FOUND;
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const WordsRange &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    size_t startPos = compare.GetStartPos(), endPos = compare.GetEndPos();
+    if (startPos > endPos) return false;
+    size_t startBlock = startPos / BLOCK_BITS, endBlock = endPos / BLOCK_BITS;
+    for (size_t b = startBlock ; b <= endBlock ; b++) {
+      size_t lo = (b == startBlock) ? startPos % BLOCK_BITS : 0;
+      size_t hi = (b == endBlock) ? endPos % BLOCK_BITS : BLOCK_BITS - 1;
+      if (m_bitmap[b] & RangeMask(lo, hi))
         return true;
     }
     return false;
@@ -163,11 +240,17 @@ public:
     return m_size;
   }
 
+  //! hash of the coverage, consistent with Compare() == 0
+  size_t GetHash() const {
+    return m_hash;
+  }
+
   //! transitive comparison of WordsBitmap
   inline int Compare (const WordsBitmap &compare) const {
     // -1 = less than
     // +1 = more than
     // 0	= same
+    // same order as a position-by-position comparison of the coverage
 
     size_t thisSize = GetSize()
                       ,compareSize = compare.GetSize();
@@ -175,27 +258,49 @@ public:
     if (thisSize != compareSize) {
       return (thisSize < compareSize) ? -1 : 1;
     }
-    return std::memcmp(m_bitmap, compare.m_bitmap, thisSize * sizeof(bool));
+    for (size_t b = 0 ; b < m_numBlocks ; b++) {
+      Block diff = m_bitmap[b] ^ compare.m_bitmap[b];
+      if (diff) {
+        return ((m_bitmap[b] >> CountTrailingZeros(diff)) & 1) ? 1 : -1;
+      }
+    }
+    return 0;
   }
 
   bool operator< (const WordsBitmap &compare) const {
     return Compare(compare) < 0;
   }
 
+  bool operator== (const WordsBitmap &compare) const {
+    return m_hash == compare.m_hash && Compare(compare) == 0;
+  }
+
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
+    // one past the last translated word before l
+    size_t pos = l - 1;
+    for (size_t b = pos / BLOCK_BITS + 1 ; b > 0 ; b--) {
+      Block bits = m_bitmap[b - 1];
+      if (b - 1 == pos / BLOCK_BITS)
+        bits &= RangeMask(0, pos % BLOCK_BITS);
+      if (bits)
+        return (b - 1) * BLOCK_BITS + HighestBit(bits) + 1;
     }
-    return l;
+    return 0;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
     if (r+1 == m_size) return r;
-    while (r+1 < m_size && !m_bitmap[r+1]) {
-      ++r;
+    // one before the first translated word after r
+    size_t pos = r + 1;
+    for (size_t b = pos / BLOCK_BITS ; b < m_numBlocks ; b++) {
+      Block bits = m_bitmap[b];
+      if (b == pos / BLOCK_BITS)
+        bits &= RangeMask(pos % BLOCK_BITS, BLOCK_BITS - 1);
+      if (bits)
+        return b * BLOCK_BITS + CountTrailingZeros(bits) - 1;
     }
-    return r;
+    return m_size - 1;
   }
 
 
@@ -214,9 +319,8 @@ public:
 
     CHECK(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2 + (int) GetValue(pos);
-    }
+    if (end > start)
+      id = (WordsBitmapID) GetBits(start + 1, end - start);
     return id + (1<<16) * start;
   }
 
@@ -235,10 +339,11 @@ public:
 
     CHECK(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2;
-      if (GetValue(pos) || (startPos<=pos && pos<=endPos))
-        id++;
+    if (end > start) {
+      id = (WordsBitmapID) GetBits(start + 1, end - start);
+      size_t lo = std::max(startPos, start + 1), hi = std::min(endPos, end);
+      if (lo <= hi)
+        id |= (WordsBitmapID) RangeMask(lo - start - 1, hi - start - 1);
     }
     return id + (1<<16) * start;
   }
@@ -255,5 +360,10 @@ inline std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitma
   return out;
 }
 
+inline size_t hash_value(const WordsBitmap &wordsBitmap)
+{
+  return wordsBitmap.GetHash();
+}
+
 }
 #endif
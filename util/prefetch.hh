@@ -0,0 +1,18 @@
+#ifndef UTIL_PREFETCH__
+#define UTIL_PREFETCH__
+
+namespace util {
+
+/* Start loading the cache line holding address, to be read soon, without
+ * waiting for it.  This is only a hint: it never faults and does nothing on
+ * compilers that don't support it.  
+ */
+inline void PrefetchRead(const void *address) {
+#if defined(__GNUC__)
+  __builtin_prefetch(address, 0, 3);
+#endif
+}
+
+} // namespace util
+
+#endif // UTIL_PREFETCH__
@@ -2,6 +2,7 @@
 #define UTIL_PROBING_HASH_TABLE__
 
 #include "util/exception.hh"
+#include "util/prefetch.hh"
 
 #include <algorithm>
 #include <cstddef>
@@ -92,6 +93,11 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       }   
     }
 
+    // Start loading the bucket where Find(key) begins probing.  
+    template <class Key> void Prefetch(const Key key) const {
+      PrefetchRead(begin_ + (hash_(key) % buckets_));
+    }
+
     template <class Key> bool Find(const Key key, ConstIterator &out) const {
 #ifdef DEBUG
       assert(initialized_);